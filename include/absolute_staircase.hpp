@@ -17,7 +17,9 @@ Requires MEL to build.
 // MEL Libraries
 #include <MEL/Core/Console.hpp>
 #include <MEL/Logging/Csv.hpp>
-#include <MEL/Devices/Windows/Keyboard.hpp>
+
+// libraries for the response keys
+#include "key_events.hpp"
 
 // other misc standard libraries
 #include <random>
@@ -38,6 +40,19 @@ const std::array<double, kConditions_> kInitialStepValues_ =
 	{0.05,2,0.05,4};
 
 
+/***********************************************************
+******************** ENUM DECLARATION **********************
+************************************************************/
+// responses the subject can give to a stimulus
+enum class StaircaseResponse
+{
+	Increase,	// angle was not felt
+	Decrease,	// angle was felt
+	HalveStep,
+	DoubleStep
+};
+
+
 /***********************************************************
 ****************** CLASS DECLARATION ***********************
 ************************************************************/
@@ -55,15 +70,7 @@ private:
 		"Squeeze_Stretch"
 		}; // array of conditions
 	std::array<int, kConditions_> conditions_ = { 0,1,2,3};
-		
-    //  holds input keys for MEL
-    std::vector<mel::Key> input_keys_ = 
-	{ 
-		mel::Key::Add, 		mel::Key::Up,
-		mel::Key::Subtract,	mel::Key::Down,
-		mel::Key::Comma,	mel::Key::Left,
-		mel::Key::Period,	mel::Key::Right
-	};
+
 
     // set all other relevant staircase method variables				
 	double 	angle_,					previous_angle_,
@@ -71,6 +78,9 @@ private:
     int     condition_iterator_, 	condition_true_,
 			trial_iterator_,		crossovers_;
 
+	// keeps the interference motor at its angle between cues
+	bool	hold_interference_;
+
     // random device variable
     std::random_device random_device_; // create random generator
 
@@ -79,7 +89,7 @@ private:
 	void 	TrialInitialize();
 
 	// private UI functions
-	void WaitForKeyRelease(std::vector<mel::Key> keys);
+	static bool	GetKeyResponse(KeyCode key, StaircaseResponse &response);
 
 public:
 	// constructor
@@ -95,6 +105,10 @@ public:
 	double	GetInterferenceAngle();
 	double	GetInterferenceAngle(int condition_num);
 	void	GetTestPositions(std::array<std::array<double, 2>,2> &position_desired);
+
+	// protocol mode functions
+	void	SetHoldInterference(bool hold);
+	bool	GetHoldInterference();
 	
 	// iterator control functions 
 	bool	HasSettled(); 
@@ -104,8 +118,11 @@ public:
 	void	NextCondition();
     bool    SetConditionNum(int condition_num);
 
+    // response functions
+    void    ApplyResponse(StaircaseResponse response);
+
     // UI functions   
-    bool    ReadInput();
+    bool    ReadInput(KeyEventQueue &keys);
 
 	// inport/export functions
 	bool	ImportList(std::string filepath);
@@ -67,11 +67,15 @@ private:
 	// 2,2,2,2,2,2,2,2,2,2
 	// random device variable
 	std::random_device random_device_; // create random generator
+	unsigned int seed_; // seed used for the most recent scramble
 	
 	// iterator variables
 	int condition_iterator_; // iterators on arrays
 	int angle_iterator_;
 
+	// keeps the interference motor at its angle between cues
+	bool hold_interference_;
+
 	// overloaded functions to directly access name information
 	std::string	GetTrialName(int condition, int angle);
 	double		GetAngleNumber(int condition, int angle);
@@ -85,6 +89,8 @@ public:
 
 	// randomizer
 	void 	scramble();
+	void 	scramble(unsigned int seed);
+	unsigned int GetSeed();
 
 	// read various combinations names
 	std::string  	GetTrialName();
@@ -99,6 +105,10 @@ public:
 	void	GetTestPositions(std::array<std::array<double, 2>,2> &position_desired);
 	int		GetIterationNumber();
 
+	// protocol mode functions
+	void	SetHoldInterference(bool hold);
+	bool	GetHoldInterference();
+
 	// control iterator positions
 	void	NextAngle();
 	void	PrevAngle();
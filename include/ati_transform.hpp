@@ -0,0 +1,69 @@
+/*
+File: ati_transform.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the AtiTransform class which converts the raw
+voltages of any number of ATI force/torque sensors into
+forces and torques in one batched call. Calibration
+matrices are read from the sensors' .cal files and kept
+column by column so every sensor is transformed with the
+same vector kernel. AVX2 is used when the compiler targets
+it, with a scalar version of the same kernel otherwise.
+Results are written into caller-provided storage.
+*/
+
+#ifndef ATITRANSFORM
+#define ATITRANSFORM
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int kAtiAxes_(6);			// Fx, Fy, Fz, Tx, Ty, Tz
+const int kAtiPaddedAxes_(8);	// matrix columns padded to two AVX registers
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class AtiTransform
+{
+private:
+	// calibration variables
+	std::size_t			sensor_count_;
+	std::vector<double>	matrix_;	// per sensor, kAtiAxes_ columns of kAtiPaddedAxes_ rows
+	std::vector<double>	bias_;		// per sensor, kAtiAxes_ bias voltages
+
+	// transform kernels
+	void	TransformScalar(const double* voltages, std::size_t scans, double* wrenches) const;
+	void	TransformAvx2(const double* voltages, std::size_t scans, double* wrenches) const;
+
+public:
+	// constructor
+	AtiTransform();
+
+	// calibration functions
+	bool	AddSensor(const std::string &cal_filepath);
+	void	AddSensor(const double matrix[kAtiAxes_][kAtiAxes_]);
+	void	Zero(const double* voltages);
+	void	Clear();
+
+	// transform functions
+	void	Transform(const double* voltages, double* wrenches) const;
+	void	TransformBlock(const double* voltages, std::size_t scans, double* wrenches) const;
+
+	// status functions
+	std::size_t	GetSensorCount() const;
+	std::size_t	GetChannelCount() const;
+	static bool	UsesAvx2();
+};
+#endif
@@ -21,8 +21,11 @@ sensors. Uses MEL's development ATIsensor class.
 #include <MEL/Logging/Csv.hpp>
 #include <MEL/Daq/Input.hpp>
 
-// C libraries
-#include "NIDAQmx.h"
+// libraries for the DAQmx task
+#include "daq_stream.hpp"
+
+// other misc standard libraries
+#include <vector>
 
 /***********************************************************
 ****************** CLASS DECLARATION ***********************
@@ -31,10 +34,9 @@ class DaqNI : public mel::AnalogInput, mel::NonCopyable
 {
 private:
 	// member variables
-	TaskHandle  task_handle_;	// creates a new task_handle_
-	signed long error_;
-	signed long read_;
-	char        error_buffer_[2048] = { '\0' };
+	DaqStream			stream_;
+	std::vector<double>	block_values_;	// scans of the last block, grouped by scan
+	DaqBlock			block_;
 
 public:
 	// constructor
@@ -44,5 +46,17 @@ public:
 	// DAQ update functions
 	bool update();
 	bool update_channel(mel::uint32 channel_number);
+
+	// acquisition mode functions
+	bool StartBuffered(double sample_rate, unsigned int block_size);
+	bool StartOnDemand();
+	bool Restart();
+	bool IsBuffered() const;
+	unsigned int GetBlockSize() const;
+
+	// scan and block functions
+	const double*		GetScanValues();
+	const DaqBlock&		GetBlock() const;
+	const double*		GetBlockValues() const;
 };
-#endif DAQNI
\ No newline at end of file
+#endif DAQNI
@@ -0,0 +1,114 @@
+/*
+File: daq_stream.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the DaqStream class which owns the NI-DAQmx task
+reading the force/torque channels. The task either takes a
+single scan on demand or runs continuously on the board's
+sample clock, in which case scans are read from the driver
+buffer in blocks of a fixed size. Every block carries the
+sample clock time of its first scan, so samples within and
+across blocks are exactly evenly spaced. The class does not
+depend on MEL and builds against the mock DAQmx layer when
+AIMS_MOCK_DAQMX is defined.
+*/
+
+#ifndef DAQSTREAM
+#define DAQSTREAM
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// C libraries
+#ifdef AIMS_MOCK_DAQMX
+#include "daqmx_mock.hpp"
+#else
+#include "NIDAQmx.h"
+#endif
+
+// libraries for the driver call latencies
+#include "driver_latency.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const char			kDaqChannels_[] =	"Dev1/ai0:5,Dev1/ai16:21";	// both ATI sensors
+const int			kDaqChannelCount_(12);
+const double		kDaqTimeout_(10.0);				// seconds to wait for a read
+const double		kDaqBufferedRate_(5000.0);		// sample clock rate in Hz
+const unsigned int	kDaqBlockSize_(5);				// scans per block read
+const double		kDaqBufferSeconds_(1.0);		// driver buffer length
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// timing of a single block of scans
+struct DaqBlock
+{
+	std::uint64_t	first_sample;	// index of the first scan since the task started
+	std::uint32_t	samples;		// scans held by the block
+	double			time;			// sample clock time of the first scan in seconds
+	double			period;			// seconds between scans on the sample clock
+	double			host_time;		// host time the block was read in seconds
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class DaqStream
+{
+private:
+	// task variables
+	TaskHandle		task_handle_;
+	bool			open_;
+	bool			running_;
+	bool			buffered_;
+	std::string		error_;
+
+	// timing variables
+	double			sample_rate_;
+	unsigned int	block_size_;
+	std::uint64_t	samples_read_;
+	std::chrono::steady_clock::time_point	start_time_;
+
+	// driver call latency variables
+	DriverCall		read_scan_call_;
+	DriverCall		read_block_call_;
+
+	// error functions
+	bool	Check(int32 status, const char* action);
+
+public:
+	// constructor
+	DaqStream();
+	~DaqStream();
+
+	// task control functions
+	bool	Open(const char* channels = kDaqChannels_);
+	bool	StartOnDemand();
+	bool	StartBuffered(double sample_rate, unsigned int block_size);
+	bool	Restart();
+	bool	Stop();
+	void	Close();
+
+	// read functions
+	bool	ReadScan(double* values);
+	bool	ReadBlock(double* values, DaqBlock &block);
+
+	// status functions
+	bool				IsBuffered() const;
+	double				GetSampleRate() const;
+	unsigned int		GetBlockSize() const;
+	std::uint64_t		GetSamplesRead() const;
+	const std::string&	GetError() const;
+};
+#endif
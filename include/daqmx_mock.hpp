@@ -0,0 +1,86 @@
+/*
+File: daqmx_mock.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Declares a software stand-in for the subset of the NI-DAQmx
+C API used by this project. It is compiled in place of the
+NI driver when AIMS_MOCK_DAQMX is defined, so the DAQ code
+can be built and exercised on machines without the driver
+or a board. Sample clocked tasks produce samples at their
+configured rate against the host clock, the same way a
+real board fills the driver buffer.
+*/
+
+#ifndef DAQMXMOCK
+#define DAQMXMOCK
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <functional>
+
+
+/***********************************************************
+************************* TYPES ****************************
+************************************************************/
+// NI-DAQmx data types
+typedef void*				TaskHandle;
+typedef signed int			int32;
+typedef unsigned int		uInt32;
+typedef unsigned long long	uInt64;
+typedef double				float64;
+typedef unsigned int		bool32;
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+// NI-DAQmx attribute values used by this project
+#define DAQmx_Val_Cfg_Default				-1
+#define DAQmx_Val_Diff						10106
+#define DAQmx_Val_Volts						10348
+#define DAQmx_Val_Rising					10280
+#define DAQmx_Val_ContSamps					10123
+#define DAQmx_Val_FiniteSamps				10178
+#define DAQmx_Val_OnDemand					10390
+#define DAQmx_Val_SampClk					10388
+#define DAQmx_Val_GroupByChannel			0
+#define DAQmx_Val_GroupByScanNumber			1
+
+// NI-DAQmx error codes produced by the mock
+#define DAQmxErrorInvalidTask				-200088
+#define DAQmxErrorSamplesNotYetAvailable	-200284
+#define DAQmxErrorSamplesNoLongerAvailable	-200279
+#define DAQmxErrorReadBufferTooSmall		-200229
+
+// mock control
+const int kMockDAQmxMaxChannels_(32);
+
+
+/***********************************************************
+****************** FUNCTION DECLARATION ********************
+************************************************************/
+// task functions
+int32 DAQmxCreateTask(const char taskName[], TaskHandle *taskHandle);
+int32 DAQmxStartTask(TaskHandle taskHandle);
+int32 DAQmxStopTask(TaskHandle taskHandle);
+int32 DAQmxClearTask(TaskHandle taskHandle);
+
+// channel and timing functions
+int32 DAQmxCreateAIVoltageChan(TaskHandle taskHandle, const char physicalChannel[], const char nameToAssignToChannel[], int32 terminalConfig, float64 minVal, float64 maxVal, int32 units, const char customScaleName[]);
+int32 DAQmxCfgSampClkTiming(TaskHandle taskHandle, const char source[], float64 rate, int32 activeEdge, int32 sampleMode, uInt64 sampsPerChan);
+int32 DAQmxSetSampTimingType(TaskHandle taskHandle, int32 data);
+
+// read functions
+int32 DAQmxReadAnalogF64(TaskHandle taskHandle, int32 numSampsPerChan, float64 timeout, bool32 fillMode, float64 readArray[], uInt32 arraySizeInSamps, int32 *sampsPerChanRead, bool32 *reserved);
+
+// error functions
+int32 DAQmxGetErrorString(int32 errorCode, char errorString[], uInt32 bufferSize);
+int32 DAQmxGetExtendedErrorInfo(char errorString[], uInt32 bufferSize);
+
+// mock control functions
+void MockDAQmxSetSignal(std::function<double(int channel, double time)> signal);
+void MockDAQmxSetRealTime(bool real_time);
+#endif
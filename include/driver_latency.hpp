@@ -0,0 +1,147 @@
+/*
+File: driver_latency.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines latency recording for individual driver calls. Each
+call site owns a DriverCall holding a log-linear histogram
+of its latencies with about 12% resolution from nanoseconds
+to hours, plus a count of the calls that returned an error.
+Recording only increments atomic counters, so any thread can
+time its calls without locking. Every call site registers
+itself so a report of all of them can be printed or saved
+when the session ends.
+*/
+
+#ifndef DRIVERLATENCY
+#define DRIVERLATENCY
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int	kLatencySubBucketBits_(3);								// 8 buckets per power of two
+const int	kLatencySubBuckets_(1 << kLatencySubBucketBits_);
+const int	kLatencyMaxExponent_(47);								// largest power of two recorded, about 39 hours in ns
+const int	kLatencyBuckets_((kLatencyMaxExponent_ - kLatencySubBucketBits_ + 2) * kLatencySubBuckets_);
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// summary of the latencies of a single call site
+struct LatencySummary
+{
+	std::uint64_t	calls =		0;
+	std::uint64_t	errors =	0;		// calls the driver reported as failed
+	double			mean =		0.0;	// microseconds
+	double			p50 =		0.0;	// microseconds
+	double			p90 =		0.0;	// microseconds
+	double			p99 =		0.0;	// microseconds
+	double			p999 =		0.0;	// microseconds
+	double			max =		0.0;	// microseconds
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class LatencyHistogram
+{
+private:
+	// counter variables
+	std::array<std::atomic<std::uint64_t>, kLatencyBuckets_>	buckets_;
+	std::atomic<std::uint64_t>	count_;
+	std::atomic<std::uint64_t>	sum_;
+	std::atomic<std::uint64_t>	max_;
+
+public:
+	// constructor
+	LatencyHistogram();
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	// recording functions
+	void	Record(std::uint64_t nanoseconds);
+	void	Reset();
+
+	// accessor functions
+	std::uint64_t	GetCount() const;
+	std::uint64_t	GetMax() const;
+	double			GetMean() const;
+	double			GetPercentile(double percentile) const;
+
+	// bucket functions
+	static int				GetBucket(std::uint64_t nanoseconds);
+	static std::uint64_t	GetBucketLow(int bucket);
+	static std::uint64_t	GetBucketHigh(int bucket);
+};
+
+class DriverCall
+{
+private:
+	// call site variables
+	std::string					name_;
+	LatencyHistogram			latency_;
+	std::atomic<std::uint64_t>	errors_;
+
+	// the report reads every name under the registry lock
+	friend void	GetDriverLatencyReport(std::vector<std::string> &names, std::vector<LatencySummary> &summaries);
+
+public:
+	// constructor
+	explicit DriverCall(const std::string &name);
+	~DriverCall();
+	DriverCall(const DriverCall&) = delete;
+	DriverCall& operator=(const DriverCall&) = delete;
+
+	// recording functions
+	void	Record(std::chrono::steady_clock::duration latency, bool failed);
+	void	Reset();
+
+	// accessor functions
+	void			SetName(const std::string &name);
+	std::string		GetName() const;
+	LatencySummary	GetSummary() const;
+};
+
+
+/***********************************************************
+***************** TEMPLATE DECLARATIONS ********************
+************************************************************/
+/*
+Makes a driver call, recording its latency and whether the
+failed predicate finds an error in its result. Returns the
+result of the call unchanged.
+ */
+template <typename Call, typename Failed>
+auto TimedCall(DriverCall &site, Call call, Failed failed) -> decltype(call())
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	auto result = call();
+	site.Record(std::chrono::steady_clock::now() - start, failed(result));
+	return result;
+}
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// report functions covering every registered call site
+void	GetDriverLatencyReport(std::vector<std::string> &names, std::vector<LatencySummary> &summaries);
+void	PrintDriverLatencyReport(std::FILE* out = stdout);
+bool	WriteDriverLatencyReport(const std::string &filepath);
+void	ResetDriverLatency();
+#endif
@@ -0,0 +1,40 @@
+/*
+File: file_io.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Declares small portable helpers for the binary data files
+written by this project. Positions are 64 bit so that
+session files larger than 2 GB can be handled on Windows.
+Every sync to disk is counted so the cost of durability can
+be reported.
+*/
+
+#ifndef FILEIO
+#define FILEIO
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// file position functions
+std::int64_t	FileTell(std::FILE* file);
+bool			FileSeek(std::FILE* file, std::int64_t position);
+std::int64_t	FileSize(std::FILE* file);
+bool			FileTruncate(std::FILE* file, std::int64_t size);
+
+// durability functions
+bool			SyncFile(std::FILE* file);
+unsigned long	GetSyncCount();
+
+// file system functions
+bool			FileExists(const std::string &filepath);
+#endif
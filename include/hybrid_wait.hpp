@@ -0,0 +1,92 @@
+/*
+File: hybrid_wait.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the wait every periodic loop of the testbed uses to
+meet its deadlines. A wait can sleep, which frees the core
+but wakes late by the scheduler's granularity, spin, which
+wakes within microseconds but keeps a core busy, or do both:
+sleep until a spin threshold before the deadline and spin
+the rest of the way. Every wait records how late it woke and
+how much CPU time the waiting thread used, per mode, so the
+modes can be compared on the acquisition PC.
+*/
+
+#ifndef HYBRIDWAIT
+#define HYBRIDWAIT
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the lateness histograms
+#include "driver_latency.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+// ways a thread can wait for a deadline
+enum class WaitMode
+{
+	Sleep,	// sleeps the whole way, lowest CPU use
+	Spin,	// spins the whole way, lowest lateness
+	Hybrid	// sleeps until the spin threshold, then spins
+};
+const int		kWaitModes_(3);
+
+// sleeps overshoot by about one scheduler tick, which is far coarser on Windows
+#ifdef _WIN32
+const double	kWaitSpinThreshold_(0.0015);	// seconds spun before a deadline
+#else
+const double	kWaitSpinThreshold_(0.0002);	// seconds spun before a deadline
+#endif
+const double	kWaitAccuracyTarget_(0.00005);	// wakes later than this count as late
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// how a thread waits for its deadlines
+struct WaitConfig
+{
+	WaitMode	mode =				WaitMode::Hybrid;
+	double		spin_threshold =	kWaitSpinThreshold_;	// seconds
+};
+
+// accuracy and CPU use of every wait made in one mode
+struct WaitSummary
+{
+	std::uint64_t	waits =		0;
+	std::uint64_t	late =		0;		// waits later than the accuracy target
+	double			p50 =		0.0;	// microseconds late
+	double			p99 =		0.0;	// microseconds late
+	double			max =		0.0;	// microseconds late
+	double			cpu =		0.0;	// share of the waiting time spent on a core
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// configuration functions
+void				SetDefaultWaitConfig(const WaitConfig &config);
+const WaitConfig&	GetDefaultWaitConfig();
+const char*			GetWaitModeName(WaitMode mode);
+bool				ParseWaitMode(const std::string &name, WaitMode &mode);
+
+// waits until the deadline and returns how late it woke in nanoseconds
+std::uint64_t	WaitUntil(std::chrono::steady_clock::time_point deadline);
+std::uint64_t	WaitUntil(std::chrono::steady_clock::time_point deadline, const WaitConfig &config);
+
+// statistic functions
+WaitSummary	GetWaitSummary(WaitMode mode);
+void		PrintWaitReport(std::FILE* out = stdout);
+void		ResetWaitStats();
+#endif
@@ -0,0 +1,129 @@
+/*
+File: key_events.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the key event queue the staircase responses are read
+from. Waiting for a key blocks in the operating system until
+input arrives instead of polling key states, so a subject
+holding a key down costs no CPU while acquisition and writer
+threads run. Every press and release is delivered in order
+with a steady clock timestamp in seconds, the same clock the
+session scheduler runs on. Keys are read from the Windows
+console, a Linux terminal or a Linux evdev device. Terminals
+only report presses, so each press from a terminal is
+followed by a release with the same timestamp.
+*/
+
+#ifndef KEYEVENTS
+#define KEYEVENTS
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <deque>
+#include <string>
+
+// platform specific libraries
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+// keys the experiment responds to, any other key is Other
+enum class KeyCode
+{
+	Up,
+	Down,
+	Left,
+	Right,
+	Add,		// numpad +
+	Subtract,	// numpad -
+	Comma,
+	Period,
+	Escape,
+	Other
+};
+
+// whether a key went down or up
+enum class KeyAction
+{
+	Press,
+	Release
+};
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// single key press or release
+struct KeyEvent
+{
+	KeyCode		key =		KeyCode::Other;
+	KeyAction	action =	KeyAction::Press;
+	double		time =		0.0;	// steady clock seconds
+	int			code =		0;		// virtual key, evdev key code or terminal character
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class KeyEventQueue
+{
+private:
+	// source variables
+	std::string			device_;		// evdev device, empty for the console
+	int					handle_;		// evdev or terminal file descriptor
+	bool				open_;
+	bool				listening_;
+	bool				kernel_time_;	// evdev timestamps are on the steady clock
+	bool				held_[256];		// console keys down, to drop auto-repeats
+	std::deque<KeyEvent>	pending_;	// decoded events not yet handed out
+
+	// terminal variables
+#ifndef _WIN32
+	termios				terminal_state_;	// settings restored when ignoring keys
+#endif
+
+	// source functions
+	bool	ReadSource(double timeout);
+	bool	ReadWindowsConsole(double timeout);
+	bool	ReadTerminal(double timeout);
+	bool	ReadDevice(double timeout);
+	void	PushKey(KeyCode key, KeyAction action, double time, int code);
+
+public:
+	// constructor
+	KeyEventQueue();
+	~KeyEventQueue();
+	KeyEventQueue(const KeyEventQueue&) = delete;
+	KeyEventQueue& operator=(const KeyEventQueue&) = delete;
+
+	// source functions
+	bool	Open(const std::string &device = "");
+	bool	Reopen();
+	void	Close();
+	bool	IsOpen() const;
+
+	// listening functions
+	void	Listen();
+	void	Ignore();
+
+	// event functions
+	bool	WaitForEvent(KeyEvent &event, double timeout = -1.0);
+	void	Push(const KeyEvent &event);
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// steady clock in seconds for timestamping key events
+double		GetKeyClock();
+const char*	GetKeyName(KeyCode key);
+#endif
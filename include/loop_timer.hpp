@@ -0,0 +1,71 @@
+/*
+File: loop_timer.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines a fixed-rate loop timer that does not depend on MEL.
+Each wait lasts until the next tick of an absolute schedule
+so the loop rate does not drift with the time spent in the
+loop, waiting in the default mode of the hybrid wait. A tick that is already late is counted as missed and
+the schedule restarts from the current time. A loop paced by
+an outside sample clock, such as the session grid, waits on
+that clock through the timer so its ticks and missed instants
+are still counted.
+*/
+
+#ifndef LOOPTIMER
+#define LOOPTIMER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <chrono>
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class LoopTimer
+{
+private:
+	// schedule variables
+	std::chrono::steady_clock::duration		period_;
+	std::chrono::steady_clock::time_point	start_;
+	std::chrono::steady_clock::time_point	next_tick_;
+	unsigned long							ticks_;
+	unsigned long							missed_;
+
+public:
+	// constructor
+	explicit LoopTimer(double hertz);
+
+	// timing functions
+	void	Restart();
+	void	Wait();
+	template <typename SampleClock>
+	void	WaitOn(SampleClock &clock);
+
+	// status functions
+	double			GetElapsed() const;
+	double			GetPeriod() const;
+	unsigned long	GetTicks() const;
+	unsigned long	GetMissed() const;
+};
+
+
+/***********************************************************
+******************* TIMING FUNCTIONS ***********************
+************************************************************/
+/*
+Waits for the next instant of an outside sample clock instead
+of the timer's own schedule. Instants the clock skipped are
+counted as missed.
+ */
+template <typename SampleClock>
+void LoopTimer::WaitOn(SampleClock &clock)
+{
+	ticks_++;
+	missed_ += (unsigned long)clock.Wait();
+}
+#endif
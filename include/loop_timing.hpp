@@ -0,0 +1,92 @@
+/*
+File: loop_timing.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines per-iteration timing instrumentation for fixed-rate
+loops. Every tick of a loop records a monotonic timestamp
+and the period since the previous tick is binned into a
+histogram around the nominal period, counting overruns and
+the worst lateness. Trial timings can be merged into a
+session total for the end of session summary.
+*/
+
+#ifndef LOOPTIMING
+#define LOOPTIMING
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int			kLoopTimingBins_(51);				// 50 bins up to 2.5 periods and one overflow bin
+const double		kLoopTimingBinsPerPeriod_(20.0);	// bin width is 1/20 of the nominal period
+const double		kLoopOverrunTolerance_(0.1);		// periods this much over nominal are overruns
+const std::size_t	kLoopTimestampCapacity_(60000);		// timestamps kept per trial, 60 s at 1 kHz
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// summary of the ticks of a loop
+struct LoopTimingStats
+{
+	std::uint64_t	ticks =				0;
+	std::uint64_t	overruns =			0;		// periods over nominal by more than the tolerance
+	double			nominal_period =	0.0;	// seconds
+	double			mean_period =		0.0;	// seconds
+	double			max_period =		0.0;	// seconds
+	double			max_lateness =		0.0;	// seconds the worst tick came after nominal
+	std::array<std::uint32_t, kLoopTimingBins_>	histogram = {};	// periods binned from zero
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class LoopTiming
+{
+private:
+	// timestamp variables
+	std::vector<std::int64_t>				timestamps_;	// nanoseconds since the first tick
+	std::chrono::steady_clock::time_point	first_tick_;
+	std::chrono::steady_clock::time_point	last_tick_;
+
+	// statistic variables
+	LoopTimingStats	stats_;
+	double			period_sum_;
+
+public:
+	// constructor
+	explicit LoopTiming(std::size_t capacity = kLoopTimestampCapacity_);
+
+	// recording functions
+	void	Start(double hertz);
+	void	Tick();
+	void	Merge(const LoopTimingStats &stats);
+
+	// accessor functions
+	const LoopTimingStats&				GetStats() const;
+	const std::vector<std::int64_t>&	GetTimestamps() const;
+	double								GetBinWidth() const;
+	static double						GetBinWidth(const LoopTimingStats &stats);
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// table functions for saving timing summaries as CSV rows
+void	GetLoopTimingHeader(const LoopTimingStats &stats, std::vector<std::string> &header_names);
+void	GetLoopTimingRow(const LoopTimingStats &stats, std::vector<double> &row);
+#endif
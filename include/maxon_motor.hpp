@@ -23,14 +23,34 @@ with other controllers
 // includes relevant MEL libraries
 #include <MEL/Daq/Quanser/QPid.hpp>
 
+// drive train constants
+#include "motor_constants.hpp"
+
+// libraries for the driver call latencies and move completion
+#include "driver_latency.hpp"
+#include "settle_detector.hpp"
+
+// other misc standard libraries
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 
 /***********************************************************
-******************* GLOBAL VARIABLES ***********************
+******************* STRUCT DECLARATION *********************
 ************************************************************/
-const double	 kGearRatio_(388125 / 4693); 
-const int		 kEncoderCounts_(1024 * 4); // counts per rotation (using quadrature encoding)
-const int		 kDegreesToRotation_(360); // degress per rotation
-const double	 kDegreesToCount_(kEncoderCounts_ * kGearRatio_ / kDegreesToRotation_);
+// controller state last read from or sent to an EPOS4
+struct EposState
+{
+	bool			known =				false;	// false until the controller has been queried
+	bool			in_fault =			false;
+	bool			enabled =			false;
+	bool			profile_mode =		false;	// profile position mode is active
+	bool			profile_applied =	false;	// the profile below is the one on the controller
+	unsigned int	velocity =			0;
+	unsigned int	acceleration =		0;
+	unsigned int	deceleration =		0;
+};
 
 
 /***********************************************************
@@ -54,14 +74,42 @@ private:
 	// position variables
 	double desired_position_;
 	double actual_position_;
+	SettleDetector settle_;
+
+	// controller state variables
+	EposState	state_;
+	std::mutex	device_mutex_;	// serializes commands to the controller
+
+	// state check thread variables
+	std::thread				check_thread_;
+	std::mutex				check_mutex_;
+	std::condition_variable	check_ready_;
+	std::condition_variable	check_done_;
+	bool					check_requested_;
+	bool					check_in_progress_;
+	bool					check_running_;
+
+	// driver call latency variables, named after the port
+	DriverCall move_call_;
+	DriverCall fault_call_;
+	DriverCall halt_call_;
 
 	// device connection functions
 	void		 EnableControl();
 	void		 DisableControl();
 
+	// controller state functions
+	void		 QueryState();
+	void		 ApplyProfile();
+	void		 CheckLoop();
+	void		 StopCheckThread();
+
 	// movement functions
 	void		 Halt();
 
+	// driver call latency functions
+	void		 NameDriverCalls();
+
 public:
 	// constructor
 	MaxonMotor(mel::QuanserEncoder::Channel encoder);
@@ -76,6 +124,11 @@ public:
 	void	SetControlParam(unsigned int desired_velocity, 
 							unsigned int desired_acceleration, 
 							unsigned int desired_deceleration);
+	void	SetSettleConfig(const SettleConfig &config);
+
+	// controller state functions
+	void	CheckState();
+	void	WaitForCheck();
 
 	// movement functions
 	void	Move(double desired_position);
@@ -0,0 +1,228 @@
+/*
+File: motor_commander.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines an asynchronous command layer for the two motors of
+a movement trial. Each motor controller gets its own command
+thread, so both position commands go out at the same moment
+instead of motor B waiting a full USB round-trip behind motor
+A. The threads meet at a spin barrier after waking so the
+difference in their wake-up times does not skew the commands
+either. The caller waits for both commands to complete and
+gets back when each was issued and how long it took. The
+threads live as long as the commander, which is created once
+for the session, and in real-time mode each takes real-time
+priority on its own core before the first command.
+*/
+
+#ifndef MOTORCOMMANDER
+#define MOTORCOMMANDER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the session trace and real-time mode
+#include "trace.hpp"
+#include "realtime.hpp"
+
+// other misc standard libraries
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// timing of a pair of motor commands
+struct MotorCommandTiming
+{
+	double	issue_skew =		0.0;			// seconds motor B was commanded after motor A
+	double	duration[2] =		{ 0.0, 0.0 };	// seconds each command took to complete
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+template <typename Motor>
+class MotorCommander
+{
+private:
+	// single motor and its command thread
+	struct CommandChannel
+	{
+		Motor*		motor;
+		double		position;
+		std::thread	thread;
+		std::chrono::steady_clock::time_point	issued;
+		std::chrono::steady_clock::time_point	completed;
+	};
+
+	// command variables
+	std::array<CommandChannel, 2>	channels_;
+	std::mutex						mutex_;
+	std::condition_variable			command_ready_;
+	std::condition_variable			command_done_;
+	std::uint64_t					generation_;	// commands issued so far
+	int								pending_;		// channels still carrying out the command
+	int								started_;		// command threads ready for their first command
+	bool							running_;
+	const RealtimeConfig*			realtime_;		// pins the command threads when set
+	std::atomic<std::uint64_t>		arrived_;		// channels that reached the barrier, over every command
+
+	// command thread functions
+	void	CommandLoop(int index);
+
+public:
+	// constructor
+	MotorCommander(Motor &motor_a, Motor &motor_b, const RealtimeConfig* realtime = nullptr);
+	~MotorCommander();
+	MotorCommander(const MotorCommander&) = delete;
+	MotorCommander& operator=(const MotorCommander&) = delete;
+
+	// command functions
+	void				MoveBoth(double position_a, double position_b);
+	MotorCommandTiming	WaitForCompletion();
+};
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the MotorCommander class, starting a command
+thread for each motor and waiting until both are ready
+ */
+template <typename Motor>
+MotorCommander<Motor>::MotorCommander(Motor &motor_a, Motor &motor_b, const RealtimeConfig* realtime) :
+	generation_(0),
+	pending_(0),
+	started_(0),
+	running_(true),
+	realtime_(realtime),
+	arrived_(0)
+{
+	channels_[0].motor = &motor_a;
+	channels_[1].motor = &motor_b;
+	for (int i = 0; i < 2; i++)
+	{
+		channels_[i].position = 0.0;
+		channels_[i].thread = std::thread(&MotorCommander::CommandLoop, this, i);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	command_done_.wait(lock, [this] { return started_ == 2; });
+}
+
+/*
+Destructor for the MotorCommander class. Any command still
+in progress is finished before the threads stop.
+ */
+template <typename Motor>
+MotorCommander<Motor>::~MotorCommander()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	command_ready_.notify_all();
+	for (int i = 0; i < 2; i++)
+		channels_[i].thread.join();
+}
+
+
+/***********************************************************
+***************** COMMAND THREAD FUNCTIONS *****************
+************************************************************/
+/*
+Main loop of a command thread. Takes its real-time priority
+and core in real-time mode, then waits for a command, meets
+the other command thread at the barrier and sends its motor
+to the commanded position.
+ */
+template <typename Motor>
+void MotorCommander<Motor>::CommandLoop(int index)
+{
+	SetTraceThreadName(index == 0 ? "Motor A commands" : "Motor B commands");
+	if (realtime_ != nullptr)
+		EnterRealtime(realtime_->priority, GetRealtimeCpu(realtime_->command_cpu[index], 2 + index));
+	CommandChannel &channel = channels_[index];
+	std::uint64_t seen = 0;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	started_++;
+	command_done_.notify_all();
+	while (true)
+	{
+		// a command already issued is carried out even when stopping
+		command_ready_.wait(lock, [&] { return generation_ != seen || !running_; });
+		if (generation_ == seen)
+			break;
+		seen = generation_;
+		double position = channel.position;
+		lock.unlock();
+
+		// waits for the other thread so both commands leave together
+		arrived_.fetch_add(1, std::memory_order_acq_rel);
+		while (arrived_.load(std::memory_order_acquire) < 2 * seen)
+			std::this_thread::yield();
+
+		// blocking command to the controller
+		std::chrono::steady_clock::time_point issued = std::chrono::steady_clock::now();
+		channel.motor->Move(position);
+		std::chrono::steady_clock::time_point completed = std::chrono::steady_clock::now();
+
+		// reports the completion back
+		lock.lock();
+		channel.issued =	issued;
+		channel.completed =	completed;
+		if (--pending_ == 0)
+			command_done_.notify_all();
+	}
+}
+
+
+/***********************************************************
+******************* COMMAND FUNCTIONS **********************
+************************************************************/
+/*
+Commands both motors to their positions at once and returns
+without waiting for the commands to complete
+ */
+template <typename Motor>
+void MotorCommander<Motor>::MoveBoth(double position_a, double position_b)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		channels_[0].position = position_a;
+		channels_[1].position = position_b;
+		pending_ = 2;
+		generation_++;
+	}
+	command_ready_.notify_all();
+}
+
+/*
+Waits until both motors have accepted their last command and
+returns the timing of the commands. The motors may still be
+moving when this returns.
+ */
+template <typename Motor>
+MotorCommandTiming MotorCommander<Motor>::WaitForCompletion()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	command_done_.wait(lock, [this] { return pending_ == 0; });
+
+	MotorCommandTiming timing;
+	timing.issue_skew = std::chrono::duration<double>(channels_[1].issued - channels_[0].issued).count();
+	for (int i = 0; i < 2; i++)
+		timing.duration[i] = std::chrono::duration<double>(channels_[i].completed - channels_[i].issued).count();
+	return timing;
+}
+#endif
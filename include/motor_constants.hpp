@@ -0,0 +1,27 @@
+/*
+File: motor_constants.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Holds the drive train constants of the AIMS testbed motors
+used to convert between output degrees and encoder counts.
+Kept apart from the Maxon Motor class so code that does not
+talk to the EPOS controllers can share them.
+*/
+
+#ifndef MOTORCONSTANTS
+#define MOTORCONSTANTS
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+const double	 kGearRatio_(388125 / 4693); 
+const int		 kEncoderCounts_(1024 * 4); // counts per rotation (using quadrature encoding)
+const int		 kDegreesToRotation_(360); // degress per rotation
+const double	 kDegreesToCount_(kEncoderCounts_ * kGearRatio_ / kDegreesToRotation_);
+
+// default EPOS position profile
+const unsigned int kProfileVelocity_(10000);		// rpm
+const unsigned int kProfileAcceleration_(100000);	// rpm/s
+const unsigned int kProfileDeceleration_(100000);	// rpm/s
+#endif
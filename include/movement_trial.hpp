@@ -0,0 +1,660 @@
+/*
+File: movement_trial.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the movement trial recorder as templates over a
+bundle of devices chosen at compile time. A force/torque
+acquisition thread samples the DAQ through the calibration
+transform and hands samples to the motor supervision loop
+through a lock-free ring. The supervision loop sequences the
+position steps, commanding both motors at once through their
+own command threads and ending a step that has not settled
+within the maximum settle time, and publishes the motor positions it
+reads through a seqlock snapshot, which the acquisition thread
+stamps on each sample together with its acquisition time. The acquisition and command threads are
+owned by a recorder created once next to the devices, so no
+thread is started inside a trial, and in real-time mode each
+takes its real-time priority and core when it starts. Given
+a session scheduler, both loops wait for the sample instants
+of the session grid through their timers instead of on the
+timers' own schedules. Because the devices are template parameters,
+every device call in the loop is resolved and inlined at
+compile time whether the bundle holds the rig, simulated or
+replayed hardware.
+
+A device bundle names five types:
+	Daq			update(), IsBuffered(), GetBlockSize(), GetBlock(),
+				GetBlockValues(), GetScanValues(), Restart()
+	Encoders	update_input()
+	Motor		Move(deg), GetPosition(deg&), TargetReached()
+	Transform	Update(voltages), GetWrenches(Wrench*),
+				UpdateBlock(voltages, scans, Wrench*), GetSensorCount()
+	Timer		Timer(hertz), Wait(), WaitOn(clock)
+*/
+
+#ifndef MOVEMENTTRIAL
+#define MOVEMENTTRIAL
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial sample buffer, sample ring, loop timing and tracing
+#include "sample_buffer.hpp"
+#include "spsc_ring.hpp"
+#include "wrench_reader.hpp"
+#include "loop_timing.hpp"
+#include "trace.hpp"
+
+// libraries for the motor command threads, session pacing and real-time mode
+#include "motor_commander.hpp"
+#include "session_scheduler.hpp"
+#include "realtime.hpp"
+
+// other misc standard libraries
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t kFtRingCapacity_(4096);	// force/torque samples buffered between the threads
+const double kMaxSettleTime_(1.0);			// seconds a move may take to settle before it is given up on
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// references to the devices a movement trial runs on
+template <typename DaqType, typename EncoderType, typename MotorType, typename TransformType, typename TimerType>
+struct DeviceBundle
+{
+	typedef DaqType			Daq;
+	typedef EncoderType		Encoders;
+	typedef MotorType		Motor;
+	typedef TransformType	Transform;
+	typedef TimerType		Timer;
+
+	Daq&		daq;
+	Encoders&	encoders;
+	Motor&		motor_a;
+	Motor&		motor_b;
+	Transform&	transform;
+};
+
+// motor positions published by the supervision loop, read whole by
+// the acquisition thread without either of them waiting on a lock
+struct PositionSnapshot
+{
+	std::atomic<std::uint32_t>	sequence;		// odd while a publish is in progress
+	std::atomic<double>			desired[2];
+	std::atomic<double>			actual[2];
+
+	PositionSnapshot() :
+		sequence(0)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			desired[i].store(0.0, std::memory_order_relaxed);
+			actual[i].store(0.0, std::memory_order_relaxed);
+		}
+	}
+
+	// only ever called from one thread
+	void Publish(const double (&position_desired)[2], const double (&position_actual)[2])
+	{
+		std::uint32_t start = sequence.load(std::memory_order_relaxed);
+		sequence.store(start + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (int i = 0; i < 2; i++)
+		{
+			desired[i].store(position_desired[i], std::memory_order_relaxed);
+			actual[i].store(position_actual[i], std::memory_order_relaxed);
+		}
+		sequence.store(start + 2, std::memory_order_release);
+	}
+
+	// retries until it reads positions no publish was writing
+	void Read(double (&position_desired)[2], double (&position_actual)[2]) const
+	{
+		std::uint32_t start;
+		std::uint32_t end;
+		do
+		{
+			start = sequence.load(std::memory_order_acquire);
+			for (int i = 0; i < 2; i++)
+			{
+				position_desired[i] = desired[i].load(std::memory_order_relaxed);
+				position_actual[i] = actual[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			end = sequence.load(std::memory_order_relaxed);
+		} while ((start & 1) != 0 || start != end);
+	}
+};
+
+// state shared by the acquisition thread and supervision loop
+struct MovementState
+{
+	SpscRing<FtSample>	ring;
+	std::atomic<bool>	acquiring;
+	double				sample_rate;
+	double				motor_position[2];			// supervision loop copies, published through positions
+	double				motor_desired_position[2];
+	PositionSnapshot	positions;					// stamped on every sample by the acquisition thread
+	std::chrono::steady_clock::time_point	trial_start;	// on-demand samples are timed from it
+	LoopTiming			timing;		// supervision loop ticks of the last trial
+	double				max_command_skew;	// seconds between the motor commands of a step, worst of the last trial
+	double				max_settle_time;	// seconds a step may take to settle before it is ended
+	unsigned int		settle_timeouts;	// steps of the last trial ended before both motors settled
+	SessionScheduler*	scheduler;	// paces samples on the session grid when set
+	const RealtimeConfig*	realtime;	// runs the recorder threads in real time, read when the recorder starts
+
+	explicit MovementState(double rate) :
+		ring(kFtRingCapacity_),
+		acquiring(false),
+		sample_rate(rate),
+		motor_position{ 0.0, 0.0 },
+		motor_desired_position{ 0.0, 0.0 },
+		max_command_skew(0.0),
+		max_settle_time(kMaxSettleTime_),
+		settle_timeouts(0),
+		scheduler(nullptr),
+		realtime(nullptr)
+	{
+	}
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+// threads the movement trials of a session run on, started once next to the devices
+template <typename Devices>
+class MovementRecorder
+{
+private:
+	// device variables
+	Devices&								devices_;
+	MovementState&							state_;
+	MotorCommander<typename Devices::Motor>	commander_;
+
+	// acquisition thread variables
+	std::thread					acquisition_;
+	std::mutex					mutex_;
+	std::condition_variable		acquisition_ready_;
+	std::condition_variable		acquisition_done_;
+	std::vector<Wrench>			wrenches_;		// kept between trials
+	bool						requested_;		// trial waiting to be acquired
+	bool						acquiring_;		// acquisition of a trial in progress
+	bool						started_;
+	bool						running_;
+
+	// acquisition thread functions
+	void	AcquisitionLoop();
+
+public:
+	// constructor
+	MovementRecorder(Devices &devices, MovementState &state);
+	~MovementRecorder();
+	MovementRecorder(const MovementRecorder&) = delete;
+	MovementRecorder& operator=(const MovementRecorder&) = delete;
+
+	// acquisition functions
+	void	StartAcquisition();
+	void	StopAcquisition();
+
+	// access functions
+	Devices&								GetDevices();
+	MovementState&							GetState();
+	MotorCommander<typename Devices::Motor>&	GetCommander();
+};
+
+
+/***********************************************************
+****************** MOVEMENT FUNCTIONS **********************
+************************************************************/
+/*
+Publishes the motor positions the supervision loop holds, for
+the acquisition thread to stamp on the samples it takes next
+*/
+inline void PublishPositions(MovementState &state)
+{
+	state.positions.Publish(state.motor_desired_position, state.motor_position);
+}
+
+/*
+Reads the DAQ once and pushes a sample into the ring for every
+scan it delivered, stamped with the motor positions published
+at that moment and the time of the scan: its sample clock time
+when buffered, otherwise the time the read returned. wrenches
+must hold a block of scans for every sensor. Returns the
+number of scans read.
+*/
+template <typename Devices>
+std::size_t AcquireScans(Devices &devices, MovementState &state, std::vector<Wrench> &wrenches)
+{
+	typename Devices::Daq&			daq =		devices.daq;
+	typename Devices::Transform&	transform =	devices.transform;
+	FtSample ft_sample;
+
+	// DAQmx Read Code
+	if (!daq.update()) return 0;
+
+	// the positions the motors were at while the scans were taken
+	state.positions.Read(ft_sample.position_desired, ft_sample.position_actual);
+
+	// measuring force/torque sensors for every scan read
+	std::size_t scans = 1;
+	double time = 0.0;
+	double period = 0.0;
+	if (daq.IsBuffered())
+	{
+		scans = daq.GetBlock().samples;
+		time = daq.GetBlock().time;
+		period = daq.GetBlock().period;
+		transform.UpdateBlock(daq.GetBlockValues(), scans, wrenches.data());
+	}
+	else
+	{
+		time = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.trial_start).count();
+		transform.Update(daq.GetScanValues());
+		transform.GetWrenches(wrenches.data());
+	}
+
+	for (std::size_t scan = 0; scan < scans; scan++)
+	{
+		ft_sample.time = time + scan * period;
+		const Wrench &wrench_a = wrenches[scan * transform.GetSensorCount()];
+		const Wrench &wrench_b = wrenches[scan * transform.GetSensorCount() + 1];
+		for (int i = 0; i < 3; i++)
+		{
+			ft_sample.force_a[i] =	wrench_a[i];
+			ft_sample.torque_a[i] =	wrench_a[i + 3];
+			ft_sample.force_b[i] =	wrench_b[i];
+			ft_sample.torque_b[i] =	wrench_b[i + 3];
+		}
+
+		// a full ring counts the sample as dropped rather than blocking
+		state.ring.TryPush(ft_sample);
+	}
+	return scans;
+}
+
+/*
+Acquisition of a movement trial, run on the acquisition
+thread. Samples the force/torque sensors at the logging rate,
+or every scan the DAQ delivers on its sample clock, and pushes
+each sample into the ring without ever waiting on the
+supervision loop. wrenches is kept between trials and only
+grows when the DAQ block does.
+*/
+template <typename Devices>
+void AcquireForceTorque(Devices &devices, MovementState &state, std::vector<Wrench> &wrenches)
+{
+	// wrenches of every sensor for every scan of a block
+	std::size_t wrench_count = devices.daq.GetBlockSize() * devices.transform.GetSensorCount();
+	if (wrenches.size() < wrench_count)
+		wrenches.resize(wrench_count);
+
+	// create logging rate timer, or follow the session grid if scheduled
+	typename Devices::Timer timer(state.sample_rate);
+	SessionScheduler::SampleClock clock;
+	if (state.scheduler != nullptr)
+		clock = state.scheduler->GetSampleClock();
+
+	// sensor acquisition loop
+	while (state.acquiring.load(std::memory_order_acquire))
+	{
+		AcquireScans(devices, state, wrenches);
+
+		// the sample clock paces buffered reads by itself
+		if (devices.daq.IsBuffered())
+			continue;
+		if (state.scheduler != nullptr)
+			timer.WaitOn(clock);
+		else
+			timer.Wait();
+	}
+}
+
+/*
+Moves every force/torque sample waiting in the ring into the
+output buffer, with the time and motor positions it was
+stamped with when acquired
+*/
+inline void DrainForceTorque(MovementState &state, SampleBuffer* output_, int &sample)
+{
+	FtSample ft_sample;
+	while (state.ring.TryPop(ft_sample))
+	{
+		// input the sampled data into the preallocated output buffer
+		output_->Append( (unsigned int)sample,
+			// Motor/Sensor A
+			ft_sample.position_desired[0],	ft_sample.position_actual[0], 
+			ft_sample.force_a,				ft_sample.torque_a,
+			
+			// Motor/Sensor B
+			ft_sample.position_desired[1],	ft_sample.position_actual[1],
+			ft_sample.force_b,				ft_sample.torque_b,
+
+			// acquisition time
+			ft_sample.time
+		);
+
+		// increment sample number
+		sample++;
+	}
+}
+
+/*
+Single pass of the movement supervision loop, latching and
+publishing the motor positions and logging the samples
+acquired since the last pass
+*/
+template <typename Devices>
+void SuperviseTick(Devices &devices, MovementState &state, SampleBuffer* output_, int &sample)
+{
+	// gets the actual positions of the motors
+	devices.encoders.update_input();
+	devices.motor_a.GetPosition(state.motor_position[0]);
+	devices.motor_b.GetPosition(state.motor_position[1]);
+	PublishPositions(state);
+
+	// logs the force/torque samples acquired since the last pass
+	DrainForceTorque(state, output_, sample);
+}
+
+/*
+Measures force/torque data, motor position data and time information
+during the motor movement. The sensors are read on the recorder's
+acquisition thread while this thread supervises the motors, so
+a slow DAQ read never delays noticing a target was reached and
+slow encoder polling never drops force/torque samples.
+*/
+template <typename Devices>
+void RecordMovementTrial(std::array<std::array<double,2>,2> &position_desired,
+						MovementRecorder<Devices> &recorder, SampleBuffer* output_)
+{
+	Devices&					devices =	recorder.GetDevices();
+	MovementState&				state =		recorder.GetState();
+	typename Devices::Encoders&	encoders =	devices.encoders;
+	typename Devices::Motor&	motor_a =	devices.motor_a;
+	typename Devices::Motor&	motor_b =	devices.motor_b;
+
+	// command thread of each motor
+	MotorCommander<typename Devices::Motor>& commander = recorder.GetCommander();
+	state.max_command_skew = 0.0;
+	state.settle_timeouts = 0;
+
+	// initial sample
+	int sample = 0;
+
+	// drops the scans buffered by the DAQ since the last trial, so
+	// the sample clock times like the steady clock from here
+	if (devices.daq.IsBuffered())
+		devices.daq.Restart();
+	state.trial_start = std::chrono::steady_clock::now();
+
+	// times every pass of the supervision loop
+	state.timing.Start(state.sample_rate);
+
+	// create logging rate timer once for the whole trial, or follow
+	// the session grid from the trial onset if scheduled
+	typename Devices::Timer timer(state.sample_rate);
+	SessionScheduler::SampleClock clock;
+	if (state.scheduler != nullptr)
+		clock = state.scheduler->GetSampleClock();
+
+	// publishes where the motors start from for the first samples
+	encoders.update_input();
+	motor_a.GetPosition(state.motor_position[0]);
+	motor_b.GetPosition(state.motor_position[1]);
+	PublishPositions(state);
+
+	// starts the force/torque acquisition
+	recorder.StartAcquisition();
+
+	// loops through each of the positions in the std::array for the trial
+	for (std::size_t i = 0; i < position_desired.size(); i++)
+	{
+		TraceSpan step_span("Position step", "motion");
+
+		// logs the samples of the last step before its positions change
+		DrainForceTorque(state, output_, sample);
+
+		// MOTOR MOVEMENT COMMANDS
+		// gets the new desired position to be sent to the motors
+		state.motor_desired_position[0] = position_desired[i][0];
+		state.motor_desired_position[1] = position_desired[i][1];
+
+		// COLLECT FIRST SAMPLE
+		// updates the input channels of the encoders
+		encoders.update_input();
+		// gets the actual positions of the motors
+		motor_a.GetPosition(state.motor_position[0]);
+		motor_b.GetPosition(state.motor_position[1]);
+		PublishPositions(state);
+
+		// move motors to desired positions, waiting until both
+		// controllers have taken their commands
+		commander.MoveBoth(state.motor_desired_position[0], state.motor_desired_position[1]);
+		MotorCommandTiming command_timing = commander.WaitForCompletion();
+		state.max_command_skew = std::max(state.max_command_skew, std::fabs(command_timing.issue_skew));
+
+		// movement supervision loop, checking both motors every
+		// pass so neither settle detector misses a reading, and
+		// moving on to the next step if they never settle
+		std::chrono::steady_clock::time_point settle_deadline = std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(state.max_settle_time));
+		while (true)
+		{
+			bool reached_a = motor_a.TargetReached();
+			bool reached_b = motor_b.TargetReached();
+			if (reached_a && reached_b) break;
+			if (std::chrono::steady_clock::now() >= settle_deadline)
+			{
+				state.settle_timeouts++;
+				break;
+			}
+
+			state.timing.Tick();
+			SuperviseTick(devices, state, output_, sample);
+			if (state.scheduler != nullptr)
+				timer.WaitOn(clock);
+			else
+				timer.Wait();
+		}
+	}
+
+	// stops the acquisition and logs its last samples
+	recorder.StopAcquisition();
+	DrainForceTorque(state, output_, sample);
+}
+
+/*
+Moves both motors to the given positions outside of a trial,
+such as returning a held interference motor to zero, and
+waits until both have settled. Nothing is recorded. Returns
+false if they did not settle within the maximum settle time.
+*/
+template <typename Devices>
+bool ParkMotors(double position_a, double position_b, MovementRecorder<Devices> &recorder)
+{
+	TraceSpan span("Park motors", "motion");
+	Devices&					devices =	recorder.GetDevices();
+	MovementState&				state =		recorder.GetState();
+	typename Devices::Motor&	motor_a =	devices.motor_a;
+	typename Devices::Motor&	motor_b =	devices.motor_b;
+
+	// latches the positions the moves start from
+	devices.encoders.update_input();
+	recorder.GetCommander().MoveBoth(position_a, position_b);
+	recorder.GetCommander().WaitForCompletion();
+	state.motor_desired_position[0] = position_a;
+	state.motor_desired_position[1] = position_b;
+	PublishPositions(state);
+
+	// waits for both motors to settle
+	std::chrono::steady_clock::time_point settle_deadline = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(state.max_settle_time));
+	typename Devices::Timer timer(state.sample_rate);
+	while (true)
+	{
+		devices.encoders.update_input();
+		bool reached_a = motor_a.TargetReached();
+		bool reached_b = motor_b.TargetReached();
+		if (reached_a && reached_b) return true;
+		if (std::chrono::steady_clock::now() >= settle_deadline) return false;
+		timer.Wait();
+	}
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the MovementRecorder class, starting the motor
+command threads and the acquisition thread and waiting until
+all of them are ready. In real-time mode each takes its
+real-time priority and core here, before the first trial.
+*/
+template <typename Devices>
+MovementRecorder<Devices>::MovementRecorder(Devices &devices, MovementState &state) :
+	devices_(devices),
+	state_(state),
+	commander_(devices.motor_a, devices.motor_b, state.realtime),
+	requested_(false),
+	acquiring_(false),
+	started_(false),
+	running_(true)
+{
+	// sized for the current block, grown by a trial if the block grows
+	wrenches_.resize(devices.daq.GetBlockSize() * devices.transform.GetSensorCount());
+
+	acquisition_ = std::thread(&MovementRecorder::AcquisitionLoop, this);
+	std::unique_lock<std::mutex> lock(mutex_);
+	acquisition_done_.wait(lock, [this] { return started_; });
+}
+
+/*
+Destructor for the MovementRecorder class, stopping the
+acquisition thread. The command threads stop with the commander.
+*/
+template <typename Devices>
+MovementRecorder<Devices>::~MovementRecorder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	acquisition_ready_.notify_all();
+	acquisition_.join();
+}
+
+
+/***********************************************************
+************** ACQUISITION THREAD FUNCTIONS ****************
+************************************************************/
+/*
+Main loop of the acquisition thread. Takes its real-time
+priority and core in real-time mode, then acquires each trial
+it is started for until the trial stops it.
+*/
+template <typename Devices>
+void MovementRecorder<Devices>::AcquisitionLoop()
+{
+	SetTraceThreadName("Force/torque acquisition");
+	if (state_.realtime != nullptr)
+		EnterRealtime(state_.realtime->priority, GetRealtimeCpu(state_.realtime->acquisition_cpu, 1));
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	started_ = true;
+	acquisition_done_.notify_all();
+	while (true)
+	{
+		acquisition_ready_.wait(lock, [this] { return requested_ || !running_; });
+		if (!requested_)
+			break;
+		requested_ = false;
+		lock.unlock();
+
+		AcquireForceTorque(devices_, state_, wrenches_);
+
+		lock.lock();
+		acquiring_ = false;
+		acquisition_done_.notify_all();
+	}
+}
+
+/*
+Starts acquiring force/torque samples into an empty ring
+*/
+template <typename Devices>
+void MovementRecorder<Devices>::StartAcquisition()
+{
+	state_.ring.Reset();
+	state_.acquiring.store(true, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		requested_ = true;
+		acquiring_ = true;
+	}
+	acquisition_ready_.notify_one();
+}
+
+/*
+Stops acquiring and waits until the acquisition thread has
+made its last read of the trial
+*/
+template <typename Devices>
+void MovementRecorder<Devices>::StopAcquisition()
+{
+	state_.acquiring.store(false, std::memory_order_release);
+	std::unique_lock<std::mutex> lock(mutex_);
+	acquisition_done_.wait(lock, [this] { return !acquiring_; });
+}
+
+
+/***********************************************************
+******************** ACCESS FUNCTIONS **********************
+************************************************************/
+/*
+Returns the devices the trials run on
+*/
+template <typename Devices>
+Devices& MovementRecorder<Devices>::GetDevices()
+{
+	return devices_;
+}
+
+/*
+Returns the state shared by the acquisition thread and
+supervision loop
+*/
+template <typename Devices>
+MovementState& MovementRecorder<Devices>::GetState()
+{
+	return state_;
+}
+
+/*
+Returns the command threads of the motors
+*/
+template <typename Devices>
+MotorCommander<typename Devices::Motor>& MovementRecorder<Devices>::GetCommander()
+{
+	return commander_;
+}
+#endif
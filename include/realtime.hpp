@@ -0,0 +1,131 @@
+/*
+File: realtime.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the real-time mode of the movement trials. The motion
+loop runs on a dedicated thread at SCHED_FIFO priority pinned
+to its own core, and the force/torque acquisition thread and
+the two motor command threads take the same priority on cores
+of their own. Process
+memory is locked and the heap and thread stacks pre-faulted,
+so no page fault lands in a 1 kHz loop. Each guarantee is
+only requested; what the kernel actually granted is collected
+in a report printed at startup. Memory is only locked when the
+locked memory limit allows the whole process to be locked, and
+threads started afterwards get a small fixed stack, so a lock
+refused to an unprivileged user is reported instead of failing
+the next thread to start. On Windows the threads get
+time critical priority and affinity, and memory locking is
+reported as unsupported.
+*/
+
+#ifndef REALTIME
+#define REALTIME
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int			kRealtimePriority_(80);					// SCHED_FIFO priority, below the kernel's IRQ threads
+const std::size_t	kRealtimeStackPrefault_(256 * 1024);	// bytes of stack touched by each real-time thread
+const std::size_t	kRealtimeThreadStack_(512 * 1024);		// stack size of every thread started in real-time mode
+const std::size_t	kRealtimeHeapPrefault_(32 * 1024 * 1024);	// bytes of heap touched and kept by the process
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// what the real-time mode asks for, a core of -1 picks one from the end
+struct RealtimeConfig
+{
+	int		priority =			kRealtimePriority_;
+	int		motion_cpu =		-1;		// defaults to the last core
+	int		acquisition_cpu =	-1;		// defaults to the core before the motion core
+	int		command_cpu[2] =	{ -1, -1 };	// motor A and B command threads, default to the two cores before that
+};
+
+// what a single thread was granted
+struct RealtimeThreadReport
+{
+	bool		scheduled =			false;	// running at real-time priority
+	int			priority =			0;
+	bool		pinned =			false;	// restricted to its core
+	int			cpu =				-1;
+	std::size_t	stack_prefaulted =	0;		// bytes
+	std::string	error;						// first request that was refused
+};
+
+// what the process and its real-time threads were granted
+struct RealtimeReport
+{
+	bool					preempt_rt =		false;	// running on a PREEMPT_RT kernel
+	bool					memory_locked =		false;
+	std::size_t				heap_prefaulted =	0;		// bytes
+	std::string				memory_error;
+	RealtimeThreadReport	motion;
+	RealtimeThreadReport	acquisition;
+	RealtimeThreadReport	command[2];		// motor A and B command threads
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+// dedicated real-time thread the motion loop is handed to
+class RealtimeThread
+{
+private:
+	// worker variables
+	std::thread					thread_;
+	std::mutex					mutex_;
+	std::condition_variable		job_ready_;
+	std::condition_variable		job_done_;
+	const std::function<void()>*	job_;
+	bool						running_;
+	bool						started_;
+	RealtimeThreadReport		report_;
+
+	// worker functions
+	void	WorkerLoop(int priority, int cpu);
+
+public:
+	// constructor
+	RealtimeThread();
+	~RealtimeThread();
+	RealtimeThread(const RealtimeThread&) = delete;
+	RealtimeThread& operator=(const RealtimeThread&) = delete;
+
+	// thread functions
+	RealtimeThreadReport	Start(int priority, int cpu);
+	void					Run(const std::function<void()> &job);
+	void					Stop();
+	bool					IsRunning() const;
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// process functions
+int						GetRealtimeCpu(int requested, int from_end);
+RealtimeReport			PrepareRealtime(const RealtimeConfig &config);
+
+// thread functions
+RealtimeThreadReport	EnterRealtime(int priority, int cpu, std::size_t stack_prefault = kRealtimeStackPrefault_);
+
+// report functions
+void					PrintRealtimeReport(const RealtimeReport &report, std::FILE* out = stdout);
+#endif
@@ -0,0 +1,166 @@
+/*
+File: replay_devices.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines replay stand-ins for the testbed hardware that play
+back a recorded trial log. The DAQ hands out the recorded
+wrenches one sample per update, the encoders latch the
+recorded motor positions of the sample being played and the
+motors report their target reached from those positions,
+so a recorded trial can be run back through the movement
+trial templates without the rig.
+*/
+
+#ifndef REPLAYDEVICES
+#define REPLAYDEVICES
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for trial logs and wrenches
+#include "daq_stream.hpp"
+#include "trial_log.hpp"
+#include "wrench_reader.hpp"
+#include "settle_detector.hpp"
+
+// other misc standard libraries
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+/*
+Recorded trial shared by the replay devices
+*/
+class ReplayLog
+{
+private:
+	// log variables
+	TrialLogData				data_;
+	std::atomic<std::size_t>	cursor_;	// sample being played
+
+public:
+	// constructor
+	ReplayLog();
+
+	// log functions
+	bool	Open(const std::string &filepath);
+	bool	Load(const TrialLogData &data);
+	void	Rewind();
+	bool	Advance();
+
+	// sample functions
+	bool				IsFinished() const;
+	std::size_t			GetCursor() const;
+	std::size_t			GetSampleCount() const;
+	double				GetValue(int channel) const;
+	double				GetValue(std::size_t row, int channel) const;
+	const TrialLogInfo&	GetInfo() const;
+};
+
+/*
+Replayed DAQ, one recorded sample of both wrenches per update
+*/
+class ReplayDaq
+{
+private:
+	// member variables
+	ReplayLog&			log_;
+	std::vector<double>	values_;	// FxA..TzA, FxB..TzB of the current sample
+	DaqBlock			block_;
+	bool				exhausted_;	// last sample has been played
+
+public:
+	// constructor
+	explicit ReplayDaq(ReplayLog &log);
+
+	// DAQ update functions
+	bool update();
+
+	// acquisition mode functions
+	bool			Restart();
+	bool			IsBuffered() const;
+	unsigned int	GetBlockSize() const;
+
+	// scan and block functions
+	const double*		GetScanValues();
+	const DaqBlock&		GetBlock() const;
+	const double*		GetBlockValues() const;
+};
+
+/*
+Replayed encoders, latching the recorded motor positions
+*/
+class ReplayEncoders
+{
+private:
+	// member variables
+	ReplayLog&	log_;
+	double		position_[2];
+	double		time_;		// recorded time of the latched sample in seconds
+
+public:
+	// constructor
+	explicit ReplayEncoders(ReplayLog &log);
+
+	// encoder functions
+	bool	update_input();
+	double	GetPosition(int motor) const;
+	double	GetTime() const;
+	bool	IsFinished() const;
+};
+
+/*
+Replayed motor, reporting the latched recorded position
+*/
+class ReplayMotor
+{
+private:
+	// member variables
+	ReplayEncoders&	encoders_;
+	int				motor_;
+	double			desired_position_;
+	SettleDetector	settle_;
+
+public:
+	// constructor
+	ReplayMotor(ReplayEncoders &encoders, int motor);
+
+	// device parameter functions
+	void	SetSettleConfig(const SettleConfig &config);
+
+	// movement functions
+	void	Move(double desired_position);
+	void	GetPosition(double& position);
+	bool	TargetReached();
+};
+
+/*
+Pass through transform for replayed wrenches, which are
+already in force/torque units
+*/
+class ReplayTransform
+{
+private:
+	// member variables
+	std::array<Wrench, 2>	wrenches_;
+
+public:
+	// constructor
+	ReplayTransform();
+
+	// update functions
+	void	Update(const double* values);
+	void	UpdateBlock(const double* values, std::size_t scans, Wrench* wrenches) const;
+
+	// accessor functions
+	void		GetWrenches(Wrench* wrenches) const;
+	std::size_t	GetSensorCount() const;
+};
+#endif
@@ -0,0 +1,109 @@
+/*
+File: response_journal.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines an append-only write-ahead journal for the ABS
+responses of a subject. Each response is written as one
+fixed-size record as soon as it is given and a background
+thread syncs batches of records to disk within a couple of
+milliseconds. Responses that have not yet been compacted
+into the ABS data CSV are kept in memory so compaction only
+ever touches new rows.
+*/
+
+#ifndef RESPONSEJOURNAL
+#define RESPONSEJOURNAL
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int					kJournalColumns_(6);	// columns of a single ABS response row
+const std::uint32_t			kJournalResponse_(1);	// record holds a response
+const std::uint32_t			kJournalCompacted_(2);	// record marks compaction into the CSV
+const std::chrono::microseconds	kJournalSyncDelay_(1000);	// time allowed for records to batch up before a sync
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// single fixed-size journal record
+struct JournalRecord
+{
+	std::uint32_t	type;
+	std::uint32_t	checksum;
+	std::uint64_t	sequence;	// row number of the response in the ABS data
+	double			values[kJournalColumns_];
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class ResponseJournal
+{
+private:
+	// file variables
+	std::FILE*		file_;
+	std::uint64_t	next_sequence_;
+	std::uint64_t	compacted_sequence_;
+	std::int64_t	compacted_offset_;	// position of the last compaction marker
+	std::array<double, kJournalColumns_>	last_response_;
+	bool			has_last_response_;
+	std::vector<std::array<double, kJournalColumns_>>	uncompacted_;
+
+	// sync thread variables
+	std::thread					sync_thread_;
+	std::mutex					mutex_;
+	std::condition_variable		dirty_ready_;
+	bool						running_;
+	bool						dirty_;
+	unsigned long				failed_syncs_;
+
+	// journal record functions
+	bool	WriteRecord(std::uint32_t type, std::uint64_t sequence, const double* values);
+	bool	ReplayRecords(std::int64_t offset);
+
+	// sync thread functions
+	void	SyncLoop();
+
+public:
+	// constructor
+	ResponseJournal();
+	~ResponseJournal();
+
+	// file control functions
+	bool	Open(const std::string &filepath, std::uint64_t compacted_rows, std::int64_t replay_offset = 0);
+	void	Sync();
+	void	Close();
+
+	// response functions
+	bool			Append(const std::vector<double> &row);
+	std::uint64_t	GetNextSequence();
+	bool			GetLastResponse(std::vector<double> &row);
+
+	// compaction functions
+	std::uint64_t	GetCompactedSequence();
+	std::int64_t	GetCompactedOffset();
+	void			GetUncompacted(std::vector<std::vector<double>> &rows);
+	bool			MarkCompacted();
+
+	// statistic functions
+	unsigned long	GetFailedSyncs();
+};
+#endif
@@ -0,0 +1,143 @@
+/*
+File: sample_buffer.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines a fixed-capacity, struct-of-arrays buffer that holds
+the samples logged during a movement trial. Each of the
+logged fields has its own typed column. All memory is
+allocated once when the buffer is sized so that the 1 kHz
+control loop never touches the heap. Each sample carries the
+time it was acquired and the motor positions published at
+that moment, in the last column so logs written before it
+keep their channel numbers.
+*/
+
+#ifndef SAMPLEBUFFER
+#define SAMPLEBUFFER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <array>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const int			kSampleChannels_(18);		// number of logged fields per sample
+const std::size_t	kSampleBufferCapacity_(20000);	// 20 s of samples at 1 kHz
+const std::array<std::string, kSampleChannels_> kSampleChannelNames_ =
+	{
+	"Samples",
+	// Motor/Sensor A
+	"Position A Desired", "Position A Actual",
+	"FxA", "FyA", "FzA",
+	"TxA", "TyA", "TzA",
+	// Motor/Sensor B
+	"Position B Desired", "Position B Actual",
+	"FxB", "FyB", "FzB",
+	"TxB", "TyB", "TzB",
+	// acquisition time since the trial started
+	"Time"
+	};
+const std::array<std::string, kSampleChannels_> kSampleChannelUnits_ =
+	{
+	"count",
+	// Motor/Sensor A
+	"deg", "deg",
+	"N", "N", "N",
+	"Nm", "Nm", "Nm",
+	// Motor/Sensor B
+	"deg", "deg",
+	"N", "N", "N",
+	"Nm", "Nm", "Nm",
+	// acquisition time since the trial started
+	"s"
+	};
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// force/torque of both sensors at a single sampling instant
+struct FtSample
+{
+	double	time;					// seconds since the trial started
+	double	position_desired[2];	// motor positions published when the scan was taken
+	double	position_actual[2];
+	double	force_a[3];
+	double	torque_a[3];
+	double	force_b[3];
+	double	torque_b[3];
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class SampleBuffer
+{
+private:
+	// buffer bookkeeping
+	std::size_t capacity_;
+	std::size_t size_;
+	std::size_t dropped_;
+
+	// sample counter column
+	std::vector<unsigned int> sample_;
+
+	// Motor/Sensor A columns
+	std::vector<double> position_desired_a_,	position_actual_a_;
+	std::vector<double> force_x_a_,	force_y_a_,	force_z_a_;
+	std::vector<double> torque_x_a_,	torque_y_a_,	torque_z_a_;
+
+	// Motor/Sensor B columns
+	std::vector<double> position_desired_b_,	position_actual_b_;
+	std::vector<double> force_x_b_,	force_y_b_,	force_z_b_;
+	std::vector<double> torque_x_b_,	torque_y_b_,	torque_z_b_;
+
+	// acquisition time column
+	std::vector<double> time_;
+
+public:
+	// constructor
+	SampleBuffer(std::size_t capacity = kSampleBufferCapacity_);
+	~SampleBuffer();
+
+	// buffers are handed between threads by move only
+	SampleBuffer(SampleBuffer&& other);
+	SampleBuffer& operator=(SampleBuffer&& other);
+	SampleBuffer(const SampleBuffer&) = delete;
+	SampleBuffer& operator=(const SampleBuffer&) = delete;
+
+	// memory management functions
+	void	Reserve(std::size_t capacity);
+	void	Clear();
+
+	// sample logging functions
+	bool	Append(unsigned int sample,
+				   double position_desired_a,	double position_actual_a,
+				   const double* force_a,		const double* torque_a,
+				   double position_desired_b,	double position_actual_b,
+				   const double* force_b,		const double* torque_b,
+				   double time);
+
+	// buffer state functions
+	std::size_t	GetSize() const;
+	std::size_t	GetCapacity() const;
+	std::size_t	GetDropped() const;
+	bool		IsFull() const;
+
+	// sample access functions
+	const unsigned int*	GetSampleColumn() const;
+	const double*		GetColumn(int channel) const;
+	double	GetValue(std::size_t row, int channel) const;
+	void	GetRow(std::size_t row, std::vector<double> &output_row) const;
+	void	GetRows(std::vector<std::vector<double>> &output_rows) const;
+};
+#endif
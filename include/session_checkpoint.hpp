@@ -0,0 +1,80 @@
+/*
+File: session_checkpoint.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the small checkpoint record used to resume an ABS
+session. The record holds the last completed trial, the
+trialList seed and where the response journal was last
+compacted, so a session can be resumed without reading the
+ABS data file. The checkpoint file keeps two slots that are
+written alternately, so a write cut short by a crash always
+leaves the previous checkpoint intact.
+*/
+
+#ifndef SESSIONCHECKPOINT
+#define SESSIONCHECKPOINT
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::uint32_t kCheckpointMagic_(0x4B434241);	// "ABCK"
+const std::uint32_t kCheckpointVersion_(1);
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// resume point of an ABS session
+struct SessionCheckpoint
+{
+	std::uint32_t	magic;
+	std::uint32_t	version;
+	std::uint64_t	generation;		// increases with every write
+	std::int32_t	subject;
+	std::int32_t	iteration;		// last completed trial
+	std::int32_t	condition;
+	std::int32_t	angle_index;
+	std::uint32_t	seed;			// seed of the trialList scramble
+	std::uint32_t	reserved;
+	std::uint64_t	response_count;	// responses journaled so far
+	std::uint64_t	compacted_rows;	// responses saved in the ABS data file
+	std::int64_t	journal_offset;	// journal position after the last compaction
+	std::uint32_t	has_trial;		// set once a trial has been completed
+	std::uint32_t	checksum;
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class CheckpointFile
+{
+private:
+	// file variables
+	std::FILE*		file_;
+	std::uint64_t	generation_;
+
+public:
+	// constructor
+	CheckpointFile();
+	~CheckpointFile();
+
+	// file control functions
+	bool	Open(const std::string &filepath);
+	void	Close();
+
+	// checkpoint functions
+	bool	Read(SessionCheckpoint &checkpoint);
+	bool	Write(SessionCheckpoint &checkpoint);
+};
+#endif
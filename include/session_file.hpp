@@ -0,0 +1,120 @@
+/*
+File: session_file.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the single-file session container that holds every
+trial of a subject. Trials are appended as binary trial
+logs and a trailing index (iteration, condition, angle
+index, offset) lets a single trial be read by seeking to
+it. If a session was not closed cleanly the index is
+rebuilt by walking the trial records, so an interrupted
+session can be reopened and resumed.
+*/
+
+#ifndef SESSIONFILE
+#define SESSIONFILE
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial log format
+#include "sample_buffer.hpp"
+#include "trial_log.hpp"
+
+// other misc standard libraries
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const char			kSessionMagic_[8] =			{ 'A','I','M','S','S','E','S','\0' };
+const char			kSessionRecordMagic_[4] =	{ 'T','R','L','\0' };
+const char			kSessionIndexMagic_[8] =	{ 'A','I','M','S','I','D','X','\0' };
+const char			kSessionFooterMagic_[8] =	{ 'A','I','M','S','E','N','D','\0' };
+const std::uint32_t	kSessionVersion_(1);
+const std::string	kSessionExtension_(".fts");
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// index entry pointing at a single trial record
+struct SessionIndexEntry
+{
+	std::int32_t	iteration;
+	std::int32_t	condition;
+	std::int32_t	angle_index;
+	std::int32_t	reserved;
+	std::int64_t	offset;		// start of the trial log in the file
+	std::uint64_t	bytes;		// size of the trial log
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+/*
+Appends trials to a session container
+*/
+class SessionWriter
+{
+private:
+	// file variables
+	std::FILE*						file_;
+	std::string						filepath_;
+	std::int64_t					data_end_;	// end of the last trial record
+	std::vector<SessionIndexEntry>	index_;
+
+public:
+	// constructor
+	SessionWriter();
+	~SessionWriter();
+
+	// file control functions
+	bool	Open(const std::string &filepath, int subject);
+	bool	Append(const TrialLogInfo &info, const SampleBuffer &buffer);
+	bool	Commit();
+	bool	Sync();
+	bool	Close();
+	bool	IsOpen() const;
+
+	// index functions
+	std::size_t	GetTrialCount() const;
+};
+
+/*
+Reads single trials out of a session container
+*/
+class SessionReader
+{
+private:
+	// file variables
+	std::FILE*						file_;
+	std::int32_t					subject_;
+	std::vector<SessionIndexEntry>	index_;
+
+public:
+	// constructor
+	SessionReader();
+	~SessionReader();
+
+	// file control functions
+	bool	Open(const std::string &filepath);
+	void	Close();
+
+	// index functions
+	int								GetSubject() const;
+	std::size_t						GetTrialCount() const;
+	const SessionIndexEntry&		GetEntry(std::size_t index) const;
+	bool							FindTrial(int iteration, SessionIndexEntry &entry) const;
+
+	// trial read functions
+	bool	ReadTrial(const SessionIndexEntry &entry, TrialLogData &data);
+	bool	ReadTrial(int iteration, TrialLogData &data);
+};
+#endif
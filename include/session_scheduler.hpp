@@ -0,0 +1,118 @@
+/*
+File: session_scheduler.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the session scheduler pacing trials and samples on
+absolute deadlines of one monotonic clock. The session is
+laid out on a grid of sample instants from its start, every
+stimulus onset lands on that grid, and every sample of a
+trial is due a whole number of sample periods after its
+onset. Nothing is restarted between trials or position
+steps, so waiting never adds phase error and intervals stay
+exact however long the session runs. How late each deadline
+was actually met is recorded for the end of session summary.
+*/
+
+#ifndef SESSIONSCHEDULER
+#define SESSIONSCHEDULER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the lateness histograms
+#include "driver_latency.hpp"
+
+// other misc standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t	kScheduleReservedTrials_(4096);		// trial entries reserved up front, more than a session
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// deadlines of a single trial, in seconds since the session start
+struct ScheduleEntry
+{
+	double	onset =				0.0;	// when the stimulus was due
+	double	onset_lateness =	0.0;	// how late the onset was met
+	double	end =				0.0;	// when the trial was due to end
+	double	end_lateness =		0.0;	// how late the end was met
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class SessionScheduler
+{
+public:
+	// monotonic clock every deadline is taken on
+	typedef std::chrono::steady_clock			Clock;
+	typedef std::chrono::steady_clock::time_point	TimePoint;
+
+	// sample instants of a single trial, one per waiting thread
+	class SampleClock
+	{
+	private:
+		SessionScheduler*	scheduler_;
+		TimePoint			next_;
+
+	public:
+		SampleClock();
+		SampleClock(SessionScheduler &scheduler, TimePoint onset);
+
+		std::uint64_t	Wait();
+	};
+
+private:
+	// schedule variables
+	TimePoint			origin_;
+	Clock::duration		sample_period_;
+	Clock::duration		trial_period_;	// shortest time from one onset to the next
+	TimePoint			onset_;
+	bool				has_onset_;
+	std::vector<ScheduleEntry>	entries_;
+
+	// lateness variables
+	LatencyHistogram			onset_lateness_;
+	LatencyHistogram			sample_lateness_;
+	LatencyHistogram			end_lateness_;
+	std::atomic<std::uint64_t>	missed_samples_;
+
+	// schedule functions
+	TimePoint				GetGridPoint(TimePoint time) const;
+	double					GetSeconds(TimePoint time) const;
+
+public:
+	// constructor
+	SessionScheduler(double sample_rate, double trial_seconds);
+
+	// session functions
+	void	Start();
+	double	GetElapsed() const;
+
+	// trial functions
+	TimePoint	WaitForOnset();
+	SampleClock	GetSampleClock();
+	void		WaitForTrialEnd();
+
+	// statistic functions
+	const std::vector<ScheduleEntry>&	GetEntries() const;
+	const LatencyHistogram&				GetOnsetLateness() const;
+	const LatencyHistogram&				GetSampleLateness() const;
+	const LatencyHistogram&				GetEndLateness() const;
+	std::uint64_t						GetMissedSamples() const;
+	double								GetSamplePeriod() const;
+};
+#endif
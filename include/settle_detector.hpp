@@ -0,0 +1,83 @@
+/*
+File: settle_detector.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the settle detector deciding when a motor has
+finished a move. Each encoder reading updates a filtered
+velocity estimate, and the move counts as finished once the
+position has stayed within tolerance of the target at close
+to zero velocity for a dwell time. The position tolerance is
+picked from the size of the move, so large moves are not cut
+short and small moves do not end on a single pass through
+the target. Every motor holds its own configuration.
+*/
+
+#ifndef SETTLEDETECTOR
+#define SETTLEDETECTOR
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// tolerances deciding when a move has settled, in encoder counts and seconds
+struct SettleConfig
+{
+	double	large_move =			1000.0;	// moves this many counts or longer use the large tolerance
+	double	small_tolerance =		5.0;	// counts from the target allowed after a small move
+	double	large_tolerance =		500.0;	// counts from the target allowed after a large move
+	double	velocity_tolerance =	1000.0;	// counts/s the filtered velocity must stay below
+	double	velocity_filter =		0.001;	// time constant of the velocity filter in seconds
+	double	dwell =					0.003;	// seconds the motor must stay settled
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class SettleDetector
+{
+private:
+	// configuration variables
+	SettleConfig	config_;
+
+	// move variables
+	double	target_;
+	double	tolerance_;
+	bool	settled_;
+
+	// velocity estimate variables
+	bool	has_sample_;
+	double	last_position_;
+	double	last_time_;
+	double	velocity_;
+
+	// dwell variables
+	bool	in_window_;
+	double	window_start_;
+
+public:
+	// constructor
+	explicit SettleDetector(const SettleConfig &config = SettleConfig());
+
+	// configuration functions
+	void				SetConfig(const SettleConfig &config);
+	const SettleConfig&	GetConfig() const;
+
+	// detection functions
+	void	Start(double target, double start_position);
+	bool	Update(double position, double time);
+
+	// accessor functions
+	bool	IsSettled() const;
+	double	GetTarget() const;
+	double	GetTolerance() const;
+	double	GetVelocity() const;
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// monotonic time in seconds for timestamping encoder readings
+double	GetSettleClock();
+#endif
@@ -0,0 +1,216 @@
+/*
+File: sim_devices.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines simulated stand-ins for the testbed hardware so the
+control loop can be run and profiled without the rig. Each
+class mirrors the calls the loop makes on its real
+counterpart: SimMotor follows the EPOS trapezoidal position
+profile of a MaxonMotor, SimQ8 latches encoder counts like
+the Q8 USB, and SimDaq reads force/torque voltages through
+DaqStream on the mock DAQmx layer. SimPlant supplies those
+voltages from a linear skin model driven by the motor
+angles. None of these depend on MEL or the vendor drivers.
+*/
+
+#ifndef SIMDEVICES
+#define SIMDEVICES
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the DAQmx task and drive train constants
+#ifndef AIMS_MOCK_DAQMX
+#error "The simulated devices require the mock DAQmx layer (AIMS_MOCK_DAQMX)"
+#endif
+#include "daq_stream.hpp"
+#include "motor_constants.hpp"
+#include "ati_transform.hpp"
+#include "settle_detector.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const double	kSimSkinStiffness_(0.05);	// tangential N per degree of tactor rotation
+const double	kSimTorqueArm_(0.005);		// m from the sensor to the skin contact
+const double	kSimPreload_(1.0);			// N pressing the tactor into the skin
+const double	kSimGaugeGain_(10.0);		// N or Nm per volt of the simulated calibration
+const double	kSimNoise_(0.002);			// V of gauge noise
+const int		kSimEncoders_(2);
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+/*
+Trapezoidal position profile of a single EPOS controller
+*/
+class SimProfile
+{
+private:
+	// profile variables
+	mutable std::mutex	mutex_;
+	double				start_counts_;
+	double				target_counts_;
+	double				velocity_;		// counts/s
+	double				acceleration_;	// counts/s^2
+	double				deceleration_;	// counts/s^2
+	std::chrono::steady_clock::time_point	start_time_;
+
+public:
+	// constructor
+	SimProfile();
+
+	// profile functions
+	void	SetLimits(unsigned int velocity, unsigned int acceleration, unsigned int deceleration);
+	void	MoveTo(double target_counts);
+	double	GetCounts() const;
+	double	GetCounts(std::chrono::steady_clock::time_point time) const;
+};
+
+/*
+Single simulated encoder channel of the Q8 USB
+*/
+class SimEncoderChannel
+{
+private:
+	// encoder variables
+	const SimProfile*	profile_;
+	double				counts_;
+	double				offset_;
+
+public:
+	// constructor
+	SimEncoderChannel();
+
+	// encoder functions
+	void	Attach(const SimProfile* profile);
+	void	update();
+	void	zero();
+	double	get_value() const;
+};
+
+/*
+Simulated Q8 USB, latching encoder counts on update_input
+*/
+class SimQ8
+{
+public:
+	// encoder channels
+	SimEncoderChannel	encoder[kSimEncoders_];
+
+	// device functions
+	bool	open();
+	bool	enable();
+	bool	update_input();
+	bool	disable();
+	bool	close();
+};
+
+/*
+Simulated Maxon motor and EPOS controller
+*/
+class SimMotor
+{
+private:
+	// device variables
+	SimEncoderChannel&	encoder_;
+	SimProfile			profile_;
+
+	// control parameter variables
+	unsigned int desired_velocity_;
+	unsigned int desired_acceleration_;
+	unsigned int desired_deceleration_;
+
+	// position variables
+	double desired_position_;
+	double actual_position_;
+	SettleDetector settle_;
+
+public:
+	// constructor
+	explicit SimMotor(SimEncoderChannel &encoder);
+
+	// device connection functions
+	void	Start();
+	void	End();
+
+	// device parameter functions
+	void	SetPort(char* port);
+	void	SetControlParam(unsigned int desired_velocity,
+							unsigned int desired_acceleration,
+							unsigned int desired_deceleration);
+	void	SetSettleConfig(const SettleConfig &config);
+
+	// movement functions
+	void	Move(double desired_position);
+	void	GetPosition(double& position);
+	bool	TargetReached();
+
+	// plant functions
+	double	GetAngle() const;
+};
+
+/*
+Force/torque model of the tactors pressed against the skin
+*/
+class SimPlant
+{
+private:
+	// plant variables
+	const SimMotor*	motor_a_;
+	const SimMotor*	motor_b_;
+
+public:
+	// constructor
+	SimPlant(const SimMotor &motor_a, const SimMotor &motor_b);
+	~SimPlant();
+
+	// model functions
+	void		Attach();
+	void		Detach();
+	double		GetVoltage(int channel, double time) const;
+	static void	GetCalibration(double matrix[kAtiAxes_][kAtiAxes_]);
+};
+
+/*
+Simulated NI DAQ, reading the force/torque channels through
+DaqStream on the mock DAQmx layer
+*/
+class SimDaq
+{
+private:
+	// member variables
+	DaqStream			stream_;
+	std::vector<double>	values_;		// channels of the last scan
+	std::vector<double>	block_values_;	// scans of the last block, grouped by scan
+	DaqBlock			block_;
+
+public:
+	// constructor
+	SimDaq();
+	~SimDaq();
+
+	// DAQ update functions
+	bool update();
+
+	// acquisition mode functions
+	bool			StartBuffered(double sample_rate, unsigned int block_size);
+	bool			StartOnDemand();
+	bool			Restart();
+	bool			IsBuffered() const;
+	unsigned int	GetBlockSize() const;
+
+	// scan and block functions
+	const double*		GetScanValues();
+	const DaqBlock&		GetBlock() const;
+	const double*		GetBlockValues() const;
+};
+#endif
@@ -0,0 +1,154 @@
+/*
+File: spsc_ring.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines a fixed-capacity ring buffer for handing values from
+exactly one producer thread to exactly one consumer thread.
+Pushing and popping never block or allocate; each side only
+writes its own index and reads the other's, so neither thread
+can ever be held up by the other. A push into a full ring is
+refused and counted instead of waiting.
+*/
+
+#ifndef SPSCRING
+#define SPSCRING
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t kCacheLineBytes_(64);	// keeps the two indices off each other's cache line
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+template <typename T>
+class SpscRing
+{
+private:
+	// storage variables
+	std::vector<T>				slots_;
+	std::size_t					mask_;
+	char						storage_pad_[kCacheLineBytes_];
+
+	// producer variables
+	std::atomic<std::size_t>	head_;		// next slot to write
+	std::size_t					tail_cache_;	// last tail seen by the producer
+	std::atomic<unsigned long>	dropped_;
+	char						producer_pad_[kCacheLineBytes_];
+
+	// consumer variables
+	std::atomic<std::size_t>	tail_;		// next slot to read
+	std::size_t					head_cache_;	// last head seen by the consumer
+	char						consumer_pad_[kCacheLineBytes_];
+
+public:
+	/*
+	Constructor for the SpscRing class. The capacity is rounded
+	up to a power of two.
+	 */
+	explicit SpscRing(std::size_t capacity) :
+		mask_(0),
+		head_(0),
+		tail_cache_(0),
+		dropped_(0),
+		tail_(0),
+		head_cache_(0)
+	{
+		std::size_t size = 2;
+		while (size < capacity) size <<= 1;
+		slots_.resize(size);
+		mask_ = size - 1;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	/*
+	Copies a value into the ring. Only called by the producer.
+	Returns false and counts a drop if the ring is full.
+	 */
+	bool TryPush(const T &value)
+	{
+		std::size_t head = head_.load(std::memory_order_relaxed);
+		if (head - tail_cache_ > mask_)
+		{
+			tail_cache_ = tail_.load(std::memory_order_acquire);
+			if (head - tail_cache_ > mask_)
+			{
+				dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+		slots_[head & mask_] = value;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	Copies the oldest value out of the ring. Only called by the
+	consumer. Returns false if the ring is empty.
+	 */
+	bool TryPop(T &value)
+	{
+		std::size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail == head_cache_)
+		{
+			head_cache_ = head_.load(std::memory_order_acquire);
+			if (tail == head_cache_)
+				return false;
+		}
+		value = slots_[tail & mask_];
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	Empties the ring and its drop count. Only safe while
+	neither thread is using the ring.
+	 */
+	void Reset()
+	{
+		head_.store(0);
+		tail_.store(0);
+		tail_cache_ = 0;
+		head_cache_ = 0;
+		dropped_.store(0);
+	}
+
+	/*
+	Returns the number of values waiting in the ring. Only exact
+	when called by one of the two threads.
+	 */
+	std::size_t GetSize() const
+	{
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+
+	/*
+	Returns the number of values the ring can hold
+	 */
+	std::size_t GetCapacity() const
+	{
+		return mask_ + 1;
+	}
+
+	/*
+	Returns the number of pushes refused because the ring was full
+	 */
+	unsigned long GetDropped() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+};
+#endif
@@ -0,0 +1,87 @@
+/*
+File: trace.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines an optional timeline trace of a session, saved in
+the trace event JSON format read by Perfetto and
+chrome://tracing. Spans are recorded with TraceSpan, which
+times its own scope. Each thread appends to its own event
+buffer so recording takes no lock and never moves the
+events already recorded, and when tracing is off
+a span costs a single flag check. Span names must be string
+literals, since only the pointer is kept until the trace is
+written.
+*/
+
+#ifndef TRACE
+#define TRACE
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// other misc standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t	kTraceChunkEvents_(1 << 16);	// events per chunk of a thread's buffer, the first allocated when it first traces
+const std::size_t	kTraceMaxEvents_(1 << 21);		// events kept per thread before dropping
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// trace control functions
+void			StartTrace();
+bool			WriteTrace(const std::string &filepath);
+unsigned long	GetTraceDropped();
+
+// thread functions
+void			SetTraceThreadName(const char* name);
+
+// recording functions
+std::int64_t	GetTraceTime();
+void			RecordTraceSpan(const char* name, const char* category, std::int64_t start, std::int64_t end);
+
+// flag checked by every span, set while a trace is being recorded
+extern std::atomic<bool> trace_enabled;
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+/*
+Records the time spent in its scope as a trace span
+*/
+class TraceSpan
+{
+private:
+	const char*		name_;
+	const char*		category_;
+	std::int64_t	start_;
+
+public:
+	explicit TraceSpan(const char* name, const char* category = "aims") :
+		name_(name),
+		category_(category),
+		start_(trace_enabled.load(std::memory_order_relaxed) ? GetTraceTime() : -1)
+	{
+	}
+
+	~TraceSpan()
+	{
+		if (start_ >= 0)
+			RecordTraceSpan(name_, category_, start_, GetTraceTime());
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+};
+#endif
@@ -0,0 +1,92 @@
+/*
+File: trial_log.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the binary columnar trial log format used to save
+force/torque trial data. Each log starts with a self
+describing header (subject, iteration, condition, sample
+rate and the name, unit and type of every channel) followed
+by each channel stored as one contiguous column. The header
+ends with the supervision loop timing of the trial, which
+readers that do not know it skip. Values are stored in the
+native little-endian layout of the rig PC.
+*/
+
+#ifndef TRIALLOG
+#define TRIALLOG
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial sample buffer and loop timing
+#include "sample_buffer.hpp"
+#include "loop_timing.hpp"
+
+// other misc standard libraries
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const char			kTrialLogMagic_[8] = { 'A','I','M','S','F','T','B','\0' };
+const char			kTrialLogTimingTag_[4] = { 'T','I','M','\0' };
+const std::uint32_t	kTrialLogVersion_(1);
+const std::string	kTrialLogExtension_(".ftb");
+
+// channel storage types
+const std::uint8_t	kTrialLogUInt32_(1);
+const std::uint8_t	kTrialLogFloat64_(2);
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// identifies the trial a log belongs to
+struct TrialLogInfo
+{
+	std::int32_t	subject =		0;
+	std::int32_t	iteration =		0;
+	std::int32_t	condition =		0;
+	std::int32_t	angle_index =	0;
+	double			sample_rate =	0.0;
+	std::string		trial_name;
+	LoopTimingStats	timing;		// supervision loop timing, no ticks if not recorded
+};
+
+// single channel read back from a log
+struct TrialLogChannel
+{
+	std::string			name;
+	std::string			unit;
+	std::uint8_t		type;
+	std::vector<double>	values;
+};
+
+// full trial read back from a log
+struct TrialLogData
+{
+	TrialLogInfo					info;
+	std::uint64_t					sample_count;
+	std::vector<TrialLogChannel>	channels;
+};
+
+
+/***********************************************************
+***************** FUNCTION DECLARATIONS ********************
+************************************************************/
+// write functions
+bool	WriteTrialLog(std::FILE* file, const TrialLogInfo &info, const SampleBuffer &buffer);
+bool	WriteTrialLog(const std::string &filepath, const TrialLogInfo &info, const SampleBuffer &buffer);
+
+// read functions
+bool	ReadTrialLog(std::FILE* file, TrialLogData &data);
+bool	ReadTrialLog(const std::string &filepath, TrialLogData &data);
+
+// conversion functions
+void	GetTrialLogRows(const TrialLogData &data, std::vector<std::vector<double>> &output_rows);
+#endif
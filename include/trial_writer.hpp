@@ -0,0 +1,114 @@
+/*
+File: trial_writer.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines a background writer that saves completed movement
+trials to disk on its own I/O thread. Trial buffers are
+handed to the writer by move through a bounded queue and
+returned to a small pool once written, so recording the
+next trial never waits on the disk.
+*/
+
+#ifndef TRIALWRITER
+#define TRIALWRITER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial sample buffer and trial file formats
+#include "sample_buffer.hpp"
+#include "trial_log.hpp"
+#include "session_file.hpp"
+
+// other misc standard libraries
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t kTrialWriterBuffers_(2); // one trial recording while one is written
+
+// file formats the writer can save trials in
+enum class TrialFormat
+{
+	Csv,	// one text CSV per trial
+	Binary,	// one binary columnar trial log per trial
+	Session	// every trial appended to one session container
+};
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class TrialWriter
+{
+private:
+	// queued trial waiting to be written
+	struct TrialJob
+	{
+		std::string		filepath;
+		TrialLogInfo	info;
+		TrialFormat		format;
+		SampleBuffer	buffer;
+	};
+
+	// buffer pool and bounded job queue
+	std::vector<SampleBuffer>	free_buffers_;
+	std::deque<TrialJob>		jobs_;
+	std::size_t					buffer_count_;
+	std::size_t					buffer_capacity_;
+	TrialFormat					format_;
+	SessionWriter				session_;
+
+	// thread variables
+	std::thread					thread_;
+	std::mutex					mutex_;
+	std::condition_variable		job_ready_;
+	std::condition_variable		buffer_ready_;
+	std::condition_variable		idle_;
+	bool						running_;
+	bool						writing_;
+
+	// statistic variables
+	unsigned int				trials_written_;
+	unsigned int				failed_writes_;
+
+	// writer thread functions
+	void	WriterLoop();
+	bool	WriteTrial(const TrialJob &job);
+
+public:
+	// constructor
+	TrialWriter(std::size_t buffer_count = kTrialWriterBuffers_,
+				std::size_t buffer_capacity = kSampleBufferCapacity_);
+	~TrialWriter();
+
+	// writer parameter functions
+	void		SetFormat(TrialFormat format);
+	TrialFormat	GetFormat();
+	std::string	GetExtension();
+	bool		OpenSession(const std::string &filepath, int subject);
+	std::size_t	GetSessionTrialCount();
+
+	// thread control functions
+	void	Start();
+	void	Flush();
+	void	Stop();
+
+	// buffer handoff functions
+	SampleBuffer	AcquireBuffer();
+	void			ReleaseBuffer(SampleBuffer &&buffer);
+	void			Submit(const std::string &filepath, const TrialLogInfo &info, SampleBuffer &&buffer);
+
+	// statistic functions
+	unsigned int	GetTrialsWritten();
+	unsigned int	GetFailedWrites();
+};
+#endif
@@ -0,0 +1,68 @@
+/*
+File: wrench_reader.hpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+Defines the WrenchReader class which gives the forces and
+torques of the ATI sensors without allocating. It takes the
+place of MEL's AtiSensor get_forces/get_torques, which return
+a new vector on every call. Wrenches are fixed-size arrays
+read either as views of the reader's latest values or copied
+into caller-owned storage, for every sensor in one call.
+*/
+
+#ifndef WRENCHREADER
+#define WRENCHREADER
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the ATI calibration transform
+#include "ati_transform.hpp"
+
+// other misc standard libraries
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+************************ TYPES *****************************
+************************************************************/
+// force and torque of a single sensor: Fx, Fy, Fz, Tx, Ty, Tz
+typedef std::array<double, kAtiAxes_> Wrench;
+static_assert(sizeof(Wrench) == kAtiAxes_ * sizeof(double), "Wrench must be tightly packed");
+
+
+/***********************************************************
+****************** CLASS DECLARATION ***********************
+************************************************************/
+class WrenchReader
+{
+private:
+	// sensor variables
+	AtiTransform		transform_;
+	std::vector<Wrench>	wrenches_;	// latest wrench of each sensor
+
+public:
+	// constructor
+	WrenchReader();
+
+	// sensor setup functions
+	bool	AddSensor(const std::string &cal_filepath);
+	void	AddSensor(const double matrix[kAtiAxes_][kAtiAxes_]);
+	void	Zero(const double* voltages);
+
+	// update functions
+	void	Update(const double* voltages);
+	void	UpdateBlock(const double* voltages, std::size_t scans, Wrench* wrenches) const;
+
+	// accessor functions
+	const Wrench&	GetWrench(std::size_t sensor) const;
+	const double*	GetForces(std::size_t sensor) const;
+	const double*	GetTorques(std::size_t sensor) const;
+	void			GetWrenches(Wrench* wrenches) const;
+	std::size_t		GetSensorCount() const;
+};
+#endif
@@ -29,6 +29,9 @@ Staircase::Staircase()
 	// generate random ordering of conditions_
 	std::shuffle(conditions_.begin(), conditions_.end(), rng);
 
+	// the interference motor returns to zero after every cue by default
+	hold_interference_ = false;
+
     // set starting condition to the front
     condition_iterator_ = 0; // condition iterator
     condition_true_ = conditions_[condition_iterator_]; // true condition
@@ -138,9 +141,35 @@ void Staircase::GetTestPositions(std::array<std::array<double,2>,2> &position_de
 	else
 		test_positions = { angle_, GetInterferenceAngle() };		
 	
-	// attach zero position for motors to return to after cue
+	// attach zero position for motors to return to after cue,
+	// leaving the interference motor in place if it is held
 	position_desired[0] = test_positions;
 	position_desired[1] = { kZero_, kZero_ };
+	if (hold_interference_)
+	{
+		if (condition_true_ > 1)
+			position_desired[1][0] = test_positions[0];
+		else
+			position_desired[1][1] = test_positions[1];
+	}
+}
+
+/*
+Sets whether the interference motor stays at the
+interference angle between cues instead of returning to
+zero after each one
+*/
+void Staircase::SetHoldInterference(bool hold)
+{
+	hold_interference_ = hold;
+}
+
+/*
+Outputs whether the interference motor is held between cues
+*/
+bool Staircase::GetHoldInterference()
+{
+	return hold_interference_;
 }
 
 /***********************************************************
@@ -225,39 +254,17 @@ bool Staircase::SetConditionNum(int condition_num)
 
 
 /***********************************************************
-************************ UI FUNCTIONS **********************
+********************* RESPONSE FUNCTIONS *******************
 ************************************************************/
 /*
-Pauses advancement of the program until the specified
-keys are all released
+Updates the angle, step size and crossovers for a response
+to the most recent stimuli
 */
-void Staircase::WaitForKeyRelease(std::vector<mel::Key> keys)
+void Staircase::ApplyResponse(StaircaseResponse response)
 {
-	bool pressed = true;
-	while(pressed)
-	{
-		for(int i = 0; i < keys.size(); i++)
-		{
-			if(!mel::Keyboard::is_key_pressed(keys[i]))
-			{
-				pressed = false;
-			}
-			else
-				pressed = true;			
-		}
-	}
-}
-
-/*
-Reads in response from the user regarding the most recent
-stimuli
-*/
-bool Staircase::ReadInput()
-{    
-    mel::Keyboard::wait_for_any_keys(input_keys_);
-
-	if(mel::Keyboard::is_key_pressed(mel::Key::Add) || mel::Keyboard::is_key_pressed(mel::Key::Up))
+	switch (response)
 	{
+	case StaircaseResponse::Increase:
 		// increments or zeroes number of crossovers_ if neccesary
 		if(previous_angle_ > angle_)
 		{   
@@ -271,12 +278,9 @@ bool Staircase::ReadInput()
 			angle_ += step_;
 		else                        	
 			angle_ = kRangeMax_[condition_true_]; 
+		break;
 
-		// waits until key release before advancing
-		WaitForKeyRelease({mel::Key::Add, mel::Key::Up});
-	}
-	else if(mel::Keyboard::is_key_pressed(mel::Key::Subtract) || mel::Keyboard::is_key_pressed(mel::Key::Down))
-	{
+	case StaircaseResponse::Decrease:
 		// increments or zeroes number of crossovers_ if neccesary
 		if(previous_angle_ < angle_)   		
 		{   
@@ -290,30 +294,83 @@ bool Staircase::ReadInput()
 			angle_ -= step_;
 		else                			
 			angle_ = kRangeMin_;
+		break;
 
-		// waits until key release before advancing
-		WaitForKeyRelease({mel::Key::Subtract, mel::Key::Down});
-	}
-	else if(mel::Keyboard::is_key_pressed(mel::Key::Comma) || mel::Keyboard::is_key_pressed(mel::Key::Left))
-	{	
+	case StaircaseResponse::HalveStep:
 		// halves the step_ size if step_ size is to be reduced
         step_ /= 2; 
+		break;
 
-		// waits until key release before advancing
-		WaitForKeyRelease({mel::Key::Comma, mel::Key::Left});
-	}
-	else if(mel::Keyboard::is_key_pressed(mel::Key::Period) || mel::Keyboard::is_key_pressed(mel::Key::Right))
-	{
+	case StaircaseResponse::DoubleStep:
 		// doubles the step_ size if step_ size is to be increased
         step_ *= 2; 
+		break;
+	}
+}
 
-		// waits until key release before advancing
-		WaitForKeyRelease({mel::Key::Period, mel::Key::Right});
+
+/***********************************************************
+************************ UI FUNCTIONS **********************
+************************************************************/
+/*
+Returns the response a key stands for, or false for keys
+that are not responses
+*/
+bool Staircase::GetKeyResponse(KeyCode key, StaircaseResponse &response)
+{
+	switch(key)
+	{
+	case KeyCode::Add:
+	case KeyCode::Up:
+		response = StaircaseResponse::Increase;
+		return true;
+	case KeyCode::Subtract:
+	case KeyCode::Down:
+		response = StaircaseResponse::Decrease;
+		return true;
+	case KeyCode::Comma:
+	case KeyCode::Left:
+		response = StaircaseResponse::HalveStep;
+		return true;
+	case KeyCode::Period:
+	case KeyCode::Right:
+		response = StaircaseResponse::DoubleStep;
+		return true;
+	default:
+		return false;
 	}
-	else return false;
-	
+}
+
+/*
+Reads in response from the user regarding the most recent
+stimuli. Blocks on the key events until a response key is
+pressed and then released, so no key is polled.
+*/
+bool Staircase::ReadInput(KeyEventQueue &keys)
+{
+	// waits for a response key to be pressed
+	KeyEvent event;
+	StaircaseResponse response;
+	do
+	{
+		if(!keys.WaitForEvent(event))
+		{
+			keys.Ignore();
+			return false;
+		}
+	}
+	while(event.action != KeyAction::Press || !GetKeyResponse(event.key, response));
+	ApplyResponse(response);
+
+	// waits until key release before advancing
+	KeyCode key = event.key;
+	double pressed = event.time;
+	while(keys.WaitForEvent(event) && !(event.key == key && event.action == KeyAction::Release)) {}
+	keys.Ignore();
+
     // outputs the current angle_ and step_ size for debugging purposes
-	mel::print("Angle: " + std::to_string(angle_) + " Previous Angle: " + std::to_string(previous_angle_) + " Step: " + std::to_string(step_));
+	mel::print("Angle: " + std::to_string(angle_) + " Previous Angle: " + std::to_string(previous_angle_) + " Step: " + std::to_string(step_)
+		+ " Key held: " + std::to_string((event.time - pressed) * 1e3) + " ms");
     return true;
 }
 
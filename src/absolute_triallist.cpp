@@ -23,6 +23,12 @@ Constructor for the TrialList class
 */
 TrialList::TrialList()
 {
+	// no scramble has been made yet
+	seed_ = 0;
+
+	// the interference motor returns to zero after every cue by default
+	hold_interference_ = false;
+
 	// fill out trialArrs with angles
 	for (int condition_num = 0; condition_num < kNumberConditions_; condition_num++)
 	{
@@ -126,9 +132,10 @@ void TrialList::GetTestPositions(std::array<std::array<double,2>,2> &position_de
 		// mel::print("Squeeze");
 	}
 	*/
-	// attach zero position for motors to return to after cue
+	// attach zero position for motors to return to after cue,
+	// leaving the interference motor in place if it is held
 	position_desired[0] = test_positions;
-	position_desired[1] = { kZeroAngle_, kZeroAngle_ };
+	position_desired[1] = { kZeroAngle_, hold_interference_ ? interference_angle : kZeroAngle_ };
 }
 
 /*
@@ -144,9 +151,19 @@ int TrialList::GetIterationNumber(int condition, int angle)
 ****************** RANDOMIZER FUNCTION *********************
 ************************************************************/
 void TrialList::scramble()
+{
+	scramble(random_device_());
+}
+
+/*
+Randomizes the trial list from a known seed so the same
+ordering can be rebuilt when a session is resumed
+*/
+void TrialList::scramble(unsigned int seed)
 {
 	// create random range
-	auto rng = std::default_random_engine{ random_device_() };
+	seed_ = seed;
+	auto rng = std::default_random_engine{ seed_ };
 
 	// generate random ordering of angles_ in each of the conditions_
 	for (int i = 0; i < kNumberConditions_; i++) {
@@ -158,6 +175,15 @@ void TrialList::scramble()
 }
 
 
+/*
+Returns the seed used for the most recent scramble
+*/
+unsigned int TrialList::GetSeed()
+{
+	return seed_;
+}
+
+
 /***********************************************************
 ***************** TRIAL NAME FUNCTIONS *********************
 ************************************************************/
@@ -224,6 +250,24 @@ void TrialList::GetTestPositions(std::array<std::array<double,2>,2> &position_de
 	GetTestPositions(position_desired, conditions_[condition_iterator_], angle_iterator_);
 }
 
+/*
+Sets whether the interference motor stays at the
+interference angle between cues instead of returning to
+zero after each one
+*/
+void TrialList::SetHoldInterference(bool hold)
+{
+	hold_interference_ = hold;
+}
+
+/*
+Outputs whether the interference motor is held between cues
+*/
+bool TrialList::GetHoldInterference()
+{
+	return hold_interference_;
+}
+
 /*
 Calls private function to get current iteration number
 */
@@ -0,0 +1,239 @@
+/*
+File: ati_transform.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the AtiTransform class. The calibration
+matrix of each sensor is read from the UserAxis rows of its
+.cal file, the same rows MEL's AtiSensor uses. Each scan of
+voltages holds kAtiAxes_ channels per sensor in the order the
+sensors were added, and each wrench written out holds Fx, Fy,
+Fz, Tx, Ty, Tz per sensor in the same order.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "ati_transform.hpp"
+
+// libraries for the vector kernel
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// other misc standard libraries
+#include <fstream>
+#include <sstream>
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the AtiTransform class
+ */
+AtiTransform::AtiTransform() :
+	sensor_count_(0)
+{
+}
+
+
+/***********************************************************
+***************** CALIBRATION FUNCTIONS ********************
+************************************************************/
+/*
+Adds a sensor using the calibration matrix in its ATI .cal
+file. Returns false if the file does not hold all six
+UserAxis rows.
+ */
+bool AtiTransform::AddSensor(const std::string &cal_filepath)
+{
+	std::ifstream file(cal_filepath);
+	if (!file.is_open()) return false;
+
+	// reads the values of each UserAxis row in order
+	double	matrix[kAtiAxes_][kAtiAxes_];
+	int		row = 0;
+	std::string line_string;
+	while (row < kAtiAxes_ && getline(file, line_string))
+	{
+		if (line_string.find("<UserAxis") == std::string::npos) continue;
+		std::size_t values_start = line_string.find("values=\"");
+		if (values_start == std::string::npos) return false;
+		values_start += 8;
+		std::size_t values_end = line_string.find('"', values_start);
+		if (values_end == std::string::npos) return false;
+
+		std::istringstream value_stream(line_string.substr(values_start, values_end - values_start));
+		for (int column = 0; column < kAtiAxes_; column++)
+			if (!(value_stream >> matrix[row][column])) return false;
+		row++;
+	}
+	if (row != kAtiAxes_) return false;
+
+	AddSensor(matrix);
+	return true;
+}
+
+/*
+Adds a sensor with the given row-major calibration matrix
+ */
+void AtiTransform::AddSensor(const double matrix[kAtiAxes_][kAtiAxes_])
+{
+	// stores the matrix by column with the padding rows zeroed
+	std::size_t start = matrix_.size();
+	matrix_.resize(start + kAtiAxes_ * kAtiPaddedAxes_, 0.0);
+	for (int column = 0; column < kAtiAxes_; column++)
+		for (int row = 0; row < kAtiAxes_; row++)
+			matrix_[start + column * kAtiPaddedAxes_ + row] = matrix[row][column];
+
+	bias_.resize(bias_.size() + kAtiAxes_, 0.0);
+	sensor_count_++;
+}
+
+/*
+Takes a scan of voltages as the unloaded bias of every sensor
+ */
+void AtiTransform::Zero(const double* voltages)
+{
+	for (std::size_t channel = 0; channel < bias_.size(); channel++)
+		bias_[channel] = voltages[channel];
+}
+
+/*
+Removes every sensor
+ */
+void AtiTransform::Clear()
+{
+	matrix_.clear();
+	bias_.clear();
+	sensor_count_ = 0;
+}
+
+
+/***********************************************************
+****************** TRANSFORM FUNCTIONS *********************
+************************************************************/
+/*
+Transforms a single scan of voltages into the wrench of every
+sensor
+ */
+void AtiTransform::Transform(const double* voltages, double* wrenches) const
+{
+	TransformBlock(voltages, 1, wrenches);
+}
+
+/*
+Transforms scans of voltages, one after another, into one
+wrench per sensor per scan
+ */
+void AtiTransform::TransformBlock(const double* voltages, std::size_t scans, double* wrenches) const
+{
+#ifdef __AVX2__
+	TransformAvx2(voltages, scans, wrenches);
+#else
+	TransformScalar(voltages, scans, wrenches);
+#endif
+}
+
+/*
+Portable kernel, accumulating the matrix columns scaled by
+each bias-corrected voltage
+ */
+void AtiTransform::TransformScalar(const double* voltages, std::size_t scans, double* wrenches) const
+{
+	for (std::size_t scan = 0; scan < scans; scan++)
+	{
+		for (std::size_t sensor = 0; sensor < sensor_count_; sensor++)
+		{
+			const double*	columns =	&matrix_[sensor * kAtiAxes_ * kAtiPaddedAxes_];
+			const double*	bias =		&bias_[sensor * kAtiAxes_];
+			const double*	input =		voltages + (scan * sensor_count_ + sensor) * kAtiAxes_;
+			double*			output =	wrenches + (scan * sensor_count_ + sensor) * kAtiAxes_;
+
+			double accumulator[kAtiAxes_] = { 0.0 };
+			for (int column = 0; column < kAtiAxes_; column++)
+			{
+				double voltage = input[column] - bias[column];
+				for (int row = 0; row < kAtiAxes_; row++)
+					accumulator[row] += columns[column * kAtiPaddedAxes_ + row] * voltage;
+			}
+			for (int row = 0; row < kAtiAxes_; row++)
+				output[row] = accumulator[row];
+		}
+	}
+}
+
+/*
+AVX2 kernel, holding each sensor's six outputs in two four
+wide registers. Falls back to the scalar kernel when the
+compiler does not target AVX2.
+ */
+void AtiTransform::TransformAvx2(const double* voltages, std::size_t scans, double* wrenches) const
+{
+#ifdef __AVX2__
+	for (std::size_t scan = 0; scan < scans; scan++)
+	{
+		for (std::size_t sensor = 0; sensor < sensor_count_; sensor++)
+		{
+			const double*	columns =	&matrix_[sensor * kAtiAxes_ * kAtiPaddedAxes_];
+			const double*	bias =		&bias_[sensor * kAtiAxes_];
+			const double*	input =		voltages + (scan * sensor_count_ + sensor) * kAtiAxes_;
+			double*			output =	wrenches + (scan * sensor_count_ + sensor) * kAtiAxes_;
+
+			__m256d low =	_mm256_setzero_pd();	// Fx, Fy, Fz, Tx
+			__m256d high =	_mm256_setzero_pd();	// Ty, Tz and padding
+			for (int column = 0; column < kAtiAxes_; column++)
+			{
+				__m256d voltage = _mm256_set1_pd(input[column] - bias[column]);
+#ifdef __FMA__
+				low =	_mm256_fmadd_pd(_mm256_loadu_pd(columns + column * kAtiPaddedAxes_), voltage, low);
+				high =	_mm256_fmadd_pd(_mm256_loadu_pd(columns + column * kAtiPaddedAxes_ + 4), voltage, high);
+#else
+				low =	_mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(columns + column * kAtiPaddedAxes_), voltage));
+				high =	_mm256_add_pd(high, _mm256_mul_pd(_mm256_loadu_pd(columns + column * kAtiPaddedAxes_ + 4), voltage));
+#endif
+			}
+			_mm256_storeu_pd(output, low);
+			_mm_storeu_pd(output + 4, _mm256_castpd256_pd128(high));
+		}
+	}
+#else
+	TransformScalar(voltages, scans, wrenches);
+#endif
+}
+
+
+/***********************************************************
+******************** STATUS FUNCTIONS **********************
+************************************************************/
+/*
+Returns the number of sensors added
+ */
+std::size_t AtiTransform::GetSensorCount() const
+{
+	return sensor_count_;
+}
+
+/*
+Returns the number of voltages in a scan, and values in a
+wrench, for all sensors together
+ */
+std::size_t AtiTransform::GetChannelCount() const
+{
+	return sensor_count_ * kAtiAxes_;
+}
+
+/*
+Returns true if transforms run on the AVX2 kernel
+ */
+bool AtiTransform::UsesAvx2()
+{
+#ifdef __AVX2__
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,322 @@
+/*
+File: bench_main.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file is the Main file of the AIMS microbenchmarks. It
+times the experiment engine one function at a time and
+reports nanoseconds and heap allocations per call, so a
+protocol change can be checked for regressions without the
+rig. The movement trial is timed one tick at a time against
+the simulated devices. The TrialList and Staircase benchmarks
+need MEL and are only built when it is found.
+Usage: aims_bench [--iterations N] [filter]
+*/
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the simulated devices and movement trial
+#include "sim_devices.hpp"
+#include "movement_trial.hpp"
+
+// libraries for force/torque, logging and timing
+#include "ati_transform.hpp"
+#include "wrench_reader.hpp"
+#include "sample_buffer.hpp"
+#include "loop_timer.hpp"
+
+// libraries for the experiment protocol
+#ifdef AIMS_HAVE_MEL
+#include "absolute_triallist.hpp"
+#include "absolute_staircase.hpp"
+#endif
+
+// other misc standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+// constant variables
+const std::size_t	kDefaultIterations(100000);	// calls timed per benchmark
+const double		kSampleRate(1000.0);		// sets the force/torque logging rate in Hz
+
+// heap allocations made by the process so far
+std::atomic<unsigned long> allocation_count(0);
+
+
+/***********************************************************
+****************** ALLOCATION COUNTING *********************
+************************************************************/
+/*
+Global allocation functions counting every heap allocation
+*/
+void* operator new(std::size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void* pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr) throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	operator delete[](pointer);
+}
+
+
+/***********************************************************
+******************* BENCHMARK FUNCTIONS ********************
+************************************************************/
+/*
+Timing state of a running benchmark. Work a benchmark needs
+between calls, like resetting state, is excluded from its
+results by pausing.
+*/
+class BenchState
+{
+private:
+	std::chrono::steady_clock::time_point	paused_at_;
+	std::chrono::steady_clock::duration		paused_;
+	unsigned long							paused_allocations_;
+	unsigned long							allocations_at_;
+
+public:
+	BenchState() :
+		paused_(0),
+		paused_allocations_(0),
+		allocations_at_(0)
+	{
+	}
+
+	void Pause()
+	{
+		paused_at_ = std::chrono::steady_clock::now();
+		allocations_at_ = allocation_count.load(std::memory_order_relaxed);
+	}
+
+	void Resume()
+	{
+		paused_allocations_ += allocation_count.load(std::memory_order_relaxed) - allocations_at_;
+		paused_ += std::chrono::steady_clock::now() - paused_at_;
+	}
+
+	std::chrono::steady_clock::duration	GetPaused() const { return paused_; }
+	unsigned long	GetPausedAllocations() const { return paused_allocations_; }
+};
+
+/*
+Times iterations calls of op and prints the nanoseconds and
+heap allocations per call. Skips benchmarks not matching the
+filter.
+*/
+template <typename Op>
+void RunBenchmark(const std::string &name, const std::string &filter, std::size_t iterations, Op op)
+{
+	if (!filter.empty() && name.find(filter) == std::string::npos) return;
+	if (iterations == 0) iterations = 1;
+
+	// warms up caches and any lazily allocated state
+	BenchState warmup;
+	for (std::size_t i = 0; i < iterations / 10 + 1; i++)
+		op(warmup, i);
+
+	// timed calls
+	BenchState state;
+	unsigned long allocations = allocation_count.load(std::memory_order_relaxed);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < iterations; i++)
+		op(state, i);
+	std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start - state.GetPaused();
+	allocations = allocation_count.load(std::memory_order_relaxed) - allocations - state.GetPausedAllocations();
+
+	std::printf("%-40s %12.1f ns/op %10.2f allocs/op\n", name.c_str(),
+		std::chrono::duration<double, std::nano>(elapsed).count() / iterations,
+		(double)allocations / iterations);
+}
+
+
+/***********************************************************
+********************* MAIN FUNCTION ************************
+************************************************************/
+/*
+Runs every benchmark matching the filter
+*/
+int main(int argc, char* argv[])
+{
+	// parses the command line
+	std::size_t	iterations = kDefaultIterations;
+	std::string	filter;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--iterations" && i + 1 < argc)
+			iterations = (std::size_t)std::atol(argv[++i]);
+		else if (option.empty() || option[0] != '-')
+			filter = option;
+		else
+		{
+			std::printf("Usage: aims_bench [--iterations N] [filter]\n");
+			return option == "-h" || option == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (iterations == 0) iterations = 1;
+	std::printf("%-40s %18s %20s\n", "Benchmark", "time", "allocations");
+
+#ifdef AIMS_HAVE_MEL
+	// TRIAL LIST
+	// file used by the export and import benchmarks
+	const std::string kListPath("aims_bench_triallist.csv");
+	{
+		TrialList trial_list;
+		RunBenchmark("TrialList::TrialList", filter, iterations / 10,
+			[](BenchState&, std::size_t) { TrialList list; (void)list.GetSeed(); });
+		RunBenchmark("TrialList::scramble", filter, iterations / 10,
+			[&](BenchState&, std::size_t i) { trial_list.scramble((unsigned int)i + 1); });
+		RunBenchmark("TrialList::GetComboNames", filter, iterations / 10,
+			[&](BenchState&, std::size_t) { trial_list.GetComboNames(); });
+		RunBenchmark("TrialList::ExportList", filter, iterations / 1000,
+			[&](BenchState &state, std::size_t)
+			{
+				state.Pause();
+				std::remove(kListPath.c_str());
+				state.Resume();
+				trial_list.ExportList(kListPath, false);
+			});
+		RunBenchmark("TrialList::ImportList", filter, iterations / 1000,
+			[&](BenchState&, std::size_t) { trial_list.ImportList(kListPath); });
+		std::remove(kListPath.c_str());
+	}
+
+	// STAIRCASE
+	{
+		// a full set of crossovers is reached every few responses, so
+		// the condition is restarted before the crossovers overflow
+		const StaircaseResponse kResponses[] = {
+			StaircaseResponse::Decrease,	StaircaseResponse::Increase,
+			StaircaseResponse::HalveStep,	StaircaseResponse::DoubleStep };
+		Staircase staircase;
+		RunBenchmark("Staircase::ApplyResponse", filter, iterations,
+			[&](BenchState &state, std::size_t i)
+			{
+				if (i % (2 * (kCrossoversRequired_ - 1)) == 0)
+				{
+					state.Pause();
+					staircase.SetConditionNum(0);
+					state.Resume();
+				}
+				staircase.ApplyResponse(kResponses[i % 4]);
+			});
+	}
+#else
+	std::printf("(TrialList and Staircase benchmarks need MEL)\n");
+#endif
+
+	// ATI TRANSFORM
+	{
+		double calibration[kAtiAxes_][kAtiAxes_];
+		SimPlant::GetCalibration(calibration);
+		AtiTransform transform;
+		transform.AddSensor(calibration);
+		transform.AddSensor(calibration);
+
+		// a block of scans with every channel of both sensors
+		std::vector<double> voltages(kDaqBlockSize_ * transform.GetChannelCount());
+		for (std::size_t i = 0; i < voltages.size(); i++)
+			voltages[i] = 0.01 * (double)(i % 17);
+		std::vector<double> wrenches(voltages.size());
+
+		RunBenchmark(std::string("AtiTransform::Transform (") + (AtiTransform::UsesAvx2() ? "avx2)" : "scalar)"), filter, iterations,
+			[&](BenchState&, std::size_t) { transform.Transform(voltages.data(), wrenches.data()); });
+		RunBenchmark("AtiTransform::TransformBlock (5 scans)", filter, iterations,
+			[&](BenchState&, std::size_t) { transform.TransformBlock(voltages.data(), kDaqBlockSize_, wrenches.data()); });
+
+		WrenchReader wrench_reader;
+		wrench_reader.AddSensor(calibration);
+		wrench_reader.AddSensor(calibration);
+		RunBenchmark("WrenchReader::Update", filter, iterations,
+			[&](BenchState&, std::size_t) { wrench_reader.Update(voltages.data()); });
+	}
+
+	// MOVEMENT TRIAL
+	{
+		// simulated devices, generating scans as fast as they are read
+		MockDAQmxSetRealTime(false);
+		SimDaq		daq;
+		SimQ8		q8;
+		q8.open();
+		q8.enable();
+		SimMotor	motor_a(q8.encoder[0]),
+					motor_b(q8.encoder[1]);
+		SimPlant	plant(motor_a, motor_b);
+		plant.Attach();
+
+		WrenchReader	wrench_reader;
+		double			calibration[kAtiAxes_][kAtiAxes_];
+		SimPlant::GetCalibration(calibration);
+		wrench_reader.AddSensor(calibration);
+		wrench_reader.AddSensor(calibration);
+
+		typedef DeviceBundle<SimDaq, SimQ8, SimMotor, WrenchReader, LoopTimer> BenchDevices;
+		BenchDevices	devices = { daq, q8, motor_a, motor_b, wrench_reader };
+		MovementState	movement_state(kSampleRate);
+		SampleBuffer	trial_buffer(kSampleBufferCapacity_);
+		std::vector<Wrench>	wrenches(kDaqBlockSize_ * wrench_reader.GetSensorCount());
+		int sample = 0;
+
+		// one tick is a DAQ read through the transform into the ring
+		// followed by a supervision pass draining it into the buffer
+		std::size_t flush = trial_buffer.GetCapacity() / 2;
+		auto tick = [&](BenchState &state, std::size_t)
+		{
+			if (trial_buffer.GetSize() >= flush)
+			{
+				state.Pause();
+				trial_buffer.Clear();
+				state.Resume();
+			}
+			AcquireScans(devices, movement_state, wrenches);
+			SuperviseTick(devices, movement_state, &trial_buffer, sample);
+		};
+		RunBenchmark("Movement tick (on demand)", filter, iterations, tick);
+
+		if (daq.StartBuffered(kDaqBufferedRate_, kDaqBlockSize_))
+			RunBenchmark("Movement tick (sample clock, 5 scans)", filter, iterations, tick);
+		daq.StartOnDemand();
+
+		RunBenchmark("SuperviseTick (empty ring)", filter, iterations,
+			[&](BenchState&, std::size_t) { SuperviseTick(devices, movement_state, &trial_buffer, sample); });
+
+		plant.Detach();
+		MockDAQmxSetRealTime(true);
+	}
+	return EXIT_SUCCESS;
+}
@@ -18,6 +18,9 @@ sensors. Uses MEL's development ATIsensor class.
 // class header file
 #include "daq_ni.hpp"
 
+// libraries for the session trace
+#include "trace.hpp"
+
 // libraries for MEL
 #include <MEL/Core/Console.hpp>
 
@@ -32,15 +35,12 @@ DaqNI::DaqNI()
 {
 	// set channel numbers to be used
 	set_channel_numbers({ 0,1,2,3,4,5,16,17,18,19,20,21 });
-	// initialize variables here
-	if (DAQmxCreateTask("", &task_handle_) < 0)
-		mel::print("Failed to create task...");
 	// creates analog input task from the DAQ
-	if (DAQmxCreateAIVoltageChan(task_handle_, "Dev1/ai0:5,Dev1/ai16:21", "", DAQmx_Val_Diff, -10.0, 10.0, DAQmx_Val_Volts, NULL) < 0)
-		mel::print("Failed to create channel...");
+	if (!stream_.Open(kDaqChannels_))
+		mel::print(stream_.GetError());
 	// start the task
-	if (DAQmxStartTask(task_handle_) < 0)
-		mel::print("Failed to start task...");
+	if (!stream_.StartOnDemand())
+		mel::print(stream_.GetError());
 }
 
 /*
@@ -49,8 +49,7 @@ Destructor for the DaqNI class
 DaqNI::~DaqNI()
 {
 	// clears memory used by task
-	DAQmxStopTask(task_handle_);
-	DAQmxClearTask(task_handle_);
+	stream_.Close();
 }
 
 
@@ -59,14 +58,22 @@ DaqNI::~DaqNI()
 ************************************************************/
 
 /*
-Updates all channels of the daq simultaneously
+Updates all channels of the daq simultaneously. In buffered
+mode this reads the next block of scans and the channels
+take the values of its last scan.
  */
 bool DaqNI::update()
 {
-	if (DAQmxReadAnalogF64(task_handle_, 1, 10.0, DAQmx_Val_GroupByScanNumber, &values_.get()[0], 12, &read_, NULL) < 0)
+	TraceSpan span("DaqNI::update", "daq");
+	if (!stream_.IsBuffered())
+		return stream_.ReadScan(&values_.get()[0]);
+
+	if (!stream_.ReadBlock(block_values_.data(), block_))
 		return false;
-	else
-		return true;
+	const double* last_scan = block_values_.data() + (block_.samples - 1) * kDaqChannelCount_;
+	for (int channel = 0; channel < kDaqChannelCount_; channel++)
+		values_.get()[channel] = last_scan[channel];
+	return true;
 }
 
 /*
@@ -76,4 +83,92 @@ compile code correctly with MEL
 bool DaqNI::update_channel(mel::uint32 channel_number) 
 {
 	return update();
-}
\ No newline at end of file
+}
+
+
+/***********************************************************
+*************** ACQUISITION MODE FUNCTIONS *****************
+************************************************************/
+/*
+Switches to continuous acquisition on the board's sample
+clock, reading block_size scans at a time
+ */
+bool DaqNI::StartBuffered(double sample_rate, unsigned int block_size)
+{
+	block_values_.assign(block_size * kDaqChannelCount_, 0.0);
+	block_ = DaqBlock();
+	if (stream_.StartBuffered(sample_rate, block_size))
+		return true;
+	mel::print(stream_.GetError());
+	return false;
+}
+
+/*
+Switches back to reading a single scan on every update
+ */
+bool DaqNI::StartOnDemand()
+{
+	if (stream_.StartOnDemand())
+		return true;
+	mel::print(stream_.GetError());
+	return false;
+}
+
+/*
+Restarts acquisition so the next block holds fresh scans.
+Used before each trial in buffered mode, since the driver
+buffer overflows while no trial is being recorded.
+ */
+bool DaqNI::Restart()
+{
+	if (stream_.Restart())
+		return true;
+	mel::print(stream_.GetError());
+	return false;
+}
+
+/*
+Returns true if the DAQ is acquiring on its sample clock
+ */
+bool DaqNI::IsBuffered() const
+{
+	return stream_.IsBuffered();
+}
+
+
+/*
+Returns the number of scans read by each update, one unless
+buffered
+ */
+unsigned int DaqNI::GetBlockSize() const
+{
+	return stream_.GetBlockSize();
+}
+
+
+/***********************************************************
+**************** SCAN AND BLOCK FUNCTIONS ******************
+************************************************************/
+/*
+Returns the voltages of every channel from the last update
+ */
+const double* DaqNI::GetScanValues()
+{
+	return &values_.get()[0];
+}
+
+/*
+Returns the timing of the last block read
+ */
+const DaqBlock& DaqNI::GetBlock() const
+{
+	return block_;
+}
+
+/*
+Returns every scan of the last block read, grouped by scan
+ */
+const double* DaqNI::GetBlockValues() const
+{
+	return block_values_.data();
+}
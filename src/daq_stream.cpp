@@ -0,0 +1,265 @@
+/*
+File: daq_stream.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the DaqStream class. In buffered mode the
+task is configured for continuous sample clock timing with a
+driver buffer of about a second of scans, and each block read
+waits for exactly one block of scans. The block timestamp is
+derived from the number of scans read so far rather than the
+host clock, which is only recorded alongside it.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "daq_stream.hpp"
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Checks if a DAQmx status is an error rather than a warning
+ */
+static bool DaqmxFailed(int32 status)
+{
+	return status < 0;
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the DaqStream class
+ */
+DaqStream::DaqStream() :
+	task_handle_(0),
+	open_(false),
+	running_(false),
+	buffered_(false),
+	sample_rate_(0.0),
+	block_size_(1),
+	samples_read_(0),
+	read_scan_call_("DAQmxReadAnalogF64 (scan)"),
+	read_block_call_("DAQmxReadAnalogF64 (block)")
+{
+}
+
+/*
+Destructor for the DaqStream class
+ */
+DaqStream::~DaqStream()
+{
+	Close();
+}
+
+
+/***********************************************************
+***************** TASK CONTROL FUNCTIONS *******************
+************************************************************/
+/*
+Creates the task and adds the analog input channels
+ */
+bool DaqStream::Open(const char* channels)
+{
+	Close();
+	if (!Check(DAQmxCreateTask("", &task_handle_), "create task"))
+		return false;
+	open_ = true;
+	return Check(DAQmxCreateAIVoltageChan(task_handle_, channels, "", DAQmx_Val_Diff, -10.0, 10.0, DAQmx_Val_Volts, NULL), "create channel");
+}
+
+/*
+Starts the task taking a single scan on every read
+ */
+bool DaqStream::StartOnDemand()
+{
+	if (!open_) return false;
+	Stop();
+	if (buffered_ && !Check(DAQmxSetSampTimingType(task_handle_, DAQmx_Val_OnDemand), "set on-demand timing"))
+		return false;
+	buffered_ = false;
+	sample_rate_ = 0.0;
+	block_size_ = 1;
+	samples_read_ = 0;
+	start_time_ = std::chrono::steady_clock::now();
+	running_ = Check(DAQmxStartTask(task_handle_), "start task");
+	return running_;
+}
+
+/*
+Starts the task acquiring continuously on the board's sample
+clock. Scans are read back in blocks of block_size.
+ */
+bool DaqStream::StartBuffered(double sample_rate, unsigned int block_size)
+{
+	if (!open_ || sample_rate <= 0.0 || block_size == 0) return false;
+	Stop();
+
+	// sizes the driver buffer to hold a whole number of blocks
+	uInt64 buffer_blocks = (uInt64)(sample_rate * kDaqBufferSeconds_ / block_size);
+	if (buffer_blocks < 2) buffer_blocks = 2;
+	if (!Check(DAQmxCfgSampClkTiming(task_handle_, "", sample_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, buffer_blocks * block_size), "configure sample clock"))
+		return false;
+
+	buffered_ = true;
+	sample_rate_ = sample_rate;
+	block_size_ = block_size;
+	samples_read_ = 0;
+	start_time_ = std::chrono::steady_clock::now();
+	running_ = Check(DAQmxStartTask(task_handle_), "start task");
+	return running_;
+}
+
+/*
+Restarts a running task with the same timing, discarding the
+scans acquired while nobody was reading
+ */
+bool DaqStream::Restart()
+{
+	if (!running_) return false;
+	Stop();
+	samples_read_ = 0;
+	start_time_ = std::chrono::steady_clock::now();
+	running_ = Check(DAQmxStartTask(task_handle_), "restart task");
+	return running_;
+}
+
+/*
+Stops the task, discarding any scans still in the buffer
+ */
+bool DaqStream::Stop()
+{
+	if (!running_) return true;
+	running_ = false;
+	return Check(DAQmxStopTask(task_handle_), "stop task");
+}
+
+/*
+Stops and releases the task
+ */
+void DaqStream::Close()
+{
+	if (!open_) return;
+	Stop();
+	DAQmxClearTask(task_handle_);
+	task_handle_ = 0;
+	open_ = false;
+	buffered_ = false;
+}
+
+
+/***********************************************************
+********************* READ FUNCTIONS ***********************
+************************************************************/
+/*
+Reads a single scan of every channel into values, which must
+hold kDaqChannelCount_ values. Only used when reading on
+demand; buffered tasks are read with ReadBlock.
+ */
+bool DaqStream::ReadScan(double* values)
+{
+	if (!running_ || buffered_) return false;
+
+	int32 read = 0;
+	int32 status = TimedCall(read_scan_call_, [&] {
+		return DAQmxReadAnalogF64(task_handle_, 1, kDaqTimeout_, DAQmx_Val_GroupByScanNumber, values, kDaqChannelCount_, &read, NULL); },
+		DaqmxFailed);
+	if (!Check(status, "read scan"))
+		return false;
+	samples_read_ += (std::uint64_t)read;
+	return read == 1;
+}
+
+/*
+Reads the next block of scans into values, grouped by scan,
+which must hold GetBlockSize() * kDaqChannelCount_ values.
+Waits until the board has acquired the whole block.
+ */
+bool DaqStream::ReadBlock(double* values, DaqBlock &block)
+{
+	if (!running_ || !buffered_) return false;
+
+	// reads exactly one block from the driver buffer
+	int32 read = 0;
+	int32 status = TimedCall(read_block_call_, [&] {
+		return DAQmxReadAnalogF64(task_handle_, (int32)block_size_, kDaqTimeout_, DAQmx_Val_GroupByScanNumber, values, block_size_ * kDaqChannelCount_, &read, NULL); },
+		DaqmxFailed);
+	if (!Check(status, "read block"))
+		return false;
+
+	// timestamps the block from the sample clock
+	block.first_sample =	samples_read_;
+	block.samples =			(std::uint32_t)read;
+	block.time =			samples_read_ / sample_rate_;
+	block.period =			1.0 / sample_rate_;
+	block.host_time =		std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+	samples_read_ += (std::uint64_t)read;
+	return read == (int32)block_size_;
+}
+
+
+/***********************************************************
+******************** STATUS FUNCTIONS **********************
+************************************************************/
+/*
+Returns true if the task is running on the sample clock
+ */
+bool DaqStream::IsBuffered() const
+{
+	return buffered_;
+}
+
+/*
+Returns the sample clock rate, zero when reading on demand
+ */
+double DaqStream::GetSampleRate() const
+{
+	return sample_rate_;
+}
+
+/*
+Returns the number of scans in each block
+ */
+unsigned int DaqStream::GetBlockSize() const
+{
+	return block_size_;
+}
+
+/*
+Returns the number of scans read since the task started
+ */
+std::uint64_t DaqStream::GetSamplesRead() const
+{
+	return samples_read_;
+}
+
+/*
+Returns a description of the last failed driver call
+ */
+const std::string& DaqStream::GetError() const
+{
+	return error_;
+}
+
+
+/***********************************************************
+********************* ERROR FUNCTIONS **********************
+************************************************************/
+/*
+Checks the status of a driver call and keeps a description
+of it if the call failed
+ */
+bool DaqStream::Check(int32 status, const char* action)
+{
+	if (status >= 0) return true;
+	char error_buffer[2048] = { '\0' };
+	DAQmxGetErrorString(status, error_buffer, sizeof(error_buffer));
+	error_ = std::string("Failed to ") + action + ": " + error_buffer;
+	return false;
+}
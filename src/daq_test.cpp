@@ -0,0 +1,235 @@
+/*
+File: daq_test.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file is the Main file of the DAQ test. It drives the DAQ
+classes through the mock DAQmx layer in on-demand and
+buffered modes, including a restart after the driver buffer
+overflowed, and checks the sample counts, block timing and
+voltages read back. The mock signal is replaced by one whose
+value is known for every channel and sample, so every scan
+can be checked exactly. DaqNI needs MEL and is only tested
+when it is found; DaqStream, which it reads through, always
+is. Returns a failure exit code if any check fails.
+Usage: aims_daq_test
+*/
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the DAQ
+#include "daqmx_mock.hpp"
+#include "daq_stream.hpp"
+#ifdef AIMS_HAVE_MEL
+#include "daq_ni.hpp"
+#endif
+
+// other misc standard libraries
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+// constant variables
+const int			kChannels[kDaqChannelCount_] = { 0,1,2,3,4,5,16,17,18,19,20,21 };	// physical channels of kDaqChannels_
+const double		kTestRate(1000.0);		// sample clock rate in Hz
+const unsigned int	kTestBlockSize(5);		// scans per block
+const int			kTestBlocks(4);			// blocks read per check
+const double		kTolerance(1e-9);		// volts
+
+// checks that failed so far
+int failures = 0;
+
+
+/***********************************************************
+******************** CHECK FUNCTIONS ***********************
+************************************************************/
+/*
+Records and prints a failed check
+ */
+void Check(bool passed, const char* description)
+{
+	if (passed) return;
+	failures++;
+	std::printf("FAILED: %s\n", description);
+}
+
+/*
+Test signal, the channel number plus the time of the sample,
+so both the channel and the sample clock time of every value
+are known
+ */
+double TestSignal(int channel, double time)
+{
+	return channel + time;
+}
+
+/*
+Returns true if a scan holds the test signal of every channel
+at the given time
+ */
+bool IsScan(const double* scan, double time)
+{
+	for (int channel = 0; channel < kDaqChannelCount_; channel++)
+	{
+		if (std::fabs(scan[channel] - TestSignal(kChannels[channel], time)) > kTolerance)
+			return false;
+	}
+	return true;
+}
+
+/*
+Reads blocks from a buffered stream, checking that their
+samples follow on from first_sample
+ */
+void CheckBlocks(DaqStream &stream, std::uint64_t first_sample, const char* description)
+{
+	std::vector<double> values(kTestBlockSize * kDaqChannelCount_);
+	DaqBlock block;
+	for (int i = 0; i < kTestBlocks; i++)
+	{
+		std::uint64_t expected = first_sample + i * kTestBlockSize;
+		bool read = stream.ReadBlock(values.data(), block);
+		Check(read, description);
+		if (!read) return;
+		Check(block.first_sample == expected, "block starts at the next sample");
+		Check(block.samples == kTestBlockSize, "block holds a whole block of scans");
+		Check(std::fabs(block.time - expected / kTestRate) < kTolerance, "block time follows the sample clock");
+		Check(std::fabs(block.period - 1.0 / kTestRate) < kTolerance, "block period is the sample clock period");
+		for (unsigned int scan = 0; scan < kTestBlockSize; scan++)
+			Check(IsScan(&values[scan * kDaqChannelCount_], (expected + scan) / kTestRate), "block scans hold the signal");
+	}
+	Check(stream.GetSamplesRead() == first_sample + kTestBlocks * kTestBlockSize, "samples read counts every block");
+}
+
+
+/***********************************************************
+********************* TEST FUNCTIONS ***********************
+************************************************************/
+/*
+Reads single scans on demand, then blocks on the sample clock,
+and switches back to reading on demand
+ */
+void TestStreamModes()
+{
+	DaqStream stream;
+	Check(stream.Open(), "opens the task");
+
+	// ON-DEMAND
+	// the mock signal is timed from the start of the task, so
+	// only the channel part of the signal is checked
+	std::vector<double> scan(kDaqChannelCount_);
+	Check(stream.StartOnDemand(), "starts on demand");
+	Check(!stream.IsBuffered() && stream.GetBlockSize() == 1, "reads one scan per update on demand");
+	for (int i = 0; i < kTestBlocks; i++)
+	{
+		Check(stream.ReadScan(scan.data()), "reads a scan on demand");
+		for (int channel = 0; channel < kDaqChannelCount_; channel++)
+			Check(std::floor(scan[channel]) == kChannels[channel], "on-demand scan holds every channel in order");
+	}
+	Check(stream.GetSamplesRead() == (std::uint64_t)kTestBlocks, "samples read counts every scan");
+	DaqBlock block;
+	Check(!stream.ReadBlock(scan.data(), block), "block reads are refused on demand");
+
+	// BUFFERED
+	Check(stream.StartBuffered(kTestRate, kTestBlockSize), "starts buffered");
+	Check(stream.IsBuffered() && stream.GetBlockSize() == kTestBlockSize, "reads a block per update buffered");
+	Check(stream.GetSampleRate() == kTestRate, "keeps the sample clock rate");
+	Check(stream.GetSamplesRead() == 0, "starting buffered clears the samples read");
+	Check(!stream.ReadScan(scan.data()), "scan reads are refused buffered");
+	CheckBlocks(stream, 0, "reads a block buffered");
+
+	// BACK TO ON-DEMAND
+	Check(stream.StartOnDemand(), "starts on demand again");
+	Check(stream.ReadScan(scan.data()) && stream.GetSamplesRead() == 1, "reads on demand again");
+	stream.Close();
+}
+
+/*
+Lets the driver buffer overflow while no block is read, the
+way it does between trials, and checks that a restart reads
+fresh blocks from the first sample again
+ */
+void TestStreamRestart()
+{
+	DaqStream stream;
+	Check(stream.Open(), "opens the task");
+	Check(stream.StartBuffered(kTestRate, kTestBlockSize), "starts buffered");
+	CheckBlocks(stream, 0, "reads a block before the overflow");
+
+	MockDAQmxSetRealTime(true);
+	std::this_thread::sleep_for(std::chrono::duration<double>(kDaqBufferSeconds_ * 1.2));
+	std::vector<double> values(kTestBlockSize * kDaqChannelCount_);
+	DaqBlock block;
+	Check(!stream.ReadBlock(values.data(), block), "overflowed buffer fails the read");
+	Check(!stream.GetError().empty(), "overflow is described");
+	MockDAQmxSetRealTime(false);
+
+	Check(stream.Restart(), "restarts");
+	Check(stream.GetSamplesRead() == 0, "restart clears the samples read");
+	CheckBlocks(stream, 0, "reads a block after the restart");
+	stream.Close();
+}
+
+#ifdef AIMS_HAVE_MEL
+/*
+Updates DaqNI on demand and buffered, checking that the
+channels take the last scan of every block
+ */
+void TestDaqNI()
+{
+	// starts on demand
+	DaqNI daq;
+	Check(!daq.IsBuffered() && daq.GetBlockSize() == 1, "DaqNI starts on demand");
+	Check(daq.update(), "DaqNI updates on demand");
+	for (int channel = 0; channel < kDaqChannelCount_; channel++)
+		Check(std::floor(daq.GetScanValues()[channel]) == kChannels[channel], "DaqNI on-demand scan holds every channel");
+
+	// buffered, restarted before every block like a trial
+	Check(daq.StartBuffered(kTestRate, kTestBlockSize), "DaqNI starts buffered");
+	for (int i = 0; i < kTestBlocks; i++)
+	{
+		Check(daq.Restart(), "DaqNI restarts");
+		Check(daq.update(), "DaqNI updates buffered");
+		const DaqBlock &block = daq.GetBlock();
+		Check(block.first_sample == 0 && block.samples == kTestBlockSize, "DaqNI block starts after the restart");
+		for (unsigned int scan = 0; scan < kTestBlockSize; scan++)
+			Check(IsScan(daq.GetBlockValues() + scan * kDaqChannelCount_, scan / kTestRate), "DaqNI block scans hold the signal");
+		Check(IsScan(daq.GetScanValues(), (kTestBlockSize - 1) / kTestRate), "DaqNI channels hold the last scan");
+	}
+
+	Check(daq.StartOnDemand() && daq.update(), "DaqNI updates on demand again");
+}
+#endif
+
+
+/***********************************************************
+********************** MAIN FUNCTION ***********************
+************************************************************/
+int main()
+{
+	// blocks are handed out at once, only the overflow waits
+	MockDAQmxSetSignal(TestSignal);
+	MockDAQmxSetRealTime(false);
+
+	TestStreamModes();
+	TestStreamRestart();
+#ifdef AIMS_HAVE_MEL
+	TestDaqNI();
+#endif
+
+	if (failures > 0)
+	{
+		std::printf("%d checks failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	std::printf("All DAQ checks passed\n");
+	return EXIT_SUCCESS;
+}
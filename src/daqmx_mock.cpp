@@ -0,0 +1,330 @@
+/*
+File: daqmx_mock.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the mock NI-DAQmx layer. Each task keeps
+its channel list and timing. On-demand reads return a single
+scan taken at the time of the call. Sample clocked reads hand
+out scans in order, waiting on the host clock until the
+requested scans would have been acquired and failing the way
+the driver does if the buffer overflows. Channel voltages
+come from a signal function that tests can replace.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "daqmx_mock.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const double kMockPi(3.14159265358979323846);
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// state of a single mock task
+struct MockTask
+{
+	std::vector<int>	channels;		// physical channel numbers
+	bool				running;
+	bool				clocked;		// sample clock timing configured
+	double				rate;
+	uInt64				buffer_size;	// scans held by the driver buffer
+	uInt64				samples_read;	// scans handed out since start
+	std::chrono::steady_clock::time_point	start_time;
+};
+
+
+/***********************************************************
+******************* MOCK STATE VARIABLES *******************
+************************************************************/
+static std::mutex	mock_mutex;
+static bool			mock_real_time(true);
+static std::function<double(int, double)> mock_signal;
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Default channel voltage, a small sine wave that differs for
+every channel so scans can be told apart
+ */
+static double DefaultSignal(int channel, double time)
+{
+	return 0.01 * (channel + 1) + 0.1 * std::sin(2.0 * kMockPi * (1.0 + channel) * time);
+}
+
+/*
+Returns the voltage of a channel at the given time
+ */
+static double GetVoltage(int channel, double time)
+{
+	std::lock_guard<std::mutex> lock(mock_mutex);
+	return mock_signal ? mock_signal(channel, time) : DefaultSignal(channel, time);
+}
+
+/*
+Parses a physical channel list such as "Dev1/ai0:5,Dev1/ai16:21"
+into channel numbers. Returns false if the list is malformed.
+ */
+static bool ParseChannels(const char* list, std::vector<int> &channels)
+{
+	std::string text = list != nullptr ? list : "";
+	std::size_t start = 0;
+	while (start < text.size())
+	{
+		std::size_t end = text.find(',', start);
+		if (end == std::string::npos) end = text.size();
+		std::string item = text.substr(start, end - start);
+		start = end + 1;
+
+		// finds the channel range after the "ai" prefix
+		std::size_t ai = item.find("ai");
+		if (ai == std::string::npos) return false;
+		std::string range = item.substr(ai + 2);
+		std::size_t colon = range.find(':');
+		int first = std::atoi(range.c_str());
+		int last = colon == std::string::npos ? first : std::atoi(range.c_str() + colon + 1);
+		if (last < first) return false;
+		for (int channel = first; channel <= last; channel++)
+			channels.push_back(channel);
+	}
+	return !channels.empty() && channels.size() <= (std::size_t)kMockDAQmxMaxChannels_;
+}
+
+/*
+Converts a task handle back to the mock task
+ */
+static MockTask* GetTask(TaskHandle taskHandle)
+{
+	return static_cast<MockTask*>(taskHandle);
+}
+
+
+/***********************************************************
+******************** TASK FUNCTIONS ************************
+************************************************************/
+/*
+Creates an empty task
+ */
+int32 DAQmxCreateTask(const char /*taskName*/[], TaskHandle *taskHandle)
+{
+	if (taskHandle == nullptr) return DAQmxErrorInvalidTask;
+	MockTask* task = new MockTask();
+	task->running =			false;
+	task->clocked =			false;
+	task->rate =			0.0;
+	task->buffer_size =		0;
+	task->samples_read =	0;
+	*taskHandle = task;
+	return 0;
+}
+
+/*
+Starts the task, which starts the sample clock if one is set
+ */
+int32 DAQmxStartTask(TaskHandle taskHandle)
+{
+	MockTask* task = GetTask(taskHandle);
+	if (task == nullptr) return DAQmxErrorInvalidTask;
+	task->running =			true;
+	task->samples_read =	0;
+	task->start_time =		std::chrono::steady_clock::now();
+	return 0;
+}
+
+/*
+Stops the task
+ */
+int32 DAQmxStopTask(TaskHandle taskHandle)
+{
+	MockTask* task = GetTask(taskHandle);
+	if (task == nullptr) return DAQmxErrorInvalidTask;
+	task->running = false;
+	return 0;
+}
+
+/*
+Releases the task
+ */
+int32 DAQmxClearTask(TaskHandle taskHandle)
+{
+	delete GetTask(taskHandle);
+	return 0;
+}
+
+
+/***********************************************************
+*************** CHANNEL AND TIMING FUNCTIONS ***************
+************************************************************/
+/*
+Adds analog input channels to the task
+ */
+int32 DAQmxCreateAIVoltageChan(TaskHandle taskHandle, const char physicalChannel[], const char /*nameToAssignToChannel*/[], int32 /*terminalConfig*/, float64 /*minVal*/, float64 /*maxVal*/, int32 /*units*/, const char /*customScaleName*/[])
+{
+	MockTask* task = GetTask(taskHandle);
+	if (task == nullptr) return DAQmxErrorInvalidTask;
+	if (!ParseChannels(physicalChannel, task->channels)) return DAQmxErrorInvalidTask;
+	return 0;
+}
+
+/*
+Sets the task to acquire on the sample clock
+ */
+int32 DAQmxCfgSampClkTiming(TaskHandle taskHandle, const char /*source*/[], float64 rate, int32 /*activeEdge*/, int32 /*sampleMode*/, uInt64 sampsPerChan)
+{
+	MockTask* task = GetTask(taskHandle);
+	if (task == nullptr || rate <= 0.0) return DAQmxErrorInvalidTask;
+	task->clocked =		true;
+	task->rate =		rate;
+	task->buffer_size =	sampsPerChan;
+	return 0;
+}
+
+/*
+Switches the task between on-demand and sample clock timing
+ */
+int32 DAQmxSetSampTimingType(TaskHandle taskHandle, int32 data)
+{
+	MockTask* task = GetTask(taskHandle);
+	if (task == nullptr) return DAQmxErrorInvalidTask;
+	task->clocked = data == DAQmx_Val_SampClk && task->rate > 0.0;
+	return 0;
+}
+
+
+/***********************************************************
+********************* READ FUNCTIONS ***********************
+************************************************************/
+/*
+Reads scans of every channel of the task, grouped by scan
+ */
+int32 DAQmxReadAnalogF64(TaskHandle taskHandle, int32 numSampsPerChan, float64 timeout, bool32 /*fillMode*/, float64 readArray[], uInt32 arraySizeInSamps, int32 *sampsPerChanRead, bool32* /*reserved*/)
+{
+	MockTask* task = GetTask(taskHandle);
+	if (sampsPerChanRead != nullptr) *sampsPerChanRead = 0;
+	if (task == nullptr || !task->running) return DAQmxErrorInvalidTask;
+
+	std::size_t channel_count = task->channels.size();
+	uInt64 scans = numSampsPerChan > 0 ? (uInt64)numSampsPerChan : 1;
+	if (scans * channel_count > arraySizeInSamps) return DAQmxErrorReadBufferTooSmall;
+
+	// on-demand tasks take a single scan right now
+	if (!task->clocked)
+	{
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - task->start_time).count();
+		for (std::size_t channel = 0; channel < channel_count; channel++)
+			readArray[channel] = GetVoltage(task->channels[channel], time);
+		if (sampsPerChanRead != nullptr) *sampsPerChanRead = 1;
+		return 0;
+	}
+
+	// waits until the board would have acquired the requested scans
+	uInt64 needed = task->samples_read + scans;
+	std::chrono::duration<double> due(needed / task->rate);
+	std::chrono::steady_clock::time_point ready = task->start_time +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(due);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	bool real_time;
+	{
+		std::lock_guard<std::mutex> lock(mock_mutex);
+		real_time = mock_real_time;
+	}
+	if (real_time)
+	{
+		// acquired scans that were never read have been overwritten
+		double elapsed = std::chrono::duration<double>(now - task->start_time).count();
+		if (task->buffer_size > 0 && elapsed * task->rate > (double)(task->samples_read + task->buffer_size))
+			return DAQmxErrorSamplesNoLongerAvailable;
+
+		if (timeout >= 0.0 && ready > now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout)))
+			return DAQmxErrorSamplesNotYetAvailable;
+		std::this_thread::sleep_until(ready);
+	}
+
+	// fills in the scans at their sample clock times
+	for (uInt64 scan = 0; scan < scans; scan++)
+	{
+		double time = (task->samples_read + scan) / task->rate;
+		for (std::size_t channel = 0; channel < channel_count; channel++)
+			readArray[scan * channel_count + channel] = GetVoltage(task->channels[channel], time);
+	}
+	task->samples_read += scans;
+	if (sampsPerChanRead != nullptr) *sampsPerChanRead = (int32)scans;
+	return 0;
+}
+
+
+/***********************************************************
+********************* ERROR FUNCTIONS **********************
+************************************************************/
+/*
+Describes an error code
+ */
+int32 DAQmxGetErrorString(int32 errorCode, char errorString[], uInt32 bufferSize)
+{
+	const char* message = "Mock DAQmx error";
+	switch (errorCode)
+	{
+	case 0:										message = "No error"; break;
+	case DAQmxErrorInvalidTask:					message = "Task is not valid or not running"; break;
+	case DAQmxErrorSamplesNotYetAvailable:		message = "Samples not yet acquired before timeout"; break;
+	case DAQmxErrorSamplesNoLongerAvailable:	message = "Samples overwritten in the buffer before being read"; break;
+	case DAQmxErrorReadBufferTooSmall:			message = "Read array too small for requested samples"; break;
+	}
+	if (errorString != nullptr && bufferSize > 0)
+		std::snprintf(errorString, bufferSize, "%s", message);
+	return 0;
+}
+
+/*
+Describes the last error, the mock keeps no extended info
+ */
+int32 DAQmxGetExtendedErrorInfo(char errorString[], uInt32 bufferSize)
+{
+	if (errorString != nullptr && bufferSize > 0)
+		errorString[0] = '\0';
+	return 0;
+}
+
+
+/***********************************************************
+****************** MOCK CONTROL FUNCTIONS ******************
+************************************************************/
+/*
+Replaces the function giving each channel's voltage over time
+ */
+void MockDAQmxSetSignal(std::function<double(int channel, double time)> signal)
+{
+	std::lock_guard<std::mutex> lock(mock_mutex);
+	mock_signal = signal;
+}
+
+/*
+Sets whether sample clocked reads wait on the host clock.
+Without real time, every read returns its scans immediately.
+ */
+void MockDAQmxSetRealTime(bool real_time)
+{
+	std::lock_guard<std::mutex> lock(mock_mutex);
+	mock_real_time = real_time;
+}
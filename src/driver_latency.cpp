@@ -0,0 +1,340 @@
+/*
+File: driver_latency.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the LatencyHistogram and DriverCall
+classes. Latencies below 8 ns get a bucket each; above that
+every power of two is split into 8 equal buckets, so a
+percentile is never off by more than an eighth of its value.
+Percentiles are read back as the middle of their bucket.
+The registry of call sites is only locked when a site is
+created, renamed or reported, never while recording.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "driver_latency.hpp"
+
+// other misc standard libraries
+#include <algorithm>
+#include <mutex>
+
+
+/***********************************************************
+******************* REGISTRY FUNCTIONS *********************
+************************************************************/
+// every call site alive in the process
+struct DriverCallRegistry
+{
+	std::mutex					mutex;
+	std::vector<DriverCall*>	calls;
+};
+
+/*
+Returns the registry, created on first use so call sites
+constructed during static initialization can register
+ */
+static DriverCallRegistry& GetRegistry()
+{
+	static DriverCallRegistry registry;
+	return registry;
+}
+
+
+/***********************************************************
+******************* HISTOGRAM FUNCTIONS ********************
+************************************************************/
+/*
+Constructor for the LatencyHistogram class
+ */
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+/*
+Counts a single latency in its bucket
+ */
+void LatencyHistogram::Record(std::uint64_t nanoseconds)
+{
+	buckets_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+	// raises the maximum unless another thread already went past it
+	std::uint64_t max = max_.load(std::memory_order_relaxed);
+	while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+/*
+Clears every bucket. Latencies recorded by other threads
+while clearing may be lost.
+ */
+void LatencyHistogram::Reset()
+{
+	for (std::size_t i = 0; i < buckets_.size(); i++)
+		buckets_[i].store(0, std::memory_order_relaxed);
+	count_.store(0, std::memory_order_relaxed);
+	sum_.store(0, std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+}
+
+/*
+Returns the number of latencies recorded
+ */
+std::uint64_t LatencyHistogram::GetCount() const
+{
+	return count_.load(std::memory_order_relaxed);
+}
+
+/*
+Returns the largest latency recorded in nanoseconds
+ */
+std::uint64_t LatencyHistogram::GetMax() const
+{
+	return max_.load(std::memory_order_relaxed);
+}
+
+/*
+Returns the mean latency in nanoseconds
+ */
+double LatencyHistogram::GetMean() const
+{
+	std::uint64_t count = GetCount();
+	return count > 0 ? (double)sum_.load(std::memory_order_relaxed) / (double)count : 0.0;
+}
+
+/*
+Returns the latency in nanoseconds below which the given
+percentage of the recorded latencies fall
+ */
+double LatencyHistogram::GetPercentile(double percentile) const
+{
+	std::uint64_t count = GetCount();
+	if (count == 0) return 0.0;
+
+	// rank of the latency wanted, counting from one
+	double rank = std::max(1.0, std::min(percentile, 100.0) / 100.0 * (double)count);
+	std::uint64_t seen = 0;
+	for (int bucket = 0; bucket < kLatencyBuckets_; bucket++)
+	{
+		seen += buckets_[bucket].load(std::memory_order_relaxed);
+		if ((double)seen >= rank)
+		{
+			// the middle of the bucket, but never past the largest latency
+			double middle = 0.5 * (double)(GetBucketLow(bucket) + GetBucketHigh(bucket));
+			return std::min(middle, (double)GetMax());
+		}
+	}
+	return (double)GetMax();
+}
+
+/*
+Returns the bucket counting the given latency
+ */
+int LatencyHistogram::GetBucket(std::uint64_t nanoseconds)
+{
+	if (nanoseconds < (std::uint64_t)kLatencySubBuckets_)
+		return (int)nanoseconds;
+
+	// position of the highest set bit
+	int exponent = 0;
+	for (std::uint64_t value = nanoseconds >> 1; value != 0; value >>= 1)
+		exponent++;
+	if (exponent > kLatencyMaxExponent_)
+		return kLatencyBuckets_ - 1;
+
+	// the bits just below the highest one pick the bucket within the power of two
+	int sub_bucket = (int)(nanoseconds >> (exponent - kLatencySubBucketBits_)) & (kLatencySubBuckets_ - 1);
+	return (exponent - kLatencySubBucketBits_ + 1) * kLatencySubBuckets_ + sub_bucket;
+}
+
+/*
+Returns the smallest latency counted by a bucket
+ */
+std::uint64_t LatencyHistogram::GetBucketLow(int bucket)
+{
+	if (bucket < kLatencySubBuckets_)
+		return (std::uint64_t)bucket;
+	int exponent = bucket / kLatencySubBuckets_ + kLatencySubBucketBits_ - 1;
+	int sub_bucket = bucket % kLatencySubBuckets_;
+	return (std::uint64_t)(kLatencySubBuckets_ + sub_bucket) << (exponent - kLatencySubBucketBits_);
+}
+
+/*
+Returns the largest latency counted by a bucket
+ */
+std::uint64_t LatencyHistogram::GetBucketHigh(int bucket)
+{
+	if (bucket < kLatencySubBuckets_)
+		return (std::uint64_t)bucket;
+	int exponent = bucket / kLatencySubBuckets_ + kLatencySubBucketBits_ - 1;
+	return GetBucketLow(bucket) + ((std::uint64_t)1 << (exponent - kLatencySubBucketBits_)) - 1;
+}
+
+
+/***********************************************************
+******************* CALL SITE FUNCTIONS ********************
+************************************************************/
+/*
+Constructor for the DriverCall class
+ */
+DriverCall::DriverCall(const std::string &name) :
+	name_(name),
+	errors_(0)
+{
+	DriverCallRegistry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.calls.push_back(this);
+}
+
+/*
+Destructor for the DriverCall class
+ */
+DriverCall::~DriverCall()
+{
+	DriverCallRegistry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.calls.erase(std::remove(registry.calls.begin(), registry.calls.end(), this), registry.calls.end());
+}
+
+/*
+Records the latency of a single call and whether it failed
+ */
+void DriverCall::Record(std::chrono::steady_clock::duration latency, bool failed)
+{
+	std::int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+	latency_.Record(nanoseconds > 0 ? (std::uint64_t)nanoseconds : 0);
+	if (failed)
+		errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+Clears the recorded calls
+ */
+void DriverCall::Reset()
+{
+	latency_.Reset();
+	errors_.store(0, std::memory_order_relaxed);
+}
+
+/*
+Renames the call site, such as once a device port is known
+ */
+void DriverCall::SetName(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	name_ = name;
+}
+
+/*
+Returns the name of the call site
+ */
+std::string DriverCall::GetName() const
+{
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	return name_;
+}
+
+/*
+Summarizes the recorded calls in microseconds
+ */
+LatencySummary DriverCall::GetSummary() const
+{
+	LatencySummary summary;
+	summary.calls =		latency_.GetCount();
+	summary.errors =	errors_.load(std::memory_order_relaxed);
+	summary.mean =		latency_.GetMean() * 1e-3;
+	summary.p50 =		latency_.GetPercentile(50.0) * 1e-3;
+	summary.p90 =		latency_.GetPercentile(90.0) * 1e-3;
+	summary.p99 =		latency_.GetPercentile(99.0) * 1e-3;
+	summary.p999 =		latency_.GetPercentile(99.9) * 1e-3;
+	summary.max =		(double)latency_.GetMax() * 1e-3;
+	return summary;
+}
+
+
+/***********************************************************
+******************** REPORT FUNCTIONS **********************
+************************************************************/
+/*
+Copies out the name and summary of every call site that has
+been called, in the order the sites were created
+ */
+void GetDriverLatencyReport(std::vector<std::string> &names, std::vector<LatencySummary> &summaries)
+{
+	DriverCallRegistry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (std::size_t i = 0; i < registry.calls.size(); i++)
+	{
+		LatencySummary summary = registry.calls[i]->GetSummary();
+		if (summary.calls == 0) continue;
+		names.push_back(registry.calls[i]->name_);
+		summaries.push_back(summary);
+	}
+}
+
+/*
+Prints a table of the latencies of every call site
+ */
+void PrintDriverLatencyReport(std::FILE* out)
+{
+	std::vector<std::string>	names;
+	std::vector<LatencySummary>	summaries;
+	GetDriverLatencyReport(names, summaries);
+	if (names.empty()) return;
+
+	std::fprintf(out, "%-36s %10s %8s %10s %10s %10s %10s %10s %10s\n", "Driver call (us)",
+		"calls", "errors", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (std::size_t i = 0; i < names.size(); i++)
+	{
+		const LatencySummary &summary = summaries[i];
+		std::fprintf(out, "%-36s %10llu %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", names[i].c_str(),
+			(unsigned long long)summary.calls, (unsigned long long)summary.errors, summary.mean,
+			summary.p50, summary.p90, summary.p99, summary.p999, summary.max);
+	}
+}
+
+/*
+Appends the latencies of every call site to a CSV, one row
+per call site with latencies in microseconds. The header is
+only written when the file is new.
+ */
+bool WriteDriverLatencyReport(const std::string &filepath)
+{
+	std::vector<std::string>	names;
+	std::vector<LatencySummary>	summaries;
+	GetDriverLatencyReport(names, summaries);
+
+	std::FILE* file = std::fopen(filepath.c_str(), "a");
+	if (file == nullptr) return false;
+	std::fseek(file, 0, SEEK_END);
+	if (std::ftell(file) == 0)
+		std::fprintf(file, "Call,Calls,Errors,Mean (us),P50 (us),P90 (us),P99 (us),P99.9 (us),Max (us)\n");
+	for (std::size_t i = 0; i < names.size(); i++)
+	{
+		const LatencySummary &summary = summaries[i];
+		std::fprintf(file, "%s,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", names[i].c_str(),
+			(unsigned long long)summary.calls, (unsigned long long)summary.errors, summary.mean,
+			summary.p50, summary.p90, summary.p99, summary.p999, summary.max);
+	}
+	bool written = std::ferror(file) == 0;
+	return std::fclose(file) == 0 && written;
+}
+
+/*
+Clears the recorded calls of every call site
+ */
+void ResetDriverLatency()
+{
+	DriverCallRegistry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (std::size_t i = 0; i < registry.calls.size(); i++)
+		registry.calls[i]->Reset();
+}
@@ -0,0 +1,132 @@
+/*
+File: file_io.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the portable file helpers used by the
+binary data files of this project.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// module header file
+#include "file_io.hpp"
+
+// other misc standard libraries
+#include <atomic>
+
+// platform specific libraries
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+// number of syncs to disk made by this process
+static std::atomic<unsigned long> sync_count(0);
+
+
+/***********************************************************
+**************** FILE POSITION FUNCTIONS *******************
+************************************************************/
+/*
+Returns the current position in the file
+ */
+std::int64_t FileTell(std::FILE* file)
+{
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return (std::int64_t)ftello(file);
+#endif
+}
+
+/*
+Moves to an absolute position in the file
+ */
+bool FileSeek(std::FILE* file, std::int64_t position)
+{
+#ifdef _WIN32
+	return _fseeki64(file, position, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)position, SEEK_SET) == 0;
+#endif
+}
+
+/*
+Returns the size of the file, leaving the position at
+the end of the file
+ */
+std::int64_t FileSize(std::FILE* file)
+{
+#ifdef _WIN32
+	if (_fseeki64(file, 0, SEEK_END) != 0) return -1;
+#else
+	if (fseeko(file, 0, SEEK_END) != 0) return -1;
+#endif
+	return FileTell(file);
+}
+
+
+/*
+Cuts the file down to the given size. Any buffered output
+is flushed first.
+ */
+bool FileTruncate(std::FILE* file, std::int64_t size)
+{
+	if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+	return _chsize_s(_fileno(file), size) == 0;
+#else
+	return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+
+/***********************************************************
+****************** DURABILITY FUNCTIONS ********************
+************************************************************/
+/*
+Flushes buffered output and forces it through the operating
+system's cache onto the disk
+ */
+bool SyncFile(std::FILE* file)
+{
+	if (std::fflush(file) != 0) return false;
+	sync_count++;
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+/*
+Returns the number of syncs to disk made so far
+ */
+unsigned long GetSyncCount()
+{
+	return sync_count.load();
+}
+
+
+/***********************************************************
+***************** FILE SYSTEM FUNCTIONS ********************
+************************************************************/
+/*
+Checks if a file can be opened for reading
+ */
+bool FileExists(const std::string &filepath)
+{
+	std::FILE* file = std::fopen(filepath.c_str(), "rb");
+	if (file == nullptr) return false;
+	std::fclose(file);
+	return true;
+}
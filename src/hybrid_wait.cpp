@@ -0,0 +1,267 @@
+/*
+File: hybrid_wait.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the hybrid wait. The spin yields on every
+pass so the acquisition and writer threads still get a core
+while a loop spins. CPU use is taken from the thread's own
+CPU clock around each wait; on Windows that clock only
+advances once per scheduler tick, so it is only meaningful
+over many waits. Windows sleeps are made with a 1 ms timer
+resolution, requested once on the first sleep.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "hybrid_wait.hpp"
+
+// other misc standard libraries
+#include <atomic>
+#include <thread>
+
+// platform specific libraries
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#else
+#include <time.h>
+#endif
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// running statistics of the waits made in one mode
+struct WaitStats
+{
+	LatencyHistogram			lateness;
+	std::atomic<std::uint64_t>	late;
+	std::atomic<std::uint64_t>	cpu_ns;
+	std::atomic<std::uint64_t>	wall_ns;
+
+	WaitStats() : late(0), cpu_ns(0), wall_ns(0) {}
+};
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+/*
+Returns the statistics of a wait mode
+ */
+static WaitStats& GetWaitStats(WaitMode mode)
+{
+	static WaitStats stats[kWaitModes_];
+	return stats[(int)mode];
+}
+
+/*
+Returns the configuration used by waits that do not pass one
+ */
+static WaitConfig& GetWaitConfig()
+{
+	static WaitConfig config;
+	return config;
+}
+
+
+/***********************************************************
+******************* PLATFORM FUNCTIONS *********************
+************************************************************/
+/*
+Returns the CPU time used by the calling thread in nanoseconds
+ */
+static std::uint64_t GetThreadCpuTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exited, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exited, &kernel, &user)) return 0;
+	std::uint64_t kernel_time = ((std::uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	std::uint64_t user_time = ((std::uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (kernel_time + user_time) * 100;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) return 0;
+	return (std::uint64_t)time.tv_sec * 1000000000ull + (std::uint64_t)time.tv_nsec;
+#endif
+}
+
+/*
+Sleeps until the given time, at the finest timer resolution
+the platform offers
+ */
+static void SleepUntil(std::chrono::steady_clock::time_point time)
+{
+#ifdef _WIN32
+	static const bool resolution_set = timeBeginPeriod(1) == TIMERR_NOERROR;
+	(void)resolution_set;
+#endif
+	std::this_thread::sleep_until(time);
+}
+
+
+/***********************************************************
+**************** CONFIGURATION FUNCTIONS *******************
+************************************************************/
+/*
+Sets the configuration used by waits that do not pass one.
+Meant to be called once at startup, before any loop runs.
+ */
+void SetDefaultWaitConfig(const WaitConfig &config)
+{
+	GetWaitConfig() = config;
+}
+
+/*
+Returns the configuration used by waits that do not pass one
+ */
+const WaitConfig& GetDefaultWaitConfig()
+{
+	return GetWaitConfig();
+}
+
+/*
+Returns the command line name of a wait mode
+ */
+const char* GetWaitModeName(WaitMode mode)
+{
+	switch (mode)
+	{
+	case WaitMode::Sleep:	return "sleep";
+	case WaitMode::Spin:	return "spin";
+	default:				return "hybrid";
+	}
+}
+
+/*
+Reads a wait mode from its command line name, returning false
+for an unknown name
+ */
+bool ParseWaitMode(const std::string &name, WaitMode &mode)
+{
+	for (int i = 0; i < kWaitModes_; i++)
+	{
+		if (name == GetWaitModeName((WaitMode)i))
+		{
+			mode = (WaitMode)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/***********************************************************
+******************** WAITING FUNCTIONS *********************
+************************************************************/
+/*
+Waits until the deadline with the default configuration
+ */
+std::uint64_t WaitUntil(std::chrono::steady_clock::time_point deadline)
+{
+	return WaitUntil(deadline, GetWaitConfig());
+}
+
+/*
+Waits until the deadline in the configured mode and returns
+how late it woke in nanoseconds
+ */
+std::uint64_t WaitUntil(std::chrono::steady_clock::time_point deadline, const WaitConfig &config)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::uint64_t cpu_start = GetThreadCpuTime();
+
+	// sleeps the part of the wait that is not spun
+	std::chrono::steady_clock::time_point wake = deadline;
+	if (config.mode == WaitMode::Hybrid)
+		wake -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config.spin_threshold));
+	if (config.mode != WaitMode::Spin && start < wake)
+		SleepUntil(wake);
+
+	// spins the rest of the way
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (config.mode != WaitMode::Sleep)
+	{
+		while (now < deadline)
+		{
+			std::this_thread::yield();
+			now = std::chrono::steady_clock::now();
+		}
+	}
+
+	// records the accuracy and CPU use of the wait
+	std::uint64_t lateness = now > deadline ?
+		(std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count() : 0;
+	WaitStats &stats = GetWaitStats(config.mode);
+	stats.lateness.Record(lateness);
+	if (lateness > (std::uint64_t)(kWaitAccuracyTarget_ * 1e9))
+		stats.late.fetch_add(1, std::memory_order_relaxed);
+	stats.cpu_ns.fetch_add(GetThreadCpuTime() - cpu_start, std::memory_order_relaxed);
+	stats.wall_ns.fetch_add((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count(),
+		std::memory_order_relaxed);
+	return lateness;
+}
+
+
+/***********************************************************
+******************* STATISTIC FUNCTIONS ********************
+************************************************************/
+/*
+Returns the accuracy and CPU use of the waits made in a mode
+ */
+WaitSummary GetWaitSummary(WaitMode mode)
+{
+	const WaitStats &stats = GetWaitStats(mode);
+	WaitSummary summary;
+	summary.waits =	stats.lateness.GetCount();
+	summary.late =	stats.late.load(std::memory_order_relaxed);
+	summary.p50 =	stats.lateness.GetPercentile(50.0) * 1e-3;
+	summary.p99 =	stats.lateness.GetPercentile(99.0) * 1e-3;
+	summary.max =	stats.lateness.GetMax() * 1e-3;
+
+	std::uint64_t wall = stats.wall_ns.load(std::memory_order_relaxed);
+	if (wall > 0)
+		summary.cpu = (double)stats.cpu_ns.load(std::memory_order_relaxed) / wall;
+	return summary;
+}
+
+/*
+Prints the accuracy and CPU use of every mode that was used
+ */
+void PrintWaitReport(std::FILE* out)
+{
+	bool printed = false;
+	for (int i = 0; i < kWaitModes_; i++)
+	{
+		WaitSummary summary = GetWaitSummary((WaitMode)i);
+		if (summary.waits == 0) continue;
+		if (!printed)
+		{
+			std::fprintf(out, "%-22s %10s %8s %10s %10s %10s %8s\n", "Wait (us late)",
+				"waits", "late", "p50", "p99", "max", "cpu %");
+			printed = true;
+		}
+		std::fprintf(out, "%-22s %10llu %8llu %10.1f %10.1f %10.1f %8.1f\n", GetWaitModeName((WaitMode)i),
+			(unsigned long long)summary.waits, (unsigned long long)summary.late,
+			summary.p50, summary.p99, summary.max, summary.cpu * 100.0);
+	}
+}
+
+/*
+Clears the statistics of every mode
+ */
+void ResetWaitStats()
+{
+	for (int i = 0; i < kWaitModes_; i++)
+	{
+		WaitStats &stats = GetWaitStats((WaitMode)i);
+		stats.lateness.Reset();
+		stats.late.store(0, std::memory_order_relaxed);
+		stats.cpu_ns.store(0, std::memory_order_relaxed);
+		stats.wall_ns.store(0, std::memory_order_relaxed);
+	}
+}
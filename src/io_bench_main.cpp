@@ -0,0 +1,423 @@
+/*
+File: io_bench_main.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file is the Main file of the AIMS persistence benchmark.
+It replays a full session of synthetic trials through each
+way trial data can be saved, with the ABS responses journaled
+after every trial and compacted at the end of every condition
+the way RunExportUI does. For each format it reports the
+write throughput, files created, syncs to disk and the
+per-trial persistence latency, to choose storage settings for
+acquisition PCs and to catch regressions in how data is
+written. CSV files are written through MEL when it is found
+and otherwise with stdio in the same layout, so the CSV
+baseline can be measured without MEL. Returns a failure exit
+code if the directory cannot be written or anything failed
+to save.
+Usage: aims_io_bench [--trials N] [--samples N] [--sync]
+                     [--format csv|ftb|fts] [--dir path] [--keep]
+*/
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial formats and ABS journal
+#include "sample_buffer.hpp"
+#include "trial_log.hpp"
+#include "session_file.hpp"
+#include "response_journal.hpp"
+#include "file_io.hpp"
+
+// libraries for the trial CSV format
+#ifdef AIMS_HAVE_MEL
+#include <MEL/Logging/Csv.hpp>
+#endif
+
+// other misc standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+// constant variables
+const int	kDefaultTrials(3500);		// trials of a full subject session
+const int	kDefaultSamples(500);		// samples of a single trial
+const int	kTrialsPerCondition(350);	// trials between ABS exports (angles * trials)
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// results of one persistence format over the whole session
+struct IoResult
+{
+	std::string			format;
+	double				seconds;		// total time spent persisting
+	double				bytes;			// bytes in the files written
+	unsigned long		files;			// files created
+	unsigned long		syncs;			// syncs to disk
+	unsigned long		failures;		// trials or exports that failed to save
+	std::vector<double>	trial_latency;	// seconds to persist each trial
+	std::vector<double>	export_latency;	// seconds for each end of condition export
+};
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Returns the given percentile of a set of values
+*/
+double GetPercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty()) return 0.0;
+	std::size_t index = (std::size_t)(percentile / 100.0 * (values.size() - 1));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+/*
+Returns the size of a file in bytes, or zero if it does not exist
+*/
+double GetFileBytes(const std::string &filepath)
+{
+	std::FILE* file = std::fopen(filepath.c_str(), "rb");
+	if (file == nullptr) return 0.0;
+	double bytes = (double)FileSize(file);
+	std::fclose(file);
+	return bytes;
+}
+
+/*
+Writes the header row of a CSV file, replacing the file
+*/
+bool WriteCsvHeader(const std::string &filepath, const std::vector<std::string> &names)
+{
+#ifdef AIMS_HAVE_MEL
+	return mel::csv_write_row(filepath, names);
+#else
+	std::FILE* file = std::fopen(filepath.c_str(), "w");
+	if (file == nullptr) return false;
+	for (std::size_t i = 0; i < names.size(); i++)
+		std::fprintf(file, i == 0 ? "%s" : ",%s", names[i].c_str());
+	std::fputc('\n', file);
+	return std::fclose(file) == 0;
+#endif
+}
+
+/*
+Appends rows of values to a CSV file
+*/
+bool AppendCsvRows(const std::string &filepath, const std::vector<std::vector<double>> &rows)
+{
+#ifdef AIMS_HAVE_MEL
+	return mel::csv_append_rows(filepath, rows);
+#else
+	std::FILE* file = std::fopen(filepath.c_str(), "a");
+	if (file == nullptr) return false;
+	for (std::size_t i = 0; i < rows.size(); i++)
+	{
+		for (std::size_t j = 0; j < rows[i].size(); j++)
+			std::fprintf(file, j == 0 ? "%g" : ",%g", rows[i][j]);
+		std::fputc('\n', file);
+	}
+	bool written = !std::ferror(file);
+	return std::fclose(file) == 0 && written;
+#endif
+}
+
+/*
+Returns true if files can be created in a directory, checked
+by creating and removing a probe file
+*/
+bool IsWritableDirectory(const std::string &directory)
+{
+	const std::string kProbePath(directory + "/iobench_probe.tmp");
+	std::FILE* file = std::fopen(kProbePath.c_str(), "wb");
+	if (file == nullptr) return false;
+	std::fclose(file);
+	std::remove(kProbePath.c_str());
+	return true;
+}
+
+/*
+Fills a trial buffer with a movement-shaped trial of synthetic
+samples
+*/
+void FillTrial(SampleBuffer &buffer, int samples)
+{
+	buffer.Clear();
+	for (int i = 0; i < samples; i++)
+	{
+		double phase = (double)i / samples;
+		double position = 30.0 * std::sin(3.14159265358979 * phase);
+		double force[3] =	{ 0.10 * position, -0.02 * position, 1.5 + 0.01 * i };
+		double torque[3] =	{ 0.001 * i, -0.003 * position, 0.0005 * position };
+		buffer.Append((unsigned int)i,
+			30.0, position,		force, torque,
+			-30.0, -position,	force, torque,
+			i * 1e-3);
+	}
+}
+
+/*
+Returns the file a trial is saved in for the per-trial formats
+*/
+std::string GetTrialPath(const std::string &directory, const TrialLogInfo &info, const std::string &extension)
+{
+	return directory + "/iobench_sub" + std::to_string(info.subject) + "_" + std::to_string(info.iteration) + "_" + info.trial_name + "_data" + extension;
+}
+
+
+/***********************************************************
+******************* BENCHMARK FUNCTIONS ********************
+************************************************************/
+/*
+Saves every trial of a session in one format. Each trial's
+ABS response is journaled after its data is saved and the
+responses are compacted into the ABS data CSV at the end of
+every condition. Only files that were actually created are
+counted and sized.
+*/
+IoResult RunSession(const std::string &format, const std::string &directory,
+					int trial_count, int samples, bool sync, bool keep)
+{
+	IoResult result;
+	result.format =		format;
+	result.seconds =	0.0;
+	result.bytes =		0.0;
+	result.files =		0;
+	result.syncs =		0;
+	result.failures =	0;
+	result.trial_latency.reserve(trial_count);
+
+	const std::string kJournalPath(directory + "/iobench_ABS_journal.bin");
+	const std::string kAbsPath(directory + "/iobench_ABS_data.csv");
+	const std::string kSessionPath(directory + "/iobench_session" + kSessionExtension_);
+	std::vector<std::string> created;
+
+	// starts from a clean directory
+	std::remove(kJournalPath.c_str());
+	std::remove(kAbsPath.c_str());
+	std::remove(kSessionPath.c_str());
+
+	SampleBuffer trial_buffer(samples);
+	FillTrial(trial_buffer, samples);
+	const std::vector<std::string> kHeaderNames(kSampleChannelNames_.begin(), kSampleChannelNames_.end());
+	std::vector<std::vector<double>> output_rows;
+	std::vector<std::vector<double>> abs_rows;
+
+	unsigned long syncs = GetSyncCount();
+
+	// opens the files kept for the whole session
+	ResponseJournal journal;
+	if (!journal.Open(kJournalPath, 0)) result.failures++;
+	created.push_back(kJournalPath);
+	SessionWriter session;
+	if (format == "fts")
+	{
+		if (!session.Open(kSessionPath, 0)) result.failures++;
+		created.push_back(kSessionPath);
+	}
+
+	for (int trial = 0; trial < trial_count; trial++)
+	{
+		TrialLogInfo info;
+		info.subject =		0;
+		info.iteration =	trial + 1;
+		info.condition =	trial / kTrialsPerCondition;
+		info.angle_index =	trial % 7;
+		info.sample_rate =	1000.0;
+		info.trial_name =	"Bench_" + std::to_string(info.condition) + "_" + std::to_string(info.angle_index);
+		std::string filepath;
+
+		std::chrono::steady_clock::time_point trial_start = std::chrono::steady_clock::now();
+		bool saved = true;
+		if (format == "ftb")
+		{
+			// binary columnar trial log in its own file
+			filepath = GetTrialPath(directory, info, kTrialLogExtension_);
+			std::FILE* file = std::fopen(filepath.c_str(), "wb");
+			saved = file != nullptr && WriteTrialLog(file, info, trial_buffer);
+			if (file != nullptr)
+			{
+				if (sync && !SyncFile(file)) saved = false;
+				if (std::fclose(file) != 0) saved = false;
+			}
+		}
+		else if (format == "fts")
+		{
+			// trial appended to the session container
+			saved = session.Append(info, trial_buffer);
+			if (sync && !session.Sync()) saved = false;
+		}
+		else
+		{
+			// standard trial CSV layout, written like the trial writer does
+			filepath = GetTrialPath(directory, info, ".csv");
+			trial_buffer.GetRows(output_rows);
+			saved = WriteCsvHeader(filepath, kHeaderNames) && AppendCsvRows(filepath, output_rows);
+		}
+
+		// journals the ABS response given after the trial
+		std::vector<double> response = { (double)info.iteration, (double)info.condition, (double)info.angle_index, 52.0, 15.0, 1.0 };
+		if (!journal.Append(response)) saved = false;
+		double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - trial_start).count();
+		result.trial_latency.push_back(latency);
+		result.seconds += latency;
+		if (!saved) result.failures++;
+		if (!filepath.empty()) created.push_back(filepath);
+
+		// exports at the end of every condition like RunExportUI
+		if ((trial + 1) % kTrialsPerCondition == 0 || trial + 1 == trial_count)
+		{
+			std::chrono::steady_clock::time_point export_start = std::chrono::steady_clock::now();
+			bool exported = true;
+			if (session.IsOpen() && !session.Commit()) exported = false;
+			journal.GetUncompacted(abs_rows);
+			if (journal.GetCompactedSequence() == 0)
+			{
+				const std::vector<std::string> kAbsHeaderNames =
+				{
+					"Iteration",			"Condition",
+					"AngCurr",				"Interference Angle",
+					"Test Angle",			"Detected (1=Detected 2=Not Detected)"
+				};
+				exported = WriteCsvHeader(kAbsPath, kAbsHeaderNames) && exported;
+				created.push_back(kAbsPath);
+			}
+			exported = AppendCsvRows(kAbsPath, abs_rows) && exported;
+			if (!journal.MarkCompacted()) exported = false;
+			latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - export_start).count();
+			result.export_latency.push_back(latency);
+			result.seconds += latency;
+			if (!exported) result.failures++;
+		}
+	}
+
+	// closes the session files, syncing what is left
+	std::chrono::steady_clock::time_point close_start = std::chrono::steady_clock::now();
+	session.Close();
+	journal.Close();
+	result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - close_start).count();
+	result.syncs = GetSyncCount() - syncs;
+
+	// sizes up and removes what was written
+	for (std::size_t i = 0; i < created.size(); i++)
+	{
+		if (!FileExists(created[i])) continue;
+		result.files++;
+		result.bytes += GetFileBytes(created[i]);
+		if (!keep) std::remove(created[i].c_str());
+	}
+	return result;
+}
+
+/*
+Prints the results of one persistence format
+*/
+void PrintResult(const IoResult &result)
+{
+	double megabytes = result.bytes / (1024.0 * 1024.0);
+	std::printf("%-6s %9.1f %9.1f %7lu %7lu %9.3f %9.3f %9.3f %10.3f %6lu\n",
+		result.format.c_str(), megabytes,
+		result.seconds > 0.0 ? megabytes / result.seconds : 0.0,
+		result.files, result.syncs,
+		GetPercentile(result.trial_latency, 50.0) * 1e3,
+		GetPercentile(result.trial_latency, 99.0) * 1e3,
+		GetPercentile(result.trial_latency, 100.0) * 1e3,
+		GetPercentile(result.export_latency, 99.0) * 1e3,
+		result.failures);
+}
+
+
+/***********************************************************
+********************* MAIN FUNCTION ************************
+************************************************************/
+/*
+Runs the session through each selected format and prints
+the report
+*/
+int main(int argc, char* argv[])
+{
+	// parses the command line
+	int			trial_count = kDefaultTrials;
+	int			samples = kDefaultSamples;
+	bool		sync = false;
+	bool		keep = false;
+	std::string	directory = ".";
+	std::vector<std::string> formats;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--trials" && i + 1 < argc)
+			trial_count = std::atoi(argv[++i]);
+		else if (option == "--samples" && i + 1 < argc)
+			samples = std::atoi(argv[++i]);
+		else if (option == "--format" && i + 1 < argc)
+			formats.push_back(argv[++i]);
+		else if (option == "--dir" && i + 1 < argc)
+			directory = argv[++i];
+		else if (option == "--sync")
+			sync = true;
+		else if (option == "--keep")
+			keep = true;
+		else
+		{
+			std::printf("Usage: aims_io_bench [--trials N] [--samples N] [--sync]\n"
+						"                     [--format csv|ftb|fts] [--dir path] [--keep]\n");
+			return option == "-h" || option == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (trial_count < 1 || samples < 1)
+	{
+		std::printf("Trials and samples must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!IsWritableDirectory(directory))
+	{
+		std::printf("Cannot create files in %s\n", directory.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// runs every format by default
+	if (formats.empty())
+	{
+		formats.push_back("csv");
+		formats.push_back("ftb");
+		formats.push_back("fts");
+	}
+
+	std::printf("Session: %d trials of %d samples in %s%s\n", trial_count, samples, directory.c_str(), sync ? ", synced per trial" : "");
+	std::printf("%-6s %9s %9s %7s %7s %9s %9s %9s %10s %6s\n",
+		"format", "MB", "MB/s", "files", "fsyncs", "p50 ms", "p99 ms", "max ms", "export p99", "failed");
+	unsigned long failures = 0;
+	for (std::size_t i = 0; i < formats.size(); i++)
+	{
+		if (formats[i] != "csv" && formats[i] != "ftb" && formats[i] != "fts")
+		{
+			std::printf("Unknown format %s\n", formats[i].c_str());
+			return EXIT_FAILURE;
+		}
+		IoResult result = RunSession(formats[i], directory, trial_count, samples, sync, keep);
+		PrintResult(result);
+		failures += result.failures;
+	}
+
+	if (failures > 0)
+	{
+		std::printf("%lu trials or exports failed to save\n", failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,438 @@
+/*
+File: key_events.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the KeyEventQueue class. Keys are only
+taken from the source while listening. In between, the
+console and terminal are left as they were for the menus
+read with std::cin, and an evdev device is not grabbed.
+Listening drops any input typed before it started. Evdev
+events carry the kernel's timestamp of the key, switched to
+the monotonic clock, while console and terminal events are
+timestamped as soon as the blocked read returns.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "key_events.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <cstring>
+
+// platform specific libraries
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the KeyEventQueue class
+ */
+KeyEventQueue::KeyEventQueue() :
+	handle_(-1),
+	open_(false),
+	listening_(false),
+	kernel_time_(false)
+{
+	std::memset(held_, 0, sizeof(held_));
+}
+
+/*
+Destructor for the KeyEventQueue class, restoring the source
+ */
+KeyEventQueue::~KeyEventQueue()
+{
+	Close();
+}
+
+
+/***********************************************************
+******************** SOURCE FUNCTIONS **********************
+************************************************************/
+/*
+Opens the key source: the evdev device at the given path, or
+the console when the path is empty. Returns false if the
+source cannot be read.
+ */
+bool KeyEventQueue::Open(const std::string &device)
+{
+	Close();
+	device_ = device;
+	kernel_time_ = false;
+
+#ifdef _WIN32
+	// evdev devices only exist on Linux
+	if (!device_.empty()) return false;
+	HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+	DWORD mode;
+	if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return false;
+#else
+	if (device_.empty())
+	{
+		// the terminal settings are restored when ignoring keys
+		if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &terminal_state_) != 0) return false;
+		handle_ = STDIN_FILENO;
+	}
+	else
+	{
+		handle_ = open(device_.c_str(), O_RDONLY | O_CLOEXEC);
+		if (handle_ < 0) return false;
+
+		// timestamps on the same clock as std::chrono::steady_clock
+		int clock = CLOCK_MONOTONIC;
+		kernel_time_ = ioctl(handle_, EVIOCSCLOCKID, &clock) == 0;
+	}
+#endif
+	open_ = true;
+	return true;
+}
+
+/*
+Closes and opens the last key source again, such as after an
+evdev keyboard was unplugged and plugged back in
+ */
+bool KeyEventQueue::Reopen()
+{
+	std::string device = device_;
+	return Open(device);
+}
+
+/*
+Stops listening and closes the key source
+ */
+void KeyEventQueue::Close()
+{
+	if (!open_) return;
+	Ignore();
+#ifndef _WIN32
+	if (!device_.empty())
+		close(handle_);
+#endif
+	handle_ = -1;
+	open_ = false;
+}
+
+/*
+Returns true while a key source is open
+ */
+bool KeyEventQueue::IsOpen() const
+{
+	return open_;
+}
+
+
+/***********************************************************
+****************** LISTENING FUNCTIONS *********************
+************************************************************/
+/*
+Starts taking keys from the source, dropping anything typed
+before now
+ */
+void KeyEventQueue::Listen()
+{
+	if (!open_ || listening_) return;
+	pending_.clear();
+	std::memset(held_, 0, sizeof(held_));
+
+#ifdef _WIN32
+	FlushConsoleInputBuffer(GetStdHandle(STD_INPUT_HANDLE));
+#else
+	if (device_.empty())
+	{
+		// reads single unechoed characters, Ctrl+C still interrupts
+		termios raw = terminal_state_;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(handle_, TCSANOW, &raw);
+		tcflush(handle_, TCIFLUSH);
+	}
+	else
+	{
+		// keeps the keys from reaching the terminal too
+		ioctl(handle_, EVIOCGRAB, 1);
+		input_event events[64];
+		pollfd source = { handle_, POLLIN, 0 };
+		while (poll(&source, 1, 0) > 0 && read(handle_, events, sizeof(events)) > 0) {}
+	}
+#endif
+	listening_ = true;
+}
+
+/*
+Stops taking keys from the source and hands it back
+ */
+void KeyEventQueue::Ignore()
+{
+	if (!listening_) return;
+#ifndef _WIN32
+	if (device_.empty())
+		tcsetattr(handle_, TCSANOW, &terminal_state_);
+	else
+		ioctl(handle_, EVIOCGRAB, 0);
+#endif
+	listening_ = false;
+}
+
+
+/***********************************************************
+******************** EVENT FUNCTIONS ***********************
+************************************************************/
+/*
+Blocks until the next key event, listening if not already.
+A negative timeout waits forever. Returns false when the
+timeout passed or the source failed.
+ */
+bool KeyEventQueue::WaitForEvent(KeyEvent &event, double timeout)
+{
+	if (!open_ && pending_.empty()) return false;
+	Listen();
+
+	double deadline = GetKeyClock() + timeout;
+	while (pending_.empty())
+	{
+		double remaining = -1.0;
+		if (timeout >= 0.0)
+		{
+			remaining = deadline - GetKeyClock();
+			if (remaining < 0.0) return false;
+		}
+		if (!ReadSource(remaining)) return false;
+	}
+	event = pending_.front();
+	pending_.pop_front();
+	return true;
+}
+
+/*
+Queues an event as if it came from the source. Events pushed
+before listening starts are dropped along with stale input.
+ */
+void KeyEventQueue::Push(const KeyEvent &event)
+{
+	pending_.push_back(event);
+}
+
+/*
+Queues a decoded key event
+ */
+void KeyEventQueue::PushKey(KeyCode key, KeyAction action, double time, int code)
+{
+	KeyEvent event;
+	event.key =		key;
+	event.action =	action;
+	event.time =	time;
+	event.code =	code;
+	pending_.push_back(event);
+}
+
+
+/***********************************************************
+******************** READING FUNCTIONS *********************
+************************************************************/
+/*
+Blocks until the source has input or the timeout passes and
+decodes what it read. Returns false on timeout or failure.
+ */
+bool KeyEventQueue::ReadSource(double timeout)
+{
+	if (!open_) return false;
+#ifdef _WIN32
+	return ReadWindowsConsole(timeout);
+#else
+	return device_.empty() ? ReadTerminal(timeout) : ReadDevice(timeout);
+#endif
+}
+
+/*
+Reads the key records of the Windows console
+ */
+bool KeyEventQueue::ReadWindowsConsole(double timeout)
+{
+#ifdef _WIN32
+	HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+	DWORD wait = timeout < 0.0 ? INFINITE : (DWORD)(timeout * 1000.0);
+	if (WaitForSingleObject(console, wait) != WAIT_OBJECT_0) return false;
+
+	INPUT_RECORD records[32];
+	DWORD count = 0;
+	if (!ReadConsoleInputW(console, records, 32, &count)) return false;
+	double time = GetKeyClock();
+	for (DWORD i = 0; i < count; i++)
+	{
+		if (records[i].EventType != KEY_EVENT) continue;
+		const KEY_EVENT_RECORD &record = records[i].Event.KeyEvent;
+		int code = record.wVirtualKeyCode & 0xFF;
+
+		// a key held down repeats its press until released
+		if (record.bKeyDown && held_[code]) continue;
+		held_[code] = record.bKeyDown != FALSE;
+
+		KeyCode key = KeyCode::Other;
+		switch (code)
+		{
+		case VK_UP:			key = KeyCode::Up;			break;
+		case VK_DOWN:		key = KeyCode::Down;		break;
+		case VK_LEFT:		key = KeyCode::Left;		break;
+		case VK_RIGHT:		key = KeyCode::Right;		break;
+		case VK_ADD:		key = KeyCode::Add;			break;
+		case VK_SUBTRACT:	key = KeyCode::Subtract;	break;
+		case VK_OEM_COMMA:	key = KeyCode::Comma;		break;
+		case VK_OEM_PERIOD:	key = KeyCode::Period;		break;
+		case VK_ESCAPE:		key = KeyCode::Escape;		break;
+		}
+		PushKey(key, record.bKeyDown ? KeyAction::Press : KeyAction::Release, time, code);
+	}
+	return true;
+#else
+	(void)timeout;
+	return false;
+#endif
+}
+
+/*
+Reads characters from a Linux terminal, decoding the escape
+sequences of the arrow keys
+ */
+bool KeyEventQueue::ReadTerminal(double timeout)
+{
+#ifndef _WIN32
+	pollfd source = { handle_, POLLIN, 0 };
+	if (poll(&source, 1, timeout < 0.0 ? -1 : (int)(timeout * 1000.0)) <= 0) return false;
+
+	unsigned char input[32];
+	ssize_t count = read(handle_, input, sizeof(input));
+	if (count <= 0) return false;
+	double time = GetKeyClock();
+	for (ssize_t i = 0; i < count; i++)
+	{
+		int code = input[i];
+		KeyCode key = KeyCode::Other;
+		if (code == 0x1B && i + 2 < count && (input[i + 1] == '[' || input[i + 1] == 'O'))
+		{
+			// ESC [ A to D are the arrow keys
+			code = input[i + 2];
+			i += 2;
+			switch (code)
+			{
+			case 'A':	key = KeyCode::Up;		break;
+			case 'B':	key = KeyCode::Down;	break;
+			case 'C':	key = KeyCode::Right;	break;
+			case 'D':	key = KeyCode::Left;	break;
+			}
+		}
+		else
+		{
+			switch (code)
+			{
+			case '+':	key = KeyCode::Add;			break;
+			case '-':	key = KeyCode::Subtract;	break;
+			case ',':	key = KeyCode::Comma;		break;
+			case '.':	key = KeyCode::Period;		break;
+			case 0x1B:	key = KeyCode::Escape;		break;
+			}
+		}
+
+		// terminals never report releases
+		PushKey(key, KeyAction::Press, time, code);
+		PushKey(key, KeyAction::Release, time, code);
+	}
+	return true;
+#else
+	(void)timeout;
+	return false;
+#endif
+}
+
+/*
+Reads the key events of a Linux evdev device
+ */
+bool KeyEventQueue::ReadDevice(double timeout)
+{
+#ifndef _WIN32
+	pollfd source = { handle_, POLLIN, 0 };
+	if (poll(&source, 1, timeout < 0.0 ? -1 : (int)(timeout * 1000.0)) <= 0) return false;
+
+	input_event events[64];
+	ssize_t bytes = read(handle_, events, sizeof(events));
+	if (bytes < (ssize_t)sizeof(input_event)) return false;
+	double read_time = GetKeyClock();
+	for (std::size_t i = 0; i < (std::size_t)bytes / sizeof(input_event); i++)
+	{
+		// a value of 2 is an auto-repeat of a held key
+		const input_event &input = events[i];
+		if (input.type != EV_KEY || input.value == 2) continue;
+
+		KeyCode key = KeyCode::Other;
+		switch (input.code)
+		{
+		case KEY_UP:		key = KeyCode::Up;			break;
+		case KEY_DOWN:		key = KeyCode::Down;		break;
+		case KEY_LEFT:		key = KeyCode::Left;		break;
+		case KEY_RIGHT:		key = KeyCode::Right;		break;
+		case KEY_KPPLUS:	key = KeyCode::Add;			break;
+		case KEY_KPMINUS:	key = KeyCode::Subtract;	break;
+		case KEY_COMMA:		key = KeyCode::Comma;		break;
+		case KEY_DOT:		key = KeyCode::Period;		break;
+		case KEY_ESC:		key = KeyCode::Escape;		break;
+		}
+#ifdef input_event_sec
+		double time = kernel_time_ ? input.input_event_sec + input.input_event_usec * 1e-6 : read_time;
+#else
+		double time = kernel_time_ ? input.time.tv_sec + input.time.tv_usec * 1e-6 : read_time;
+#endif
+		PushKey(key, input.value ? KeyAction::Press : KeyAction::Release, time, input.code);
+	}
+	return true;
+#else
+	(void)timeout;
+	return false;
+#endif
+}
+
+
+/***********************************************************
+********************* KEY FUNCTIONS ************************
+************************************************************/
+/*
+Returns the steady clock in seconds
+ */
+double GetKeyClock()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+Returns a printable name of a key
+ */
+const char* GetKeyName(KeyCode key)
+{
+	switch (key)
+	{
+	case KeyCode::Up:		return "Up";
+	case KeyCode::Down:		return "Down";
+	case KeyCode::Left:		return "Left";
+	case KeyCode::Right:	return "Right";
+	case KeyCode::Add:		return "Add";
+	case KeyCode::Subtract:	return "Subtract";
+	case KeyCode::Comma:	return "Comma";
+	case KeyCode::Period:	return "Period";
+	case KeyCode::Escape:	return "Escape";
+	default:				return "Other";
+	}
+}
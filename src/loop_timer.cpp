@@ -0,0 +1,101 @@
+/*
+File: loop_timer.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the LoopTimer class.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "loop_timer.hpp"
+
+// libraries for waiting on the schedule
+#include "hybrid_wait.hpp"
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the LoopTimer class, starting the schedule
+ */
+LoopTimer::LoopTimer(double hertz) :
+	period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / hertz))),
+	ticks_(0),
+	missed_(0)
+{
+	Restart();
+}
+
+
+/***********************************************************
+******************* TIMING FUNCTIONS ***********************
+************************************************************/
+/*
+Restarts the schedule from the current time
+ */
+void LoopTimer::Restart()
+{
+	start_ = std::chrono::steady_clock::now();
+	next_tick_ = start_ + period_;
+	ticks_ = 0;
+	missed_ = 0;
+}
+
+/*
+Waits until the next tick of the schedule
+ */
+void LoopTimer::Wait()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	ticks_++;
+	if (now >= next_tick_)
+	{
+		// already late, so the schedule restarts from now
+		missed_++;
+		next_tick_ = now + period_;
+		return;
+	}
+	WaitUntil(next_tick_);
+	next_tick_ += period_;
+}
+
+
+/***********************************************************
+******************** STATUS FUNCTIONS **********************
+************************************************************/
+/*
+Returns the seconds since the schedule started
+ */
+double LoopTimer::GetElapsed() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+}
+
+/*
+Returns the period of the schedule in seconds
+ */
+double LoopTimer::GetPeriod() const
+{
+	return std::chrono::duration<double>(period_).count();
+}
+
+/*
+Returns the number of waits so far
+ */
+unsigned long LoopTimer::GetTicks() const
+{
+	return ticks_;
+}
+
+/*
+Returns the number of waits that started after their tick
+ */
+unsigned long LoopTimer::GetMissed() const
+{
+	return missed_;
+}
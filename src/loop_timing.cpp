@@ -0,0 +1,183 @@
+/*
+File: loop_timing.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the LoopTiming class. Timestamps are kept
+in storage reserved up front so recording a tick never
+allocates inside the loop; ticks past the capacity still
+count towards the histogram.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "loop_timing.hpp"
+
+// other misc standard libraries
+#include <algorithm>
+#include <cstdio>
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the LoopTiming class
+ */
+LoopTiming::LoopTiming(std::size_t capacity) :
+	period_sum_(0.0)
+{
+	timestamps_.reserve(capacity);
+}
+
+
+/***********************************************************
+****************** RECORDING FUNCTIONS *********************
+************************************************************/
+/*
+Clears the recorded ticks and sets the nominal loop rate
+ */
+void LoopTiming::Start(double hertz)
+{
+	timestamps_.clear();
+	stats_ = LoopTimingStats();
+	stats_.nominal_period = hertz > 0.0 ? 1.0 / hertz : 0.0;
+	period_sum_ = 0.0;
+}
+
+/*
+Records a tick of the loop at the current time
+ */
+void LoopTiming::Tick()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (stats_.ticks == 0)
+		first_tick_ = now;
+	else
+	{
+		// bins the period since the last tick
+		double period = std::chrono::duration<double>(now - last_tick_).count();
+		int bin = kLoopTimingBins_ - 1;
+		if (GetBinWidth() > 0.0 && period / GetBinWidth() < (double)bin)
+			bin = (int)(period / GetBinWidth());
+		stats_.histogram[bin]++;
+
+		// tracks overruns and the worst lateness
+		double lateness = period - stats_.nominal_period;
+		if (lateness > kLoopOverrunTolerance_ * stats_.nominal_period)
+			stats_.overruns++;
+		stats_.max_lateness =	std::max(stats_.max_lateness, lateness);
+		stats_.max_period =		std::max(stats_.max_period, period);
+		period_sum_ += period;
+		stats_.mean_period = period_sum_ / (double)stats_.ticks;
+	}
+	last_tick_ = now;
+	stats_.ticks++;
+
+	// keeps the timestamp while there is reserved room for it
+	if (timestamps_.size() < timestamps_.capacity())
+		timestamps_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - first_tick_).count());
+}
+
+/*
+Adds the ticks of another loop with the same nominal rate,
+such as a trial added to its session total
+ */
+void LoopTiming::Merge(const LoopTimingStats &stats)
+{
+	if (stats.ticks == 0) return;
+	if (stats_.ticks == 0) stats_.nominal_period = stats.nominal_period;
+
+	// periods are one fewer than ticks in each loop
+	std::uint64_t periods = stats_.ticks > 0 ? stats_.ticks - 1 : 0;
+	std::uint64_t merged_periods = stats.ticks - 1;
+	period_sum_ = stats_.mean_period * (double)periods + stats.mean_period * (double)merged_periods;
+	if (periods + merged_periods > 0)
+		stats_.mean_period = period_sum_ / (double)(periods + merged_periods);
+
+	stats_.ticks +=			stats.ticks;
+	stats_.overruns +=		stats.overruns;
+	stats_.max_period =		std::max(stats_.max_period, stats.max_period);
+	stats_.max_lateness =	std::max(stats_.max_lateness, stats.max_lateness);
+	for (int bin = 0; bin < kLoopTimingBins_; bin++)
+		stats_.histogram[bin] += stats.histogram[bin];
+}
+
+
+/***********************************************************
+****************** ACCESSOR FUNCTIONS **********************
+************************************************************/
+/*
+Returns the summary of the recorded ticks
+ */
+const LoopTimingStats& LoopTiming::GetStats() const
+{
+	return stats_;
+}
+
+/*
+Returns the recorded tick times in nanoseconds since the
+first tick
+ */
+const std::vector<std::int64_t>& LoopTiming::GetTimestamps() const
+{
+	return timestamps_;
+}
+
+/*
+Returns the width of a histogram bin in seconds
+ */
+double LoopTiming::GetBinWidth() const
+{
+	return GetBinWidth(stats_);
+}
+
+/*
+Returns the width of a histogram bin of a summary in seconds
+ */
+double LoopTiming::GetBinWidth(const LoopTimingStats &stats)
+{
+	return stats.nominal_period / kLoopTimingBinsPerPeriod_;
+}
+
+
+/***********************************************************
+******************** TABLE FUNCTIONS ***********************
+************************************************************/
+/*
+Builds the column names of a timing summary row. Histogram
+columns are named by the lower edge of their bin.
+ */
+void GetLoopTimingHeader(const LoopTimingStats &stats, std::vector<std::string> &header_names)
+{
+	header_names =
+	{
+		"Ticks",				"Overruns",
+		"Mean Period (ms)",		"Max Period (ms)",
+		"Max Lateness (ms)"
+	};
+	char name[32];
+	for (int bin = 0; bin < kLoopTimingBins_; bin++)
+	{
+		std::snprintf(name, sizeof(name), "%s%.2f ms", bin == kLoopTimingBins_ - 1 ? ">=" : "", bin * LoopTiming::GetBinWidth(stats) * 1e3);
+		header_names.push_back(name);
+	}
+}
+
+/*
+Fills a timing summary row matching GetLoopTimingHeader
+ */
+void GetLoopTimingRow(const LoopTimingStats &stats, std::vector<double> &row)
+{
+	row =
+	{
+		(double)stats.ticks,		(double)stats.overruns,
+		stats.mean_period * 1e3,	stats.max_period * 1e3,
+		stats.max_lateness * 1e3
+	};
+	for (int bin = 0; bin < kLoopTimingBins_; bin++)
+		row.push_back((double)stats.histogram[bin]);
+}
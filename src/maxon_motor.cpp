@@ -7,7 +7,10 @@ This file defines the Maxon Motor class which holds all the
 lower level commands sent to the Maxon controllers in the 
 system. This specific version is customized to work with 
 the EPOS4 controller but it can be modified to work with 
-other controllers
+other controllers. The controller state is cached so enabling,
+disabling and the position profile only send the commands
+that are still needed, and a background thread re-reads the
+state between trials rather than on the trial path.
 */
 
 
@@ -17,8 +20,24 @@ other controllers
 // libraries for Maxon Motor Class
 #include "maxon_motor.hpp"
 
+// libraries for the session trace
+#include "trace.hpp"
+
 // other misc standard libraries
 #include <iostream>
+#include <string>
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Checks if an EPOS command library call failed
+ */
+static bool VcsFailed(BOOL result)
+{
+	return !result;
+}
+
 
 /***********************************************************
 ********************** CONSTRUCTOR *************************
@@ -27,10 +46,14 @@ other controllers
 Constructor for the maxonMotor class
  */
 MaxonMotor::MaxonMotor(mel::QuanserEncoder::Channel encoder) :
-	encoder_(encoder)
+	encoder_(encoder),
+	move_call_("VCS_MoveToPosition"),
+	fault_call_("VCS_GetFaultState"),
+	halt_call_("VCS_HaltPositionMovement")
 {
 	// initializing controller information
 	port_name_ = (char*)"USB0";
+	NameDriverCalls();
 	node_id_ =	1;
 	error_code_ = 0;
 	key_handle_ = 0;
@@ -42,6 +65,11 @@ MaxonMotor::MaxonMotor(mel::QuanserEncoder::Channel encoder) :
 	desired_velocity_ = 10000;
 	desired_acceleration_ = 100000;
 	desired_deceleration_ = 100000;
+
+	// the state check thread is started with the device
+	check_requested_ = false;
+	check_in_progress_ = false;
+	check_running_ = false;
 }
 
 /*
@@ -49,6 +77,7 @@ Destructor for the maxonMotor class
  */
 MaxonMotor::~MaxonMotor()
 {
+	StopCheckThread();
 }
 
 
@@ -57,85 +86,215 @@ MaxonMotor::~MaxonMotor()
 ************************************************************/
 /*
 Once the device has been opened, attempts to set the
-controller into position control mode.
+controller into position control mode. Only the steps the
+cached controller state shows are still needed are sent.
+Called with the device mutex held.
  */
 void MaxonMotor::EnableControl()
 {
-	BOOL in_fault = FALSE;
+	// reads the controller state if it is not cached yet
+	if (!state_.known)
+	{
+		QueryState();
+		if (!state_.known) return;
+	}
 
-	// checks the controller for any faults
-	if (VCS_GetFaultState(key_handle_, node_id_, &in_fault, &error_code_))
+	// attempts to clear the fault from the controller if in a fault
+	if (state_.in_fault)
 	{
-		// attempts to clear the fault from the controller if in a fault
-		if (in_fault && !VCS_ClearFault(key_handle_, node_id_, &error_code_))
+		if (!VCS_ClearFault(key_handle_, node_id_, &error_code_))
 		{
 			std::cout << "Clear fault failed!, error code = " << error_code_ << std::endl;
+			state_.known = false;
 			return;
 		}
+		state_.in_fault = false;
+	}
 
-		BOOL enabled = FALSE;
-
-		// attempts to enable controller
-		if (VCS_GetEnableState(key_handle_, node_id_, &enabled, &error_code_))
+	// attempts to enable controller
+	if (!state_.enabled)
+	{
+		if (!VCS_SetEnableState(key_handle_, node_id_, &error_code_))
 		{
-			if (!enabled && !VCS_SetEnableState(key_handle_, node_id_, &error_code_))
-			{
-				std::cout << "Set enable state failed!, error code = " << error_code_ << std::endl;
-			}
-			else
-			{
-				std::cout << "Set enable state succeeded!" << std::endl;
-			}
+			std::cout << "Set enable state failed!, error code = " << error_code_ << std::endl;
+			state_.known = false;
+		}
+		else
+		{
+			std::cout << "Set enable state succeeded!" << std::endl;
+			state_.enabled = true;
 		}
-	}
-	else
-	{
-		std::cout << "Get fault state failed!, error code = " << error_code_ << std::endl;
 	}
 
 	// attempts to set controller to position control mode
-	if (!VCS_ActivateProfilePositionMode(key_handle_, node_id_, &error_code_))
+	if (!state_.profile_mode)
 	{
-		std::cout << "Activate profile position mode failed!" << std::endl;
+		if (!VCS_ActivateProfilePositionMode(key_handle_, node_id_, &error_code_))
+		{
+			std::cout << "Activate profile position mode failed!" << std::endl;
+			state_.known = false;
+		}
+		else
+		{
+			state_.profile_mode = true;
+		}
 	}
 }
 
 /*
-Turns off the position control on the controller
+Turns off the position control on the controller. Called
+with the device mutex held.
  */
 void MaxonMotor::DisableControl()
 {
-	BOOL in_fault = FALSE;
+	// reads the controller state if it is not cached yet
+	if (!state_.known)
+	{
+		QueryState();
+		if (!state_.known) return;
+	}
 
-	// checks the controller for any faults
-	if (VCS_GetFaultState(key_handle_, node_id_, &in_fault, &error_code_))
+	// attempts to clear the fault from the controller if in a fault
+	if (state_.in_fault)
 	{
-		// attempts to clear the fault from the controller if in a fault
-		if (in_fault && !VCS_ClearFault(key_handle_, node_id_, &error_code_))
+		if (!VCS_ClearFault(key_handle_, node_id_, &error_code_))
 		{
 			std::cout << "Clear fault failed!, error code = " << error_code_ << std::endl;
+			state_.known = false;
 			return;
 		}
+		state_.in_fault = false;
+	}
+
+	// attempts to disable controller
+	if (state_.enabled)
+	{
+		if (!VCS_SetDisableState(key_handle_, node_id_, &error_code_))
+		{
+			std::cout << "Set disable state failed!, error code = " << error_code_ << std::endl;
+			state_.known = false;
+		}
+		else
+		{
+			std::cout << "Set disable state succeeded!" << std::endl;
+			state_.enabled = false;
+		}
+	}
+}
+
+/*
+Reads the fault, enable and operation mode state of the
+controller into the cache. Called with the device mutex held.
+ */
+void MaxonMotor::QueryState()
+{
+	BOOL	in_fault =	FALSE;
+	BOOL	enabled =	FALSE;
+	char	mode =		0;
+	state_.known = false;
+
+	// checks the controller for any faults
+	if (!TimedCall(fault_call_, [&] { return VCS_GetFaultState(key_handle_, node_id_, &in_fault, &error_code_); }, VcsFailed))
+	{
+		std::cout << "Get fault state failed!, error code = " << error_code_ << std::endl;
+		return;
+	}
+	if (!VCS_GetEnableState(key_handle_, node_id_, &enabled, &error_code_) ||
+		!VCS_GetOperationMode(key_handle_, node_id_, &mode, &error_code_))
+	{
+		std::cout << "Get controller state failed!, error code = " << error_code_ << std::endl;
+		return;
+	}
+
+	state_.in_fault =		in_fault == TRUE;
+	state_.enabled =		enabled == TRUE;
+	state_.profile_mode =	mode == OMD_PROFILE_POSITION_MODE;
+	state_.known =			true;
+}
+
+/*
+Sends the desired position profile to the controller unless
+it already holds it. Called with the device mutex held.
+ */
+void MaxonMotor::ApplyProfile()
+{
+	if (key_handle_ == 0) return;
+	if (state_.profile_applied &&
+		state_.velocity == desired_velocity_ &&
+		state_.acceleration == desired_acceleration_ &&
+		state_.deceleration == desired_deceleration_)
+		return;
+
+	if (!VCS_SetPositionProfile(key_handle_, node_id_, desired_velocity_, desired_acceleration_, desired_deceleration_, &error_code_))
+	{
+		std::cout << "Set position profile failed!, error code = " << error_code_ << std::endl;
+		state_.profile_applied = false;
+		return;
+	}
+	state_.profile_applied =	true;
+	state_.velocity =			desired_velocity_;
+	state_.acceleration =		desired_acceleration_;
+	state_.deceleration =		desired_deceleration_;
+}
 
-		BOOL enabled = FALSE;
+/*
+Main loop of the state check thread. Each requested check
+reads the controller state and restores position control and
+the profile if the controller dropped them.
+ */
+void MaxonMotor::CheckLoop()
+{
+	std::unique_lock<std::mutex> check_lock(check_mutex_);
+	while (true)
+	{
+		check_ready_.wait(check_lock, [this] { return check_requested_ || !check_running_; });
+		if (!check_running_)
+			break;
+		check_requested_ = false;
+		check_in_progress_ = true;
+		check_lock.unlock();
 
-		// attempts to disable controller
-		if (VCS_GetEnableState(key_handle_, node_id_, &enabled, &error_code_))
 		{
-			if (enabled && !VCS_SetDisableState(key_handle_, node_id_, &error_code_))
+			std::lock_guard<std::mutex> lock(device_mutex_);
+			QueryState();
+			if (state_.known && (state_.in_fault || !state_.enabled || !state_.profile_mode))
 			{
-				std::cout << "Set disable state failed!, error code = " << error_code_ << std::endl;
-			}
-			else
-			{
-				std::cout << "Set disable state succeeded!" << std::endl;
+				std::cout << "Controller on " << port_name_ << " lost position control, re-enabling" << std::endl;
+				EnableControl();
 			}
+			ApplyProfile();
 		}
+		check_lock.lock();
+		check_in_progress_ = false;
+		check_done_.notify_all();
 	}
-	else
+}
+
+/*
+Stops the state check thread if it is running
+ */
+void MaxonMotor::StopCheckThread()
+{
 	{
-		std::cout << "Get fault state failed!, error code = " << error_code_ << std::endl;
+		std::lock_guard<std::mutex> check_lock(check_mutex_);
+		check_running_ = false;
 	}
+	check_ready_.notify_all();
+	check_done_.notify_all();
+	if (check_thread_.joinable())
+		check_thread_.join();
+}
+
+/*
+Names the driver call latencies after the controller port
+so the two EPOS4s are reported apart
+ */
+void MaxonMotor::NameDriverCalls()
+{
+	std::string port = std::string(" (") + port_name_ + ")";
+	move_call_.SetName("VCS_MoveToPosition" + port);
+	fault_call_.SetName("VCS_GetFaultState" + port);
+	halt_call_.SetName("VCS_HaltPositionMovement" + port);
 }
 
 
@@ -154,6 +313,7 @@ void MaxonMotor::Start()
 	char interface_name[] =	"USB";
 
 	// Opens device communication
+	std::lock_guard<std::mutex> lock(device_mutex_);
 	key_handle_ = VCS_OpenDevice(device_name, protocol_name, interface_name, port_name_, &error_code_);
 	if (key_handle_ == 0)
 	{
@@ -164,8 +324,19 @@ void MaxonMotor::Start()
 		std::cout << "Open device success!" << std::endl;
 	}
 
-	// Enables device in position control mode
+	// Enables device in position control mode with the desired profile
+	state_ = EposState();
+	if (key_handle_ == 0) return;
 	EnableControl();
+	ApplyProfile();
+
+	// starts checking the controller state between trials
+	std::lock_guard<std::mutex> check_lock(check_mutex_);
+	if (!check_thread_.joinable())
+	{
+		check_running_ = true;
+		check_thread_ = std::thread(&MaxonMotor::CheckLoop, this);
+	}
 }
 
 /*
@@ -174,8 +345,13 @@ controller being referenced through USB comms.
  */
 void MaxonMotor::End()
 {
+	// stops checking the controller state
+	StopCheckThread();
+
 	// turns off position control
-	DisableControl();
+	std::lock_guard<std::mutex> lock(device_mutex_);
+	if (key_handle_ != 0)
+		DisableControl();
 
 	std::cout << "Closing Device!" << std::endl;
 
@@ -183,8 +359,10 @@ void MaxonMotor::End()
 	if (key_handle_ != 0)
 	{
 		VCS_CloseDevice(key_handle_, &error_code_);
+		key_handle_ = 0;
 	}
 	VCS_CloseAllDevices(&error_code_);
+	state_ = EposState();
 }
 
 
@@ -198,6 +376,7 @@ connected to.
 void MaxonMotor::SetPort(char* port)
 {
 	port_name_ = port;
+	NameDriverCalls();
 }
 
 /*
@@ -209,12 +388,51 @@ void MaxonMotor::SetControlParam(
 	unsigned int desired_acceleration, 
 	unsigned int desired_deceleration)
 {
+	std::lock_guard<std::mutex> lock(device_mutex_);
 	desired_velocity_ =		desired_velocity;
 	desired_acceleration_ =	desired_acceleration;
 	desired_deceleration_ =	desired_deceleration;
 	
-	// sets the controller's control parameters
-	// SetControlParam();
+	// sets the controller's control parameters if they changed
+	ApplyProfile();
+}
+
+/*
+Sets the tolerances deciding when a move has settled
+ */
+void MaxonMotor::SetSettleConfig(const SettleConfig &config)
+{
+	settle_.SetConfig(config);
+}
+
+
+/***********************************************************
+*************** CONTROLLER STATE FUNCTIONS *****************
+************************************************************/
+/*
+Asks the state check thread to read the controller state in
+the background, such as between conditions. A move commanded
+while the check is running waits for it to finish, delaying
+this motor behind the other, so checks are only requested
+where no trial follows before WaitForCheck.
+ */
+void MaxonMotor::CheckState()
+{
+	{
+		std::lock_guard<std::mutex> check_lock(check_mutex_);
+		if (!check_running_) return;
+		check_requested_ = true;
+	}
+	check_ready_.notify_one();
+}
+
+/*
+Waits until every requested state check has finished
+ */
+void MaxonMotor::WaitForCheck()
+{
+	std::unique_lock<std::mutex> check_lock(check_mutex_);
+	check_done_.wait(check_lock, [this] { return (!check_requested_ && !check_in_progress_) || !check_running_; });
 }
 
 
@@ -227,17 +445,29 @@ Commands motor controller to move motor to specified position
  */
 void MaxonMotor::Move(double desired_position)
 {
+	TraceSpan span("MaxonMotor::Move", "motor");
 	BOOL absolute_flag =	TRUE; 
 	BOOL immediate_flag =	TRUE;
 
+	// waits for any state check in progress
+	std::lock_guard<std::mutex> lock(device_mutex_);
+
 	// convert from degrees to encoder counts
 	desired_position_ = desired_position * kDegreesToCount_;
 
+	// watches the move from the last latched position
+	settle_.Start(desired_position_, encoder_.get_value());
+
 	// sends signal to move Maxon motor to specified position
-	if (!VCS_MoveToPosition(key_handle_, node_id_, (long)desired_position_, absolute_flag, immediate_flag, &error_code_)) 
+	if (!TimedCall(move_call_, [&] {
+			return VCS_MoveToPosition(key_handle_, node_id_, (long)desired_position_, absolute_flag, immediate_flag, &error_code_); },
+			VcsFailed))
 	{
 		std::cout << "Move to position failed!, error code = " << error_code_ << std::endl;
 		Halt();
+
+		// the next state check reads the controller again
+		state_.known = false;
 	}
 }
 
@@ -254,12 +484,12 @@ void MaxonMotor::GetPosition(double& position)
 }
 
 /*
-Pings motor to stop
+Pings motor to stop. Called with the device mutex held.
  */
 void MaxonMotor::Halt()
 {
 	// attempts to stop motor in its place
-	if (!VCS_HaltPositionMovement(key_handle_, node_id_, &error_code_))
+	if (!TimedCall(halt_call_, [&] { return VCS_HaltPositionMovement(key_handle_, node_id_, &error_code_); }, VcsFailed))
 	{
 		std::cout << "Halt position movement failed!, error code = " << error_code_ << std::endl;
 	}
@@ -267,30 +497,13 @@ void MaxonMotor::Halt()
 
 /*
 Checks to see if the motor is still moving or if it has
-reached its final destination
+settled at its final destination
 */
 BOOL MaxonMotor::TargetReached()
 {
-	BOOL target_reached = FALSE;
-
 	// update the position of the encoder
 	actual_position_ = encoder_.get_value();
-	
-	// set limits for the motor reaching its desired target
-	int small_limit = 5;
-	int large_limit = 500;
-
-	// if within 5 encoder clicks of the desired position end data logging
-	// switches the fidelity of the switch based on if it is large or small
-	// or if it is heading to zero
-	if(desired_position_ < 1000) {
-		if(abs(actual_position_ - desired_position_) <= small_limit)
-			target_reached = TRUE;
-	}
-	else if(desired_position_ >= 1000) {
-		if(abs(actual_position_ - desired_position_) <= large_limit)
-			target_reached = TRUE;
-	}
 
-	return target_reached;
+	// settled once close to the target and still for the dwell time
+	return settle_.Update(actual_position_, GetSettleClock()) ? TRUE : FALSE;
 }
\ No newline at end of file
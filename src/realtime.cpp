@@ -0,0 +1,435 @@
+/*
+File: realtime.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the real-time mode. Memory is locked with
+mlockall for current and future pages. The heap is grown by
+one large block that is touched and freed with trimming and
+mmap allocations turned off, so later allocations reuse pages
+that are already resident. Locking is skipped unless the
+process may lock unlimited memory, through RLIMIT_MEMLOCK or
+CAP_IPC_LOCK, since every later thread stack would otherwise
+fail to map once the limit is reached. Threads started after
+PrepareRealtime default to a small stack on glibc. The
+acquisition and motor command
+thread settings are tried on short-lived probe threads at
+startup, so the report covers every thread before the first
+trial runs.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "realtime.hpp"
+
+// libraries for the session trace
+#include "trace.hpp"
+
+// other misc standard libraries
+#include <cstring>
+#include <system_error>
+
+// platform specific libraries
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#endif
+
+
+/***********************************************************
+******************* MEMORY FUNCTIONS ***********************
+************************************************************/
+/*
+Touches every page of the given number of bytes of the
+calling thread's stack and returns the bytes touched
+ */
+static std::size_t PrefaultStack(std::size_t bytes)
+{
+	volatile unsigned char stack[kRealtimeStackPrefault_];
+	if (bytes > sizeof(stack)) bytes = sizeof(stack);
+	for (std::size_t i = 0; i < bytes; i += 4096)
+		stack[i] = 0;
+	return bytes;
+}
+
+/*
+Grows the heap by the given number of bytes, touching every
+page and keeping it in the process once freed. Returns the
+bytes pre-faulted.
+ */
+static std::size_t PrefaultHeap(std::size_t bytes)
+{
+#ifdef __GLIBC__
+	// freed memory stays in the heap instead of returning to the kernel
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	unsigned char* block = (unsigned char*)std::malloc(bytes);
+	if (block == nullptr) return 0;
+	for (std::size_t i = 0; i < bytes; i += 4096)
+		((volatile unsigned char*)block)[i] = 0;
+	std::free(block);
+	return bytes;
+#else
+	(void)bytes;
+	return 0;
+#endif
+}
+
+/*
+Returns an empty string when the process may lock all of its
+memory, or why it may not
+ */
+static std::string GetMemoryLockRefusal()
+{
+#ifdef _WIN32
+	return "not supported on Windows";
+#else
+	rlimit limit;
+	if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY)
+		return "";
+
+	// CAP_IPC_LOCK, bit 14 of the effective capabilities, lifts the limit
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, 7, "CapEff:") != 0) continue;
+		unsigned long long capabilities = std::strtoull(line.c_str() + 7, nullptr, 16);
+		if (capabilities & (1ull << 14)) return "";
+	}
+	return "RLIMIT_MEMLOCK is " + std::to_string((unsigned long long)limit.rlim_cur / 1024) +
+		" KiB without CAP_IPC_LOCK, not locked";
+#endif
+}
+
+/*
+Gives every thread started from now on a small fixed stack,
+so locked memory does not have to hold a full default stack
+for each of them
+ */
+static void SetDefaultThreadStack()
+{
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+	pthread_attr_t attributes;
+	if (pthread_attr_init(&attributes) != 0) return;
+	if (pthread_attr_setstacksize(&attributes, kRealtimeThreadStack_) == 0)
+		pthread_setattr_default_np(&attributes);
+	pthread_attr_destroy(&attributes);
+#endif
+}
+
+/*
+Runs the settings of a real-time thread on a short-lived probe
+thread and returns what it was granted
+ */
+static RealtimeThreadReport ProbeRealtime(int priority, int cpu)
+{
+	RealtimeThreadReport report;
+	report.cpu = cpu;
+	try
+	{
+		std::thread probe([&report, priority, cpu] { report = EnterRealtime(priority, cpu); });
+		probe.join();
+	}
+	catch (const std::system_error &error)
+	{
+		report.error = std::string("thread: ") + error.what();
+	}
+	return report;
+}
+
+/*
+Returns true when the kernel is built with PREEMPT_RT
+ */
+static bool IsPreemptRt()
+{
+#ifdef _WIN32
+	return false;
+#else
+	std::ifstream realtime("/sys/kernel/realtime");
+	int enabled = 0;
+	if (realtime >> enabled && enabled == 1) return true;
+
+	utsname name;
+	return uname(&name) == 0 && std::strstr(name.version, "PREEMPT_RT") != nullptr;
+#endif
+}
+
+
+/***********************************************************
+******************* PROCESS FUNCTIONS **********************
+************************************************************/
+/*
+Returns the requested core, or the core from_end places
+before the last one when none was requested
+ */
+int GetRealtimeCpu(int requested, int from_end)
+{
+	if (requested >= 0) return requested;
+	int cores = (int)std::thread::hardware_concurrency();
+	int cpu = cores - 1 - from_end;
+	return cpu < 0 ? 0 : cpu;
+}
+
+/*
+Locks and pre-faults the process memory and checks that the
+acquisition and motor command threads can be given their
+priority and cores. Returns what was granted.
+ */
+RealtimeReport PrepareRealtime(const RealtimeConfig &config)
+{
+	RealtimeReport report;
+	report.preempt_rt = IsPreemptRt();
+
+	// locks only when the whole process fits under the limit
+	SetDefaultThreadStack();
+	report.memory_error = GetMemoryLockRefusal();
+#ifndef _WIN32
+	if (report.memory_error.empty())
+	{
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			report.memory_locked = true;
+		else
+			report.memory_error = std::string("mlockall: ") + std::strerror(errno);
+	}
+#endif
+	report.heap_prefaulted = PrefaultHeap(kRealtimeHeapPrefault_);
+
+	// tries the acquisition and command thread settings on probe threads
+	report.acquisition = ProbeRealtime(config.priority, GetRealtimeCpu(config.acquisition_cpu, 1));
+	for (int i = 0; i < 2; i++)
+		report.command[i] = ProbeRealtime(config.priority, GetRealtimeCpu(config.command_cpu[i], 2 + i));
+	return report;
+}
+
+
+/***********************************************************
+******************** THREAD FUNCTIONS **********************
+************************************************************/
+/*
+Gives the calling thread real-time priority, pins it to a
+core and pre-faults its stack. Returns what was granted.
+ */
+RealtimeThreadReport EnterRealtime(int priority, int cpu, std::size_t stack_prefault)
+{
+	RealtimeThreadReport report;
+	report.cpu = cpu;
+
+#ifdef _WIN32
+	if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+	{
+		report.scheduled = true;
+		report.priority = THREAD_PRIORITY_TIME_CRITICAL;
+	}
+	else
+		report.error = "SetThreadPriority failed with error " + std::to_string(GetLastError());
+
+	if (cpu < (int)(sizeof(DWORD_PTR) * 8) && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0)
+		report.pinned = true;
+	else if (report.error.empty())
+		report.error = "SetThreadAffinityMask failed for core " + std::to_string(cpu);
+#else
+	// SCHED_FIFO at the requested priority, clamped to the allowed range
+	sched_param param;
+	param.sched_priority = priority;
+	if (param.sched_priority > sched_get_priority_max(SCHED_FIFO))
+		param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+	if (param.sched_priority < sched_get_priority_min(SCHED_FIFO))
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+	int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (result == 0)
+	{
+		report.scheduled = true;
+		report.priority = param.sched_priority;
+	}
+	else
+		report.error = std::string("SCHED_FIFO: ") + std::strerror(result);
+
+	// the single core the thread may run on
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	result = EINVAL;
+	if (cpu < CPU_SETSIZE)
+	{
+		CPU_SET(cpu, &cpus);
+		result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+	if (result == 0)
+		report.pinned = true;
+	else if (report.error.empty())
+		report.error = "core " + std::to_string(cpu) + ": " + std::strerror(result);
+#endif
+
+	report.stack_prefaulted = PrefaultStack(stack_prefault);
+	return report;
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the RealtimeThread class. The thread is only
+started by Start.
+ */
+RealtimeThread::RealtimeThread() :
+	job_(nullptr),
+	running_(false),
+	started_(false)
+{
+}
+
+/*
+Destructor for the RealtimeThread class, stopping the thread
+ */
+RealtimeThread::~RealtimeThread()
+{
+	Stop();
+}
+
+
+/***********************************************************
+**************** REALTIME THREAD FUNCTIONS *****************
+************************************************************/
+/*
+Main loop of the real-time thread. Enters real-time
+scheduling once, then runs every job handed to it.
+ */
+void RealtimeThread::WorkerLoop(int priority, int cpu)
+{
+	SetTraceThreadName("Motion (real-time)");
+	RealtimeThreadReport report = EnterRealtime(priority, cpu);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	report_ = report;
+	started_ = true;
+	job_done_.notify_all();
+	while (true)
+	{
+		job_ready_.wait(lock, [this] { return job_ != nullptr || !running_; });
+		if (job_ == nullptr)
+			break;
+		const std::function<void()>* job = job_;
+		lock.unlock();
+
+		(*job)();
+
+		lock.lock();
+		job_ = nullptr;
+		job_done_.notify_all();
+	}
+}
+
+/*
+Starts the thread at the given priority on the given core and
+returns what it was granted
+ */
+RealtimeThreadReport RealtimeThread::Start(int priority, int cpu)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!running_)
+	{
+		started_ = false;
+		try
+		{
+			thread_ = std::thread(&RealtimeThread::WorkerLoop, this, priority, cpu);
+		}
+		catch (const std::system_error &error)
+		{
+			// jobs keep running on the calling thread
+			RealtimeThreadReport report;
+			report.cpu = cpu;
+			report.error = std::string("thread: ") + error.what();
+			return report;
+		}
+		running_ = true;
+	}
+	job_done_.wait(lock, [this] { return started_; });
+	return report_;
+}
+
+/*
+Runs a job on the real-time thread and waits for it to
+finish. Runs it on the calling thread when not started.
+ */
+void RealtimeThread::Run(const std::function<void()> &job)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!running_)
+	{
+		lock.unlock();
+		job();
+		return;
+	}
+	job_ = &job;
+	job_ready_.notify_one();
+	job_done_.wait(lock, [this] { return job_ == nullptr; });
+}
+
+/*
+Stops the thread once its current job is done
+ */
+void RealtimeThread::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!running_) return;
+		running_ = false;
+	}
+	job_ready_.notify_all();
+	thread_.join();
+}
+
+/*
+Returns true while the thread is started. Only meant for the
+thread that starts and stops it.
+ */
+bool RealtimeThread::IsRunning() const
+{
+	return thread_.joinable();
+}
+
+
+/***********************************************************
+******************** REPORT FUNCTIONS **********************
+************************************************************/
+/*
+Prints a single thread's line of the report
+ */
+static void PrintThreadReport(const char* name, const RealtimeThreadReport &report, std::FILE* out)
+{
+	std::string priority = report.scheduled ? "priority " + std::to_string(report.priority) : "not real-time";
+	std::string core = report.pinned ? "core " + std::to_string(report.cpu) : "not pinned";
+	std::fprintf(out, "  %-20s%s, %s, %zu KiB stack pre-faulted%s%s\n", name, priority.c_str(), core.c_str(),
+		report.stack_prefaulted / 1024, report.error.empty() ? "" : " - ", report.error.c_str());
+}
+
+/*
+Prints which of the real-time guarantees were granted
+ */
+void PrintRealtimeReport(const RealtimeReport &report, std::FILE* out)
+{
+	std::fprintf(out, "Real-time mode on a %s kernel\n", report.preempt_rt ? "PREEMPT_RT" : "standard");
+	std::fprintf(out, "  %-20s%s%s%s\n", "Memory locked:", report.memory_locked ? "yes" : "no",
+		report.memory_error.empty() ? "" : " - ", report.memory_error.c_str());
+	std::fprintf(out, "  %-20s%zu MiB\n", "Heap pre-faulted:", report.heap_prefaulted / (1024 * 1024));
+	PrintThreadReport("Motion thread:", report.motion, out);
+	PrintThreadReport("Acquisition thread:", report.acquisition, out);
+	PrintThreadReport("Motor A commands:", report.command[0], out);
+	PrintThreadReport("Motor B commands:", report.command[1], out);
+}
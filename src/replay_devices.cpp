@@ -0,0 +1,374 @@
+/*
+File: replay_devices.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the replay devices. The sample being played
+only moves forward when the replayed DAQ is updated, so the
+recorded wrenches and motor positions stay paired however fast
+the loops run. Once the log runs out the motors report their
+targets reached so a replayed trial always ends.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "replay_devices.hpp"
+
+// libraries for the sample channel layout and drive train constants
+#include "sample_buffer.hpp"
+#include "motor_constants.hpp"
+
+// other misc standard libraries
+#include <cmath>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+// channels of a trial log, in the order of kSampleChannelNames_
+const int kReplayDesiredA(1);
+const int kReplayActualA(2);
+const int kReplayWrenchA(3);
+const int kReplayDesiredB(9);
+const int kReplayActualB(10);
+const int kReplayWrenchB(11);
+
+
+/***********************************************************
+******************** REPLAY LOG CLASS **********************
+************************************************************/
+/*
+Constructor for the ReplayLog class
+ */
+ReplayLog::ReplayLog() :
+	cursor_(0)
+{
+	data_.sample_count = 0;
+}
+
+/*
+Loads a binary trial log to play back
+ */
+bool ReplayLog::Open(const std::string &filepath)
+{
+	TrialLogData data;
+	if (!ReadTrialLog(filepath, data)) return false;
+	return Load(data);
+}
+
+/*
+Loads a trial already read back from a log or session. The
+log must hold every channel of a movement trial, except the
+time column that logs written before it do not have.
+ */
+bool ReplayLog::Load(const TrialLogData &data)
+{
+	if (data.channels.size() < (std::size_t)kSampleChannels_ - 1 || data.sample_count == 0)
+		return false;
+	data_ = data;
+	Rewind();
+	return true;
+}
+
+/*
+Starts playing from the first sample again
+ */
+void ReplayLog::Rewind()
+{
+	cursor_.store(0);
+}
+
+/*
+Moves on to the next sample. Returns false once the log has
+run out.
+ */
+bool ReplayLog::Advance()
+{
+	std::size_t cursor = cursor_.load(std::memory_order_relaxed);
+	if (cursor + 1 >= data_.sample_count) return false;
+	cursor_.store(cursor + 1, std::memory_order_release);
+	return true;
+}
+
+/*
+Returns true once the last sample is being played
+ */
+bool ReplayLog::IsFinished() const
+{
+	return cursor_.load(std::memory_order_acquire) + 1 >= data_.sample_count;
+}
+
+/*
+Returns the sample being played
+ */
+std::size_t ReplayLog::GetCursor() const
+{
+	return cursor_.load(std::memory_order_acquire);
+}
+
+/*
+Returns the number of samples in the log
+ */
+std::size_t ReplayLog::GetSampleCount() const
+{
+	return (std::size_t)data_.sample_count;
+}
+
+/*
+Returns a channel of the sample being played
+ */
+double ReplayLog::GetValue(int channel) const
+{
+	return GetValue(GetCursor(), channel);
+}
+
+/*
+Returns a channel of any sample
+ */
+double ReplayLog::GetValue(std::size_t row, int channel) const
+{
+	return data_.channels[channel].values[row];
+}
+
+/*
+Returns the description of the recorded trial
+ */
+const TrialLogInfo& ReplayLog::GetInfo() const
+{
+	return data_.info;
+}
+
+
+/***********************************************************
+******************** REPLAY DAQ CLASS **********************
+************************************************************/
+/*
+Constructor for the ReplayDaq class
+ */
+ReplayDaq::ReplayDaq(ReplayLog &log) :
+	log_(log),
+	values_(2 * kAtiAxes_, 0.0),
+	block_(),
+	exhausted_(false)
+{
+}
+
+/*
+Plays the next recorded sample. Returns false once every
+sample of the log has been played.
+ */
+bool ReplayDaq::update()
+{
+	if (exhausted_ || log_.GetSampleCount() == 0) return false;
+	for (int axis = 0; axis < kAtiAxes_; axis++)
+	{
+		values_[axis] =				log_.GetValue(kReplayWrenchA + axis);
+		values_[kAtiAxes_ + axis] =	log_.GetValue(kReplayWrenchB + axis);
+	}
+	exhausted_ = !log_.Advance();
+	return true;
+}
+
+/*
+Replays have no driver buffer to clear
+ */
+bool ReplayDaq::Restart()
+{
+	return true;
+}
+
+/*
+Replays deliver one sample per update
+ */
+bool ReplayDaq::IsBuffered() const
+{
+	return false;
+}
+
+/*
+Replays deliver one sample per update
+ */
+unsigned int ReplayDaq::GetBlockSize() const
+{
+	return 1;
+}
+
+/*
+Returns both wrenches of the sample last played
+ */
+const double* ReplayDaq::GetScanValues()
+{
+	return values_.data();
+}
+
+/*
+Replays do not read blocks
+ */
+const DaqBlock& ReplayDaq::GetBlock() const
+{
+	return block_;
+}
+
+/*
+Replays do not read blocks
+ */
+const double* ReplayDaq::GetBlockValues() const
+{
+	return values_.data();
+}
+
+
+/***********************************************************
+****************** REPLAY ENCODERS CLASS *******************
+************************************************************/
+/*
+Constructor for the ReplayEncoders class
+ */
+ReplayEncoders::ReplayEncoders(ReplayLog &log) :
+	log_(log),
+	position_{ 0.0, 0.0 },
+	time_(0.0)
+{
+}
+
+/*
+Latches the recorded motor positions of the sample being played
+ */
+bool ReplayEncoders::update_input()
+{
+	if (log_.GetSampleCount() == 0) return false;
+	std::size_t cursor = log_.GetCursor();
+	position_[0] = log_.GetValue(cursor, kReplayActualA);
+	position_[1] = log_.GetValue(cursor, kReplayActualB);
+	if (log_.GetInfo().sample_rate > 0.0)
+		time_ = (double)cursor / log_.GetInfo().sample_rate;
+	return true;
+}
+
+/*
+Returns the latched position of a motor in degrees
+ */
+double ReplayEncoders::GetPosition(int motor) const
+{
+	return position_[motor];
+}
+
+/*
+Returns the recorded time of the latched sample in seconds
+ */
+double ReplayEncoders::GetTime() const
+{
+	return time_;
+}
+
+/*
+Returns true once the log has run out
+ */
+bool ReplayEncoders::IsFinished() const
+{
+	return log_.IsFinished();
+}
+
+
+/***********************************************************
+******************** REPLAY MOTOR CLASS ********************
+************************************************************/
+/*
+Constructor for the ReplayMotor class
+ */
+ReplayMotor::ReplayMotor(ReplayEncoders &encoders, int motor) :
+	encoders_(encoders),
+	motor_(motor),
+	desired_position_(0.0)
+{
+}
+
+/*
+Records the commanded position in encoder counts
+ */
+void ReplayMotor::Move(double desired_position)
+{
+	desired_position_ = desired_position * kDegreesToCount_;
+	settle_.Start(desired_position_, encoders_.GetPosition(motor_) * kDegreesToCount_);
+}
+
+/*
+Sets the tolerances deciding when a move has settled
+ */
+void ReplayMotor::SetSettleConfig(const SettleConfig &config)
+{
+	settle_.SetConfig(config);
+}
+
+/*
+Returns the latched recorded position in degrees
+ */
+void ReplayMotor::GetPosition(double& position)
+{
+	position = encoders_.GetPosition(motor_);
+}
+
+/*
+Checks if the recorded position has settled at the commanded
+one the same way as MaxonMotor, timed by the recorded sample
+clock. Always true once the log has run out.
+ */
+bool ReplayMotor::TargetReached()
+{
+	if (encoders_.IsFinished()) return true;
+	return settle_.Update(encoders_.GetPosition(motor_) * kDegreesToCount_, encoders_.GetTime());
+}
+
+
+/***********************************************************
+****************** REPLAY TRANSFORM CLASS ******************
+************************************************************/
+/*
+Constructor for the ReplayTransform class
+ */
+ReplayTransform::ReplayTransform()
+{
+	for (std::size_t sensor = 0; sensor < wrenches_.size(); sensor++)
+		wrenches_[sensor].fill(0.0);
+}
+
+/*
+Takes both recorded wrenches of a sample
+ */
+void ReplayTransform::Update(const double* values)
+{
+	for (std::size_t sensor = 0; sensor < wrenches_.size(); sensor++)
+		for (int axis = 0; axis < kAtiAxes_; axis++)
+			wrenches_[sensor][axis] = values[sensor * kAtiAxes_ + axis];
+}
+
+/*
+Copies both recorded wrenches of each sample into caller storage
+ */
+void ReplayTransform::UpdateBlock(const double* values, std::size_t scans, Wrench* wrenches) const
+{
+	for (std::size_t scan = 0; scan < scans; scan++)
+		for (std::size_t sensor = 0; sensor < wrenches_.size(); sensor++)
+			for (int axis = 0; axis < kAtiAxes_; axis++)
+				wrenches[scan * wrenches_.size() + sensor][axis] = values[(scan * wrenches_.size() + sensor) * kAtiAxes_ + axis];
+}
+
+/*
+Copies the latest wrench of both sensors into caller storage
+ */
+void ReplayTransform::GetWrenches(Wrench* wrenches) const
+{
+	for (std::size_t sensor = 0; sensor < wrenches_.size(); sensor++)
+		wrenches[sensor] = wrenches_[sensor];
+}
+
+/*
+Replays always hold two sensors
+ */
+std::size_t ReplayTransform::GetSensorCount() const
+{
+	return wrenches_.size();
+}
@@ -0,0 +1,405 @@
+/*
+File: response_journal.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the ResponseJournal class. Every ABS
+response is appended to the journal as a fixed-size record
+carrying its row number in the ABS data and a checksum, so
+each write costs the same no matter how long the session
+has run. A sync thread groups records that arrive close
+together into a single sync to disk. When the responses are
+compacted into the ABS data CSV a marker record is appended
+so a reopened journal knows which rows are already saved.
+A reopened journal can start replaying at its last marker,
+so resuming only reads the records written since then.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "response_journal.hpp"
+
+// libraries for the portable file helpers
+#include "file_io.hpp"
+
+// other misc standard libraries
+#include <cstring>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::size_t kJournalReservedRows(512); // more than one condition of responses
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Computes the FNV-1a checksum of a record with its checksum
+field cleared
+ */
+static std::uint32_t GetChecksum(const JournalRecord &record)
+{
+	JournalRecord cleared = record;
+	cleared.checksum = 0;
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&cleared);
+	std::uint32_t checksum = 2166136261u;
+	for (std::size_t i = 0; i < sizeof(JournalRecord); i++)
+	{
+		checksum ^= bytes[i];
+		checksum *= 16777619u;
+	}
+	return checksum;
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the ResponseJournal class
+ */
+ResponseJournal::ResponseJournal() :
+	file_(nullptr),
+	next_sequence_(0),
+	compacted_sequence_(0),
+	compacted_offset_(0),
+	has_last_response_(false),
+	running_(false),
+	dirty_(false),
+	failed_syncs_(0)
+{
+}
+
+/*
+Destructor for the ResponseJournal class
+ */
+ResponseJournal::~ResponseJournal()
+{
+	Close();
+}
+
+
+/***********************************************************
+***************** FILE CONTROL FUNCTIONS *******************
+************************************************************/
+/*
+Opens the journal and starts the sync thread. An existing
+journal is replayed to find the responses that were never
+compacted. compacted_rows is the number of rows already
+saved in the ABS data CSV; journaled rows below it are
+treated as compacted. replay_offset is the position of a
+compaction marker to start replaying from, as returned by
+GetCompactedOffset; the whole journal is replayed if no
+marker is found there.
+ */
+bool ResponseJournal::Open(const std::string &filepath, std::uint64_t compacted_rows, std::int64_t replay_offset)
+{
+	Close();
+	next_sequence_ =		0;
+	compacted_sequence_ =	0;
+	compacted_offset_ =		0;
+	has_last_response_ =	false;
+	last_response_.fill(0.0);
+	uncompacted_.clear();
+	uncompacted_.reserve(kJournalReservedRows);
+
+	// replays an existing journal, otherwise creates a new one
+	if (FileExists(filepath))
+	{
+		file_ = std::fopen(filepath.c_str(), "r+b");
+		if (file_ == nullptr) return false;
+		if (replay_offset <= 0 || !ReplayRecords(replay_offset))
+			ReplayRecords(0);
+	}
+	else
+	{
+		file_ = std::fopen(filepath.c_str(), "w+b");
+		if (file_ == nullptr) return false;
+	}
+
+	// a new journal, or one older than the CSV, starts after the CSV rows
+	if (next_sequence_ <= compacted_rows)
+	{
+		if (next_sequence_ < compacted_rows) has_last_response_ = false;
+		uncompacted_.clear();
+		next_sequence_ =		compacted_rows;
+		compacted_sequence_ =	compacted_rows;
+	}
+	// rows found in the CSV were compacted before the marker was written
+	else if (compacted_rows > compacted_sequence_)
+	{
+		std::uint64_t saved = compacted_rows - compacted_sequence_;
+		if (saved > uncompacted_.size()) saved = uncompacted_.size();
+		uncompacted_.erase(uncompacted_.begin(), uncompacted_.begin() + (std::ptrdiff_t)saved);
+		compacted_sequence_ = compacted_rows;
+	}
+
+	// starts the sync thread
+	running_ = true;
+	dirty_ = false;
+	sync_thread_ = std::thread(&ResponseJournal::SyncLoop, this);
+	return true;
+}
+
+/*
+Syncs every appended record to disk before returning
+ */
+void ResponseJournal::Sync()
+{
+	if (file_ == nullptr) return;
+	if (!SyncFile(file_))
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		failed_syncs_++;
+	}
+}
+
+/*
+Stops the sync thread, syncs any remaining records and
+closes the journal
+ */
+void ResponseJournal::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	dirty_ready_.notify_all();
+	if (sync_thread_.joinable())
+		sync_thread_.join();
+
+	if (file_ == nullptr) return;
+	Sync();
+	std::fclose(file_);
+	file_ = nullptr;
+}
+
+
+/***********************************************************
+**************** JOURNAL RECORD FUNCTIONS ******************
+************************************************************/
+/*
+Appends a single record and hands it to the operating
+system. The sync thread makes it durable shortly after.
+ */
+bool ResponseJournal::WriteRecord(std::uint32_t type, std::uint64_t sequence, const double* values)
+{
+	JournalRecord record;
+	std::memset(&record, 0, sizeof(record));
+	record.type =		type;
+	record.sequence =	sequence;
+	if (values != nullptr)
+		std::memcpy(record.values, values, sizeof(record.values));
+	record.checksum =	GetChecksum(record);
+
+	if (std::fwrite(&record, sizeof(record), 1, file_) != 1) return false;
+	return std::fflush(file_) == 0;
+}
+
+/*
+Reads the records of an existing journal starting at offset.
+A non-zero offset must hold a compaction marker, otherwise
+nothing is replayed and false is returned. Stops at the
+first torn or corrupted record, which is cut off so new
+records follow the last good one.
+ */
+bool ResponseJournal::ReplayRecords(std::int64_t offset)
+{
+	JournalRecord	record;
+	std::int64_t	good_end = offset;
+	if (!FileSeek(file_, offset)) return false;
+
+	// a replay part way through must start at a compaction marker
+	if (offset > 0)
+	{
+		if (std::fread(&record, sizeof(record), 1, file_) != 1 ||
+			record.checksum != GetChecksum(record) ||
+			record.type != kJournalCompacted_)
+			return false;
+		FileSeek(file_, offset);
+	}
+
+	while (std::fread(&record, sizeof(record), 1, file_) == 1)
+	{
+		if (record.checksum != GetChecksum(record)) break;
+
+		if (record.type == kJournalResponse_)
+		{
+			std::array<double, kJournalColumns_> row;
+			std::memcpy(row.data(), record.values, sizeof(record.values));
+			uncompacted_.push_back(row);
+			next_sequence_ = record.sequence + 1;
+			last_response_ = row;
+			has_last_response_ = true;
+		}
+		else if (record.type == kJournalCompacted_)
+		{
+			uncompacted_.clear();
+			compacted_sequence_ = record.sequence;
+			compacted_offset_ = good_end;
+			if (next_sequence_ < record.sequence) next_sequence_ = record.sequence;
+		}
+		good_end += sizeof(record);
+	}
+
+	// drops any partially written record at the end
+	FileTruncate(file_, good_end);
+	FileSeek(file_, good_end);
+	return true;
+}
+
+
+/***********************************************************
+****************** SYNC THREAD FUNCTIONS *******************
+************************************************************/
+/*
+Main loop of the sync thread. Waits for new records, lets
+any others arriving right behind them batch up, and then
+syncs them all to disk at once.
+ */
+void ResponseJournal::SyncLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		dirty_ready_.wait(lock, [this] { return dirty_ || !running_; });
+		if (!dirty_)
+			break;
+
+		// gives closely spaced records a chance to share the sync
+		lock.unlock();
+		std::this_thread::sleep_for(kJournalSyncDelay_);
+		lock.lock();
+		dirty_ = false;
+
+		// syncs without blocking new appends
+		lock.unlock();
+		bool synced = SyncFile(file_);
+		lock.lock();
+		if (!synced) failed_syncs_++;
+	}
+}
+
+
+/***********************************************************
+******************* RESPONSE FUNCTIONS *********************
+************************************************************/
+/*
+Appends a single ABS response row to the journal
+ */
+bool ResponseJournal::Append(const std::vector<double> &row)
+{
+	std::array<double, kJournalColumns_> values;
+	values.fill(0.0);
+	for (std::size_t i = 0; i < row.size() && i < values.size(); i++)
+		values[i] = row[i];
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (file_ == nullptr) return false;
+		if (!WriteRecord(kJournalResponse_, next_sequence_, values.data())) return false;
+		uncompacted_.push_back(values);
+		next_sequence_++;
+		last_response_ = values;
+		has_last_response_ = true;
+		dirty_ = true;
+	}
+	dirty_ready_.notify_one();
+	return true;
+}
+
+/*
+Returns the row number the next response will be given
+ */
+std::uint64_t ResponseJournal::GetNextSequence()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return next_sequence_;
+}
+
+/*
+Copies out the last response replayed or appended. Returns
+false if the journal has seen no response since it was
+opened.
+ */
+bool ResponseJournal::GetLastResponse(std::vector<double> &row)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!has_last_response_) return false;
+	row.assign(last_response_.begin(), last_response_.end());
+	return true;
+}
+
+
+/***********************************************************
+****************** COMPACTION FUNCTIONS ********************
+************************************************************/
+/*
+Returns the number of rows already compacted into the CSV
+ */
+std::uint64_t ResponseJournal::GetCompactedSequence()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return compacted_sequence_;
+}
+
+/*
+Returns the position of the last compaction marker, which
+can be handed back to Open to skip replaying older records
+ */
+std::int64_t ResponseJournal::GetCompactedOffset()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return compacted_offset_;
+}
+
+/*
+Copies out the responses that still need to be appended to
+the ABS data CSV
+ */
+void ResponseJournal::GetUncompacted(std::vector<std::vector<double>> &rows)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	rows.resize(uncompacted_.size());
+	for (std::size_t i = 0; i < uncompacted_.size(); i++)
+		rows[i].assign(uncompacted_[i].begin(), uncompacted_[i].end());
+}
+
+/*
+Records that every response so far has been appended to the
+ABS data CSV
+ */
+bool ResponseJournal::MarkCompacted()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (file_ == nullptr) return false;
+		std::int64_t offset = FileTell(file_);
+		if (!WriteRecord(kJournalCompacted_, next_sequence_, nullptr)) return false;
+		compacted_offset_ = offset;
+		compacted_sequence_ = next_sequence_;
+		uncompacted_.clear();
+		dirty_ = true;
+	}
+	dirty_ready_.notify_one();
+	return true;
+}
+
+
+/***********************************************************
+******************* STATISTIC FUNCTIONS ********************
+************************************************************/
+/*
+Returns the number of syncs to disk that failed
+ */
+unsigned long ResponseJournal::GetFailedSyncs()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return failed_syncs_;
+}
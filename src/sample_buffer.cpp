@@ -0,0 +1,319 @@
+/*
+File: sample_buffer.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the SampleBuffer class which stores the
+samples logged during a movement trial as one typed column
+per logged field. Memory is only allocated when the buffer
+is sized, so appending samples in the control loop never
+allocates.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "sample_buffer.hpp"
+
+// other misc standard libraries
+#include <utility>
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the SampleBuffer class
+ */
+SampleBuffer::SampleBuffer(std::size_t capacity) :
+	capacity_(0),
+	size_(0),
+	dropped_(0)
+{
+	Reserve(capacity);
+}
+
+/*
+Move constructor for the SampleBuffer class. Takes over the
+columns of the other buffer without copying any samples.
+ */
+SampleBuffer::SampleBuffer(SampleBuffer&& other) :
+	capacity_(0),
+	size_(0),
+	dropped_(0)
+{
+	*this = std::move(other);
+}
+
+/*
+Move assignment for the SampleBuffer class. The other buffer
+is left empty with no capacity.
+ */
+SampleBuffer& SampleBuffer::operator=(SampleBuffer&& other)
+{
+	if (this == &other) return *this;
+
+	// buffer bookkeeping
+	capacity_ =	other.capacity_;
+	size_ =		other.size_;
+	dropped_ =	other.dropped_;
+	other.capacity_ =	0;
+	other.size_ =		0;
+	other.dropped_ =	0;
+
+	// sample counter column
+	sample_ = std::move(other.sample_);
+
+	// Motor/Sensor A columns
+	position_desired_a_ = std::move(other.position_desired_a_);
+	position_actual_a_ =  std::move(other.position_actual_a_);
+	force_x_a_ =	std::move(other.force_x_a_);
+	force_y_a_ =	std::move(other.force_y_a_);
+	force_z_a_ =	std::move(other.force_z_a_);
+	torque_x_a_ =	std::move(other.torque_x_a_);
+	torque_y_a_ =	std::move(other.torque_y_a_);
+	torque_z_a_ =	std::move(other.torque_z_a_);
+
+	// Motor/Sensor B columns
+	position_desired_b_ = std::move(other.position_desired_b_);
+	position_actual_b_ =  std::move(other.position_actual_b_);
+	force_x_b_ =	std::move(other.force_x_b_);
+	force_y_b_ =	std::move(other.force_y_b_);
+	force_z_b_ =	std::move(other.force_z_b_);
+	torque_x_b_ =	std::move(other.torque_x_b_);
+	torque_y_b_ =	std::move(other.torque_y_b_);
+	torque_z_b_ =	std::move(other.torque_z_b_);
+
+	// acquisition time column
+	time_ = std::move(other.time_);
+
+	return *this;
+}
+
+/*
+Destructor for the SampleBuffer class
+ */
+SampleBuffer::~SampleBuffer()
+{
+}
+
+
+/***********************************************************
+************** MEMORY MANAGEMENT FUNCTIONS *****************
+************************************************************/
+/*
+Sizes every column to hold the given number of samples.
+Should only be called once per session, outside of the
+control loop.
+ */
+void SampleBuffer::Reserve(std::size_t capacity)
+{
+	capacity_ = capacity;
+
+	// sample counter column
+	sample_.resize(capacity_);
+
+	// Motor/Sensor A columns
+	position_desired_a_.resize(capacity_);	position_actual_a_.resize(capacity_);
+	force_x_a_.resize(capacity_);	force_y_a_.resize(capacity_);	force_z_a_.resize(capacity_);
+	torque_x_a_.resize(capacity_);	torque_y_a_.resize(capacity_);	torque_z_a_.resize(capacity_);
+
+	// Motor/Sensor B columns
+	position_desired_b_.resize(capacity_);	position_actual_b_.resize(capacity_);
+	force_x_b_.resize(capacity_);	force_y_b_.resize(capacity_);	force_z_b_.resize(capacity_);
+	torque_x_b_.resize(capacity_);	torque_y_b_.resize(capacity_);	torque_z_b_.resize(capacity_);
+
+	// acquisition time column
+	time_.resize(capacity_);
+
+	// any previously logged samples are discarded
+	Clear();
+}
+
+/*
+Empties the buffer for the next trial without releasing
+any of its memory
+ */
+void SampleBuffer::Clear()
+{
+	size_ = 0;
+	dropped_ = 0;
+}
+
+
+/***********************************************************
+***************** SAMPLE LOGGING FUNCTIONS *****************
+************************************************************/
+/*
+Stores a single sample at the end of the buffer. Forces
+and torques are passed as {x, y, z} triplets and time is
+seconds since the trial started. If the buffer
+is already full the sample is counted as dropped and false
+is returned.
+ */
+bool SampleBuffer::Append(unsigned int sample,
+						  double position_desired_a,	double position_actual_a,
+						  const double* force_a,		const double* torque_a,
+						  double position_desired_b,	double position_actual_b,
+						  const double* force_b,		const double* torque_b,
+						  double time)
+{
+	// refuses sample instead of growing the buffer
+	if (size_ >= capacity_)
+	{
+		dropped_++;
+		return false;
+	}
+
+	// sample counter column
+	sample_[size_] = sample;
+
+	// Motor/Sensor A columns
+	position_desired_a_[size_] =	position_desired_a;
+	position_actual_a_[size_] =		position_actual_a;
+	force_x_a_[size_] =		force_a[0];
+	force_y_a_[size_] =		force_a[1];
+	force_z_a_[size_] =		force_a[2];
+	torque_x_a_[size_] =	torque_a[0];
+	torque_y_a_[size_] =	torque_a[1];
+	torque_z_a_[size_] =	torque_a[2];
+
+	// Motor/Sensor B columns
+	position_desired_b_[size_] =	position_desired_b;
+	position_actual_b_[size_] =		position_actual_b;
+	force_x_b_[size_] =		force_b[0];
+	force_y_b_[size_] =		force_b[1];
+	force_z_b_[size_] =		force_b[2];
+	torque_x_b_[size_] =	torque_b[0];
+	torque_y_b_[size_] =	torque_b[1];
+	torque_z_b_[size_] =	torque_b[2];
+
+	// acquisition time column
+	time_[size_] = time;
+
+	size_++;
+	return true;
+}
+
+
+/***********************************************************
+***************** BUFFER STATE FUNCTIONS *******************
+************************************************************/
+/*
+Returns the number of samples currently held
+ */
+std::size_t SampleBuffer::GetSize() const
+{
+	return size_;
+}
+
+/*
+Returns the maximum number of samples the buffer can hold
+ */
+std::size_t SampleBuffer::GetCapacity() const
+{
+	return capacity_;
+}
+
+/*
+Returns the number of samples refused since the last clear
+ */
+std::size_t SampleBuffer::GetDropped() const
+{
+	return dropped_;
+}
+
+/*
+Checks if the buffer has run out of space
+ */
+bool SampleBuffer::IsFull() const
+{
+	return size_ >= capacity_;
+}
+
+
+/***********************************************************
+***************** SAMPLE ACCESS FUNCTIONS ******************
+************************************************************/
+/*
+Returns the sample counter column, the only column that
+is not stored as doubles
+ */
+const unsigned int* SampleBuffer::GetSampleColumn() const
+{
+	return sample_.data();
+}
+
+/*
+Returns a raw pointer to one of the double columns using
+the channel ordering of kSampleChannelNames_. Returns null
+for the sample counter column.
+ */
+const double* SampleBuffer::GetColumn(int channel) const
+{
+	switch (channel)
+	{
+	// Motor/Sensor A
+	case 1:		return position_desired_a_.data();
+	case 2:		return position_actual_a_.data();
+	case 3:		return force_x_a_.data();
+	case 4:		return force_y_a_.data();
+	case 5:		return force_z_a_.data();
+	case 6:		return torque_x_a_.data();
+	case 7:		return torque_y_a_.data();
+	case 8:		return torque_z_a_.data();
+	// Motor/Sensor B
+	case 9:		return position_desired_b_.data();
+	case 10:	return position_actual_b_.data();
+	case 11:	return force_x_b_.data();
+	case 12:	return force_y_b_.data();
+	case 13:	return force_z_b_.data();
+	case 14:	return torque_x_b_.data();
+	case 15:	return torque_y_b_.data();
+	case 16:	return torque_z_b_.data();
+	// acquisition time
+	case 17:	return time_.data();
+	default:	return nullptr;
+	}
+}
+
+/*
+Returns a single value using the channel ordering of
+kSampleChannelNames_
+ */
+double SampleBuffer::GetValue(std::size_t row, int channel) const
+{
+	// sample counter column
+	if (channel == 0)
+		return (double)sample_[row];
+
+	// all other columns are doubles
+	const double* column = GetColumn(channel);
+	if (column == nullptr)
+		return 0.0;
+	return column[row];
+}
+
+/*
+Copies a single sample into a row using the channel
+ordering of kSampleChannelNames_
+ */
+void SampleBuffer::GetRow(std::size_t row, std::vector<double> &output_row) const
+{
+	output_row.resize(kSampleChannels_);
+	for (int channel = 0; channel < kSampleChannels_; channel++)
+		output_row[channel] = GetValue(row, channel);
+}
+
+/*
+Copies all held samples into rows for the CSV writer.
+Allocates, so must not be called from the control loop.
+ */
+void SampleBuffer::GetRows(std::vector<std::vector<double>> &output_rows) const
+{
+	output_rows.resize(size_);
+	for (std::size_t row = 0; row < size_; row++)
+		GetRow(row, output_rows[row]);
+}
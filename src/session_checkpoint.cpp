@@ -0,0 +1,162 @@
+/*
+File: session_checkpoint.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the CheckpointFile class. The file is two
+fixed-size slots; each write goes to the slot not holding
+the newest checkpoint and carries a generation number and
+checksum. Reading returns the newest slot with a valid
+checksum.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "session_checkpoint.hpp"
+
+// libraries for the portable file helpers
+#include "file_io.hpp"
+
+// other misc standard libraries
+#include <cstring>
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Computes the FNV-1a checksum of a checkpoint with its
+checksum field cleared
+ */
+static std::uint32_t GetChecksum(const SessionCheckpoint &checkpoint)
+{
+	SessionCheckpoint cleared = checkpoint;
+	cleared.checksum = 0;
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&cleared);
+	std::uint32_t checksum = 2166136261u;
+	for (std::size_t i = 0; i < sizeof(SessionCheckpoint); i++)
+	{
+		checksum ^= bytes[i];
+		checksum *= 16777619u;
+	}
+	return checksum;
+}
+
+/*
+Checks that a slot holds a complete checkpoint
+ */
+static bool IsValid(const SessionCheckpoint &checkpoint)
+{
+	return checkpoint.magic == kCheckpointMagic_ &&
+		checkpoint.version == kCheckpointVersion_ &&
+		checkpoint.checksum == GetChecksum(checkpoint);
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the CheckpointFile class
+ */
+CheckpointFile::CheckpointFile() :
+	file_(nullptr),
+	generation_(0)
+{
+}
+
+/*
+Destructor for the CheckpointFile class
+ */
+CheckpointFile::~CheckpointFile()
+{
+	Close();
+}
+
+
+/***********************************************************
+***************** FILE CONTROL FUNCTIONS *******************
+************************************************************/
+/*
+Opens the checkpoint file, creating it if it does not exist
+ */
+bool CheckpointFile::Open(const std::string &filepath)
+{
+	Close();
+	if (FileExists(filepath))
+		file_ = std::fopen(filepath.c_str(), "r+b");
+	else
+		file_ = std::fopen(filepath.c_str(), "w+b");
+	generation_ = 0;
+	return file_ != nullptr;
+}
+
+/*
+Closes the checkpoint file
+ */
+void CheckpointFile::Close()
+{
+	if (file_ != nullptr)
+		std::fclose(file_);
+	file_ = nullptr;
+}
+
+
+/***********************************************************
+****************** CHECKPOINT FUNCTIONS ********************
+************************************************************/
+/*
+Reads the newest valid checkpoint. Returns false if the file
+holds no valid checkpoint.
+ */
+bool CheckpointFile::Read(SessionCheckpoint &checkpoint)
+{
+	if (file_ == nullptr) return false;
+
+	// reads both slots
+	SessionCheckpoint slots[2];
+	std::memset(slots, 0, sizeof(slots));
+	if (!FileSeek(file_, 0)) return false;
+	std::size_t slot_count = std::fread(slots, sizeof(SessionCheckpoint), 2, file_);
+
+	// picks the newest slot that was completely written
+	bool found = false;
+	for (std::size_t i = 0; i < slot_count; i++)
+	{
+		if (!IsValid(slots[i])) continue;
+		if (!found || slots[i].generation > checkpoint.generation)
+		{
+			checkpoint = slots[i];
+			found = true;
+		}
+	}
+	if (found)
+		generation_ = checkpoint.generation;
+	return found;
+}
+
+/*
+Writes a new checkpoint into the slot not holding the newest
+one. Fills in the header fields of the checkpoint.
+ */
+bool CheckpointFile::Write(SessionCheckpoint &checkpoint)
+{
+	if (file_ == nullptr) return false;
+
+	// stamps the checkpoint
+	generation_++;
+	checkpoint.magic =		kCheckpointMagic_;
+	checkpoint.version =	kCheckpointVersion_;
+	checkpoint.generation =	generation_;
+	checkpoint.checksum =	GetChecksum(checkpoint);
+
+	// writes it over the older slot
+	std::int64_t slot = (std::int64_t)(generation_ % 2);
+	if (!FileSeek(file_, slot * (std::int64_t)sizeof(SessionCheckpoint))) return false;
+	if (std::fwrite(&checkpoint, sizeof(SessionCheckpoint), 1, file_) != 1) return false;
+	return std::fflush(file_) == 0;
+}
@@ -0,0 +1,447 @@
+/*
+File: session_file.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the SessionWriter and SessionReader
+classes for the single-file session container. A session
+is laid out as:
+	file header:	magic, version, subject
+	trial records:	record magic, iteration, condition,
+					angle index, size, binary trial log
+	index:			index magic, entry count, entries
+	footer:			index offset, entry count, footer magic
+The index and footer are rewritten at the end of the file
+each time the session is committed. When they are missing
+or stale the index is rebuilt from the trial records.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// module header file
+#include "session_file.hpp"
+
+// libraries for the portable file helpers
+#include "file_io.hpp"
+
+// other misc standard libraries
+#include <cstring>
+
+
+/***********************************************************
+************************ CONSTANTS *************************
+************************************************************/
+const std::int64_t	kSessionHeaderBytes(sizeof(kSessionMagic_) + 2 * sizeof(std::uint32_t));
+const std::int64_t	kSessionRecordBytes(sizeof(kSessionRecordMagic_) + 3 * sizeof(std::int32_t) + sizeof(std::uint64_t));
+const std::int64_t	kSessionRecordSizeOffset(sizeof(kSessionRecordMagic_) + 3 * sizeof(std::int32_t));
+const std::int64_t	kSessionFooterBytes(sizeof(std::int64_t) + sizeof(std::uint64_t) + sizeof(kSessionFooterMagic_));
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Writes the raw bytes of a value to the file
+ */
+template <typename T>
+static bool PutValue(std::FILE* file, const T &value)
+{
+	return std::fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+/*
+Reads the raw bytes of a value from the file
+ */
+template <typename T>
+static bool GetValue(std::FILE* file, T &value)
+{
+	return std::fread(&value, sizeof(T), 1, file) == 1;
+}
+
+/*
+Reads the trailing index of a session. Returns false if the
+footer or index is missing or does not match the file.
+ */
+static bool ReadSessionIndex(std::FILE* file, std::int64_t file_size,
+							 std::vector<SessionIndexEntry> &index, std::int64_t &data_end)
+{
+	if (file_size < kSessionHeaderBytes + kSessionFooterBytes) return false;
+
+	// reads the footer at the very end of the file
+	std::int64_t	index_offset = 0;
+	std::uint64_t	footer_count = 0;
+	char			footer_magic[sizeof(kSessionFooterMagic_)];
+	if (!FileSeek(file, file_size - kSessionFooterBytes)) return false;
+	if (!GetValue(file, index_offset) || !GetValue(file, footer_count)) return false;
+	if (std::fread(footer_magic, 1, sizeof(footer_magic), file) != sizeof(footer_magic)) return false;
+	if (std::memcmp(footer_magic, kSessionFooterMagic_, sizeof(footer_magic)) != 0) return false;
+	if (index_offset < kSessionHeaderBytes || index_offset >= file_size) return false;
+
+	// reads the index the footer points at
+	char			index_magic[sizeof(kSessionIndexMagic_)];
+	std::uint32_t	count = 0, reserved = 0;
+	if (!FileSeek(file, index_offset)) return false;
+	if (std::fread(index_magic, 1, sizeof(index_magic), file) != sizeof(index_magic)) return false;
+	if (std::memcmp(index_magic, kSessionIndexMagic_, sizeof(index_magic)) != 0) return false;
+	if (!GetValue(file, count) || !GetValue(file, reserved)) return false;
+	if (count != footer_count) return false;
+
+	index.resize(count);
+	if (count > 0 && std::fread(index.data(), sizeof(SessionIndexEntry), count, file) != count)
+		return false;
+
+	data_end = index_offset;
+	return true;
+}
+
+/*
+Rebuilds the index by walking the trial records from the
+start of the file. Stops at the first incomplete record,
+which is where an interrupted session is resumed from.
+ */
+static void ScanSessionRecords(std::FILE* file, std::int64_t file_size,
+							   std::vector<SessionIndexEntry> &index, std::int64_t &data_end)
+{
+	index.clear();
+	std::int64_t position = kSessionHeaderBytes;
+	while (position + kSessionRecordBytes <= file_size)
+	{
+		// reads the record header
+		char				record_magic[sizeof(kSessionRecordMagic_)];
+		SessionIndexEntry	entry;
+		if (!FileSeek(file, position)) break;
+		if (std::fread(record_magic, 1, sizeof(record_magic), file) != sizeof(record_magic)) break;
+		if (std::memcmp(record_magic, kSessionRecordMagic_, sizeof(record_magic)) != 0) break;
+		if (!GetValue(file, entry.iteration) || !GetValue(file, entry.condition)) break;
+		if (!GetValue(file, entry.angle_index) || !GetValue(file, entry.bytes)) break;
+
+		// a record that was never finished has no size
+		if (entry.bytes == 0 || position + kSessionRecordBytes + (std::int64_t)entry.bytes > file_size) break;
+
+		entry.reserved = 0;
+		entry.offset = position + kSessionRecordBytes;
+		index.push_back(entry);
+		position = entry.offset + (std::int64_t)entry.bytes;
+	}
+	data_end = position;
+}
+
+/*
+Checks the session file header and loads its index, either
+from the trailing index or by scanning the records
+ */
+static bool LoadSession(std::FILE* file, std::int32_t &subject,
+						std::vector<SessionIndexEntry> &index, std::int64_t &data_end)
+{
+	// checks the file header
+	char			magic[sizeof(kSessionMagic_)];
+	std::uint32_t	version = 0;
+	if (!FileSeek(file, 0)) return false;
+	if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic)) return false;
+	if (std::memcmp(magic, kSessionMagic_, sizeof(magic)) != 0) return false;
+	if (!GetValue(file, version) || version != kSessionVersion_) return false;
+	if (!GetValue(file, subject)) return false;
+
+	// loads the index, rebuilding it if the session was interrupted
+	std::int64_t file_size = FileSize(file);
+	if (!ReadSessionIndex(file, file_size, index, data_end))
+		ScanSessionRecords(file, file_size, index, data_end);
+	return true;
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the SessionWriter class
+ */
+SessionWriter::SessionWriter() :
+	file_(nullptr),
+	data_end_(0)
+{
+}
+
+/*
+Destructor for the SessionWriter class
+ */
+SessionWriter::~SessionWriter()
+{
+	Close();
+}
+
+
+/***********************************************************
+*************** WRITER FILE CONTROL FUNCTIONS **************
+************************************************************/
+/*
+Opens a session for appending. An existing session for the
+same subject is reopened and new trials are added after its
+last complete trial, otherwise a new session is created.
+ */
+bool SessionWriter::Open(const std::string &filepath, int subject)
+{
+	Close();
+	filepath_ = filepath;
+
+	// reopens an existing session to resume it
+	if (FileExists(filepath))
+	{
+		std::int32_t file_subject = 0;
+		file_ = std::fopen(filepath.c_str(), "r+b");
+		if (file_ == nullptr) return false;
+		if (!LoadSession(file_, file_subject, index_, data_end_) || file_subject != subject)
+		{
+			std::fclose(file_);
+			file_ = nullptr;
+			return false;
+		}
+
+		// drops the old index and any partially written trial
+		return FileTruncate(file_, data_end_) && FileSeek(file_, data_end_);
+	}
+
+	// creates a new session
+	file_ = std::fopen(filepath.c_str(), "w+b");
+	if (file_ == nullptr) return false;
+	index_.clear();
+	std::fwrite(kSessionMagic_, 1, sizeof(kSessionMagic_), file_);
+	PutValue(file_, kSessionVersion_);
+	PutValue(file_, (std::int32_t)subject);
+	data_end_ = kSessionHeaderBytes;
+	return std::fflush(file_) == 0;
+}
+
+/*
+Appends a single trial to the end of the session. The size
+of the record is filled in last so that a trial cut short
+by a crash is ignored when the session is reopened.
+ */
+bool SessionWriter::Append(const TrialLogInfo &info, const SampleBuffer &buffer)
+{
+	if (file_ == nullptr) return false;
+
+	// removes any committed index so the trial follows the last record
+	if (FileSize(file_) != data_end_ && !FileTruncate(file_, data_end_)) return false;
+	if (!FileSeek(file_, data_end_)) return false;
+
+	// writes the record header with an empty size
+	const std::int64_t record_start = data_end_;
+	std::fwrite(kSessionRecordMagic_, 1, sizeof(kSessionRecordMagic_), file_);
+	PutValue(file_, info.iteration);
+	PutValue(file_, info.condition);
+	PutValue(file_, info.angle_index);
+	PutValue(file_, (std::uint64_t)0);
+
+	// writes the trial itself
+	if (!WriteTrialLog(file_, info, buffer)) return false;
+	const std::int64_t record_end = FileTell(file_);
+
+	// fills in the size now that the trial is complete
+	SessionIndexEntry entry;
+	entry.iteration =	info.iteration;
+	entry.condition =	info.condition;
+	entry.angle_index =	info.angle_index;
+	entry.reserved =	0;
+	entry.offset =		record_start + kSessionRecordBytes;
+	entry.bytes =		(std::uint64_t)(record_end - entry.offset);
+	if (!FileSeek(file_, record_start + kSessionRecordSizeOffset)) return false;
+	if (!PutValue(file_, entry.bytes)) return false;
+	if (!FileSeek(file_, record_end)) return false;
+	if (std::fflush(file_) != 0) return false;
+
+	data_end_ = record_end;
+	index_.push_back(entry);
+	return true;
+}
+
+/*
+Writes the trailing index and footer after the last trial
+so the session can be read by seeking. Trials appended
+afterwards replace the index until the next commit.
+ */
+bool SessionWriter::Commit()
+{
+	if (file_ == nullptr) return false;
+	if (!FileSeek(file_, data_end_)) return false;
+
+	// writes the index
+	std::fwrite(kSessionIndexMagic_, 1, sizeof(kSessionIndexMagic_), file_);
+	PutValue(file_, (std::uint32_t)index_.size());
+	PutValue(file_, (std::uint32_t)0);
+	if (!index_.empty())
+		std::fwrite(index_.data(), sizeof(SessionIndexEntry), index_.size(), file_);
+
+	// writes the footer pointing back at the index
+	PutValue(file_, data_end_);
+	PutValue(file_, (std::uint64_t)index_.size());
+	if (std::fwrite(kSessionFooterMagic_, 1, sizeof(kSessionFooterMagic_), file_) != sizeof(kSessionFooterMagic_))
+		return false;
+	return std::fflush(file_) == 0;
+}
+
+/*
+Syncs every appended trial and the last committed index to
+disk before returning
+ */
+bool SessionWriter::Sync()
+{
+	if (file_ == nullptr) return false;
+	return SyncFile(file_);
+}
+
+/*
+Commits the index and closes the session
+ */
+bool SessionWriter::Close()
+{
+	if (file_ == nullptr) return true;
+
+	bool committed = Commit();
+	if (std::fclose(file_) != 0) committed = false;
+	file_ = nullptr;
+	return committed;
+}
+
+/*
+Checks if a session is open for appending
+ */
+bool SessionWriter::IsOpen() const
+{
+	return file_ != nullptr;
+}
+
+/*
+Returns the number of trials held in the session
+ */
+std::size_t SessionWriter::GetTrialCount() const
+{
+	return index_.size();
+}
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the SessionReader class
+ */
+SessionReader::SessionReader() :
+	file_(nullptr),
+	subject_(0)
+{
+}
+
+/*
+Destructor for the SessionReader class
+ */
+SessionReader::~SessionReader()
+{
+	Close();
+}
+
+
+/***********************************************************
+*************** READER FILE CONTROL FUNCTIONS **************
+************************************************************/
+/*
+Opens a session and loads its index. Only the header,
+footer and index are read.
+ */
+bool SessionReader::Open(const std::string &filepath)
+{
+	Close();
+	file_ = std::fopen(filepath.c_str(), "rb");
+	if (file_ == nullptr) return false;
+
+	std::int64_t data_end = 0;
+	if (!LoadSession(file_, subject_, index_, data_end))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/*
+Closes the session
+ */
+void SessionReader::Close()
+{
+	if (file_ != nullptr)
+		std::fclose(file_);
+	file_ = nullptr;
+	index_.clear();
+}
+
+
+/***********************************************************
+****************** READER INDEX FUNCTIONS ******************
+************************************************************/
+/*
+Returns the subject the session belongs to
+ */
+int SessionReader::GetSubject() const
+{
+	return subject_;
+}
+
+/*
+Returns the number of trials held in the session
+ */
+std::size_t SessionReader::GetTrialCount() const
+{
+	return index_.size();
+}
+
+/*
+Returns the index entry of the trial in the given slot
+ */
+const SessionIndexEntry& SessionReader::GetEntry(std::size_t index) const
+{
+	return index_[index];
+}
+
+/*
+Looks up a trial by its iteration number. If an iteration
+was repeated after a resume the most recent one is used.
+ */
+bool SessionReader::FindTrial(int iteration, SessionIndexEntry &entry) const
+{
+	for (std::size_t i = index_.size(); i > 0; i--)
+	{
+		if (index_[i - 1].iteration == iteration)
+		{
+			entry = index_[i - 1];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/***********************************************************
+******************* TRIAL READ FUNCTIONS *******************
+************************************************************/
+/*
+Seeks straight to a trial and reads it
+ */
+bool SessionReader::ReadTrial(const SessionIndexEntry &entry, TrialLogData &data)
+{
+	if (file_ == nullptr) return false;
+	if (!FileSeek(file_, entry.offset)) return false;
+	return ReadTrialLog(file_, data);
+}
+
+/*
+Seeks straight to the trial with the given iteration number
+and reads it
+ */
+bool SessionReader::ReadTrial(int iteration, TrialLogData &data)
+{
+	SessionIndexEntry entry;
+	if (!FindTrial(iteration, entry)) return false;
+	return ReadTrial(entry, data);
+}
@@ -0,0 +1,241 @@
+/*
+File: session_scheduler.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the SessionScheduler class. An onset is
+the first sample instant of the grid that is no earlier than
+both now and one trial period after the last onset, so the
+time taken by the subject to respond only ever shifts onsets
+by whole sample periods. Deadlines are met with the hybrid
+wait in its default mode. A sample
+deadline that was missed by more than a period is skipped
+rather than bunched up, keeping later samples on the grid.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "session_scheduler.hpp"
+
+// libraries for waiting on the deadlines
+#include "hybrid_wait.hpp"
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the SessionScheduler class
+ */
+SessionScheduler::SessionScheduler(double sample_rate, double trial_seconds) :
+	sample_period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / sample_rate))),
+	trial_period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(trial_seconds))),
+	has_onset_(false),
+	missed_samples_(0)
+{
+	if (sample_period_ <= Clock::duration::zero())
+		sample_period_ = Clock::duration(1);
+	entries_.reserve(kScheduleReservedTrials_);
+	Start();
+}
+
+
+/***********************************************************
+****************** SCHEDULE FUNCTIONS **********************
+************************************************************/
+/*
+Returns the first sample instant of the session grid at or
+after the given time
+ */
+SessionScheduler::TimePoint SessionScheduler::GetGridPoint(TimePoint time) const
+{
+	if (time <= origin_) return origin_;
+	Clock::duration::rep periods = ((time - origin_).count() + sample_period_.count() - 1) / sample_period_.count();
+	return origin_ + periods * sample_period_;
+}
+
+/*
+Returns a time in seconds since the session start
+ */
+double SessionScheduler::GetSeconds(TimePoint time) const
+{
+	return std::chrono::duration<double>(time - origin_).count();
+}
+
+
+/***********************************************************
+******************* SESSION FUNCTIONS **********************
+************************************************************/
+/*
+Starts the session clock and clears the recorded deadlines
+ */
+void SessionScheduler::Start()
+{
+	origin_ = Clock::now();
+	has_onset_ = false;
+	entries_.clear();
+	onset_lateness_.Reset();
+	sample_lateness_.Reset();
+	end_lateness_.Reset();
+	missed_samples_.store(0, std::memory_order_relaxed);
+}
+
+/*
+Returns the seconds since the session start
+ */
+double SessionScheduler::GetElapsed() const
+{
+	return GetSeconds(Clock::now());
+}
+
+
+/***********************************************************
+******************** TRIAL FUNCTIONS ***********************
+************************************************************/
+/*
+Schedules the onset of the next trial and waits for it.
+Returns the onset deadline the trial's samples are due from.
+ */
+SessionScheduler::TimePoint SessionScheduler::WaitForOnset()
+{
+	// never sooner than a trial period after the last onset
+	TimePoint earliest = Clock::now();
+	if (has_onset_ && onset_ + trial_period_ > earliest)
+		earliest = onset_ + trial_period_;
+	onset_ = GetGridPoint(earliest);
+	has_onset_ = true;
+
+	std::uint64_t lateness = WaitUntil(onset_);
+	onset_lateness_.Record(lateness);
+
+	ScheduleEntry entry;
+	entry.onset =			GetSeconds(onset_);
+	entry.onset_lateness =	lateness * 1e-9;
+	entries_.push_back(entry);
+	return onset_;
+}
+
+/*
+Returns a clock of the sample instants following the onset
+of the current trial
+ */
+SessionScheduler::SampleClock SessionScheduler::GetSampleClock()
+{
+	return SampleClock(*this, onset_);
+}
+
+/*
+Waits until the current trial has run for its full period
+ */
+void SessionScheduler::WaitForTrialEnd()
+{
+	if (!has_onset_) return;
+	TimePoint end = onset_ + trial_period_;
+	std::uint64_t lateness = WaitUntil(end);
+	end_lateness_.Record(lateness);
+
+	if (!entries_.empty())
+	{
+		entries_.back().end =			GetSeconds(end);
+		entries_.back().end_lateness =	lateness * 1e-9;
+	}
+}
+
+
+/***********************************************************
+***************** SAMPLE CLOCK FUNCTIONS *******************
+************************************************************/
+/*
+Constructor for an unused SampleClock
+ */
+SessionScheduler::SampleClock::SampleClock() :
+	scheduler_(nullptr)
+{
+}
+
+/*
+Constructor for a SampleClock starting at a trial onset
+ */
+SessionScheduler::SampleClock::SampleClock(SessionScheduler &scheduler, TimePoint onset) :
+	scheduler_(&scheduler),
+	next_(onset + scheduler.sample_period_)
+{
+}
+
+/*
+Waits for the next sample instant, skipping any instants
+that were missed entirely. Returns the number skipped.
+ */
+std::uint64_t SessionScheduler::SampleClock::Wait()
+{
+	if (scheduler_ == nullptr) return 0;
+
+	TimePoint now = Clock::now();
+	Clock::duration::rep missed = 0;
+	if (now >= next_ + scheduler_->sample_period_)
+	{
+		missed = (now - next_).count() / scheduler_->sample_period_.count();
+		scheduler_->missed_samples_.fetch_add((std::uint64_t)missed, std::memory_order_relaxed);
+		next_ += missed * scheduler_->sample_period_;
+	}
+
+	scheduler_->sample_lateness_.Record(WaitUntil(next_));
+	next_ += scheduler_->sample_period_;
+	return (std::uint64_t)missed;
+}
+
+
+/***********************************************************
+****************** STATISTIC FUNCTIONS *********************
+************************************************************/
+/*
+Returns the deadlines of every trial of the session
+ */
+const std::vector<ScheduleEntry>& SessionScheduler::GetEntries() const
+{
+	return entries_;
+}
+
+/*
+Returns how late the trial onsets were met
+ */
+const LatencyHistogram& SessionScheduler::GetOnsetLateness() const
+{
+	return onset_lateness_;
+}
+
+/*
+Returns how late the sample instants were met
+ */
+const LatencyHistogram& SessionScheduler::GetSampleLateness() const
+{
+	return sample_lateness_;
+}
+
+/*
+Returns how late the trial ends were met
+ */
+const LatencyHistogram& SessionScheduler::GetEndLateness() const
+{
+	return end_lateness_;
+}
+
+/*
+Returns the number of sample instants skipped because they
+were missed entirely
+ */
+std::uint64_t SessionScheduler::GetMissedSamples() const
+{
+	return missed_samples_.load(std::memory_order_relaxed);
+}
+
+/*
+Returns the sample period in seconds
+ */
+double SessionScheduler::GetSamplePeriod() const
+{
+	return std::chrono::duration<double>(sample_period_).count();
+}
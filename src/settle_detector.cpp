@@ -0,0 +1,170 @@
+/*
+File: settle_detector.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the SettleDetector class. The velocity is
+the finite difference of consecutive encoder readings passed
+through a first order low-pass filter, which smooths out the
+single count steps of the encoder. Once a move has settled
+it stays settled until the next move starts, so a motor that
+finished first does not hold up the trial by drifting a
+count while the other motor is still moving.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "settle_detector.hpp"
+
+// other misc standard libraries
+#include <chrono>
+#include <cmath>
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the SettleDetector class
+ */
+SettleDetector::SettleDetector(const SettleConfig &config) :
+	config_(config),
+	target_(0.0),
+	tolerance_(config.small_tolerance),
+	settled_(false),
+	has_sample_(false),
+	last_position_(0.0),
+	last_time_(0.0),
+	velocity_(0.0),
+	in_window_(false),
+	window_start_(0.0)
+{
+}
+
+
+/***********************************************************
+**************** CONFIGURATION FUNCTIONS *******************
+************************************************************/
+/*
+Sets the tolerances used from the next move on
+ */
+void SettleDetector::SetConfig(const SettleConfig &config)
+{
+	config_ = config;
+}
+
+/*
+Returns the tolerances in use
+ */
+const SettleConfig& SettleDetector::GetConfig() const
+{
+	return config_;
+}
+
+
+/***********************************************************
+****************** DETECTION FUNCTIONS *********************
+************************************************************/
+/*
+Starts watching a new move from start_position to target,
+both in encoder counts
+ */
+void SettleDetector::Start(double target, double start_position)
+{
+	target_ = target;
+	tolerance_ = std::fabs(target - start_position) >= config_.large_move ?
+		config_.large_tolerance : config_.small_tolerance;
+	settled_ = false;
+	has_sample_ = false;
+	velocity_ = 0.0;
+	in_window_ = false;
+}
+
+/*
+Adds an encoder reading in counts taken at time in seconds
+and returns true once the move has settled
+ */
+bool SettleDetector::Update(double position, double time)
+{
+	if (settled_) return true;
+
+	// filtered velocity from the change since the last reading
+	bool has_velocity = has_sample_;
+	if (has_sample_ && time > last_time_)
+	{
+		double dt = time - last_time_;
+		double raw_velocity = (position - last_position_) / dt;
+		velocity_ += dt / (config_.velocity_filter + dt) * (raw_velocity - velocity_);
+	}
+	has_sample_ = true;
+	last_position_ = position;
+	last_time_ = time;
+
+	// the motor has to stay close and slow for the whole dwell time
+	bool in_tolerance = has_velocity &&
+		std::fabs(position - target_) <= tolerance_ &&
+		std::fabs(velocity_) <= config_.velocity_tolerance;
+	if (!in_tolerance)
+	{
+		in_window_ = false;
+		return false;
+	}
+	if (!in_window_)
+	{
+		in_window_ = true;
+		window_start_ = time;
+	}
+	settled_ = time - window_start_ >= config_.dwell;
+	return settled_;
+}
+
+
+/***********************************************************
+******************* ACCESSOR FUNCTIONS *********************
+************************************************************/
+/*
+Returns true once the current move has settled
+ */
+bool SettleDetector::IsSettled() const
+{
+	return settled_;
+}
+
+/*
+Returns the target of the current move in counts
+ */
+double SettleDetector::GetTarget() const
+{
+	return target_;
+}
+
+/*
+Returns the position tolerance of the current move in counts
+ */
+double SettleDetector::GetTolerance() const
+{
+	return tolerance_;
+}
+
+/*
+Returns the filtered velocity in counts per second
+ */
+double SettleDetector::GetVelocity() const
+{
+	return velocity_;
+}
+
+
+/***********************************************************
+******************** CLOCK FUNCTIONS ***********************
+************************************************************/
+/*
+Returns the steady clock in seconds
+ */
+double GetSettleClock()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
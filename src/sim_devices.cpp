@@ -0,0 +1,494 @@
+/*
+File: sim_devices.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the simulated testbed devices. Motor
+positions follow the EPOS profile analytically from the time
+of the last move command, using the profile velocity and
+accelerations in rpm and rpm/s at the motor shaft. A move
+issued while the motor is still moving restarts the profile
+from the current position at rest. Force/torque voltages are
+the wrench of a linear skin model divided by a diagonal
+calibration, plus a small deterministic gauge noise.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "sim_devices.hpp"
+
+// libraries for the session trace
+#include "trace.hpp"
+
+// other misc standard libraries
+#include <cmath>
+#include <cstdlib>
+
+
+/***********************************************************
+******************** SIM PROFILE CLASS *********************
+************************************************************/
+/*
+Constructor for the SimProfile class, at rest at zero
+ */
+SimProfile::SimProfile() :
+	start_counts_(0.0),
+	target_counts_(0.0),
+	velocity_(0.0),
+	acceleration_(0.0),
+	deceleration_(0.0),
+	start_time_(std::chrono::steady_clock::now())
+{
+	SetLimits(kProfileVelocity_, kProfileAcceleration_, kProfileDeceleration_);
+}
+
+/*
+Sets the profile velocity in rpm and accelerations in rpm/s
+ */
+void SimProfile::SetLimits(unsigned int velocity, unsigned int acceleration, unsigned int deceleration)
+{
+	// the encoder sits on the motor shaft, so rpm converts straight to counts
+	const double kRpmToCounts = kEncoderCounts_ / 60.0;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	velocity_ =		velocity * kRpmToCounts;
+	acceleration_ =	acceleration * kRpmToCounts;
+	deceleration_ =	deceleration * kRpmToCounts;
+}
+
+/*
+Starts a new move to target_counts from the current position
+ */
+void SimProfile::MoveTo(double target_counts)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double current_counts = GetCounts(now);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	start_counts_ =		current_counts;
+	target_counts_ =	target_counts;
+	start_time_ =		now;
+}
+
+/*
+Returns the position in counts right now
+ */
+double SimProfile::GetCounts() const
+{
+	return GetCounts(std::chrono::steady_clock::now());
+}
+
+/*
+Returns the position in counts at the given time
+ */
+double SimProfile::GetCounts(std::chrono::steady_clock::time_point time) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	double distance =	std::fabs(target_counts_ - start_counts_);
+	double direction =	target_counts_ >= start_counts_ ? 1.0 : -1.0;
+	double elapsed =	std::chrono::duration<double>(time - start_time_).count();
+	if (distance == 0.0 || elapsed <= 0.0) return start_counts_;
+
+	// triangular profile if the move is too short to reach full velocity
+	double peak_velocity = velocity_;
+	if (velocity_ * velocity_ / (2.0 * acceleration_) + velocity_ * velocity_ / (2.0 * deceleration_) > distance)
+		peak_velocity = std::sqrt(2.0 * distance * acceleration_ * deceleration_ / (acceleration_ + deceleration_));
+	double accel_time =		peak_velocity / acceleration_;
+	double decel_time =		peak_velocity / deceleration_;
+	double accel_distance =	0.5 * acceleration_ * accel_time * accel_time;
+	double decel_distance =	0.5 * deceleration_ * decel_time * decel_time;
+	double cruise_time =	(distance - accel_distance - decel_distance) / peak_velocity;
+	if (cruise_time < 0.0) cruise_time = 0.0;
+
+	// distance covered along the profile
+	double covered;
+	if (elapsed < accel_time)
+		covered = 0.5 * acceleration_ * elapsed * elapsed;
+	else if (elapsed < accel_time + cruise_time)
+		covered = accel_distance + peak_velocity * (elapsed - accel_time);
+	else if (elapsed < accel_time + cruise_time + decel_time)
+	{
+		double braking = elapsed - accel_time - cruise_time;
+		covered = accel_distance + peak_velocity * cruise_time + peak_velocity * braking - 0.5 * deceleration_ * braking * braking;
+	}
+	else
+		covered = distance;
+	if (covered > distance) covered = distance;
+
+	return start_counts_ + direction * covered;
+}
+
+
+/***********************************************************
+***************** SIM ENCODER CHANNEL CLASS ****************
+************************************************************/
+/*
+Constructor for the SimEncoderChannel class
+ */
+SimEncoderChannel::SimEncoderChannel() :
+	profile_(nullptr),
+	counts_(0.0),
+	offset_(0.0)
+{
+}
+
+/*
+Connects the channel to the motor it measures
+ */
+void SimEncoderChannel::Attach(const SimProfile* profile)
+{
+	profile_ = profile;
+}
+
+/*
+Latches the whole number of counts the motor is at
+ */
+void SimEncoderChannel::update()
+{
+	if (profile_ == nullptr) return;
+	counts_ = std::floor(profile_->GetCounts() + 0.5) - offset_;
+}
+
+/*
+Takes the current position as zero
+ */
+void SimEncoderChannel::zero()
+{
+	if (profile_ != nullptr)
+		offset_ = std::floor(profile_->GetCounts() + 0.5);
+	counts_ = 0.0;
+}
+
+/*
+Returns the latched counts
+ */
+double SimEncoderChannel::get_value() const
+{
+	return counts_;
+}
+
+
+/***********************************************************
+********************** SIM Q8 CLASS ************************
+************************************************************/
+/*
+Opens the simulated board
+ */
+bool SimQ8::open()
+{
+	return true;
+}
+
+/*
+Enables the simulated board
+ */
+bool SimQ8::enable()
+{
+	return true;
+}
+
+/*
+Latches the counts of every encoder channel
+ */
+bool SimQ8::update_input()
+{
+	for (int i = 0; i < kSimEncoders_; i++)
+		encoder[i].update();
+	return true;
+}
+
+/*
+Disables the simulated board
+ */
+bool SimQ8::disable()
+{
+	return true;
+}
+
+/*
+Closes the simulated board
+ */
+bool SimQ8::close()
+{
+	return true;
+}
+
+
+/***********************************************************
+********************* SIM MOTOR CLASS **********************
+************************************************************/
+/*
+Constructor for the SimMotor class
+ */
+SimMotor::SimMotor(SimEncoderChannel &encoder) :
+	encoder_(encoder),
+	desired_velocity_(kProfileVelocity_),
+	desired_acceleration_(kProfileAcceleration_),
+	desired_deceleration_(kProfileDeceleration_),
+	desired_position_(0.0),
+	actual_position_(0.0)
+{
+	// connects the encoder and zeroes it at the beginning of the experiment
+	encoder_.Attach(&profile_);
+	encoder_.zero();
+}
+
+/*
+Starts the simulated controller
+ */
+void SimMotor::Start()
+{
+}
+
+/*
+Stops the simulated controller
+ */
+void SimMotor::End()
+{
+}
+
+/*
+Port names mean nothing to the simulated controller
+ */
+void SimMotor::SetPort(char* /*port*/)
+{
+}
+
+/*
+Sets each one of the control parameters for position
+control mode
+ */
+void SimMotor::SetControlParam(
+	unsigned int desired_velocity,
+	unsigned int desired_acceleration,
+	unsigned int desired_deceleration)
+{
+	desired_velocity_ =		desired_velocity;
+	desired_acceleration_ =	desired_acceleration;
+	desired_deceleration_ =	desired_deceleration;
+	profile_.SetLimits(desired_velocity_, desired_acceleration_, desired_deceleration_);
+}
+
+/*
+Sets the tolerances deciding when a move has settled
+ */
+void SimMotor::SetSettleConfig(const SettleConfig &config)
+{
+	settle_.SetConfig(config);
+}
+
+/*
+Commands the simulated motor to move to the specified position
+ */
+void SimMotor::Move(double desired_position)
+{
+	TraceSpan span("SimMotor::Move", "motor");
+	// convert from degrees to encoder counts
+	desired_position_ = desired_position * kDegreesToCount_;
+	settle_.Start(desired_position_, encoder_.get_value());
+	profile_.MoveTo(desired_position_);
+}
+
+/*
+Reads the motor position from the latched encoder counts
+ */
+void SimMotor::GetPosition(double& position)
+{
+	actual_position_ = encoder_.get_value();
+	position = actual_position_ / kDegreesToCount_;
+}
+
+/*
+Checks to see if the motor has settled at its final
+destination the same way as MaxonMotor
+ */
+bool SimMotor::TargetReached()
+{
+	actual_position_ = encoder_.get_value();
+	return settle_.Update(actual_position_, GetSettleClock());
+}
+
+/*
+Returns the true output angle of the motor in degrees
+ */
+double SimMotor::GetAngle() const
+{
+	return profile_.GetCounts() / kDegreesToCount_;
+}
+
+
+/***********************************************************
+********************* SIM PLANT CLASS **********************
+************************************************************/
+/*
+Constructor for the SimPlant class
+ */
+SimPlant::SimPlant(const SimMotor &motor_a, const SimMotor &motor_b) :
+	motor_a_(&motor_a),
+	motor_b_(&motor_b)
+{
+}
+
+/*
+Destructor for the SimPlant class
+ */
+SimPlant::~SimPlant()
+{
+	Detach();
+}
+
+/*
+Makes the mock DAQmx layer read its voltages from the plant
+ */
+void SimPlant::Attach()
+{
+	MockDAQmxSetSignal([this](int channel, double time) { return GetVoltage(channel, time); });
+}
+
+/*
+Returns the mock DAQmx layer to its default signal
+ */
+void SimPlant::Detach()
+{
+	MockDAQmxSetSignal(nullptr);
+}
+
+/*
+Returns the voltage of a DAQ channel. Channels 0-5 belong to
+sensor A and 16-21 to sensor B, in Fx, Fy, Fz, Tx, Ty, Tz order.
+ */
+double SimPlant::GetVoltage(int channel, double time) const
+{
+	const SimMotor*	motor =	channel >= 16 ? motor_b_ : motor_a_;
+	int				axis =	channel % 16;
+
+	// tangential force stretches the skin, the preload presses into it
+	double tangential = kSimSkinStiffness_ * motor->GetAngle();
+	double wrench[kAtiAxes_] = { tangential, 0.0, kSimPreload_, 0.0, 0.0, tangential * kSimTorqueArm_ };
+
+	// deterministic noise that differs between channels
+	double noise = kSimNoise_ * std::sin(7919.0 * time + 31.0 * channel);
+	return (axis < kAtiAxes_ ? wrench[axis] : 0.0) / kSimGaugeGain_ + noise;
+}
+
+/*
+Fills in the calibration matrix that recovers the plant's wrench
+ */
+void SimPlant::GetCalibration(double matrix[kAtiAxes_][kAtiAxes_])
+{
+	for (int row = 0; row < kAtiAxes_; row++)
+		for (int column = 0; column < kAtiAxes_; column++)
+			matrix[row][column] = row == column ? kSimGaugeGain_ : 0.0;
+}
+
+
+/***********************************************************
+********************** SIM DAQ CLASS ***********************
+************************************************************/
+/*
+Constructor for the SimDaq class
+ */
+SimDaq::SimDaq() :
+	values_(kDaqChannelCount_, 0.0),
+	block_values_(kDaqChannelCount_, 0.0),
+	block_()
+{
+	stream_.Open(kDaqChannels_);
+	stream_.StartOnDemand();
+}
+
+/*
+Destructor for the SimDaq class
+ */
+SimDaq::~SimDaq()
+{
+	stream_.Close();
+}
+
+/*
+Updates all channels of the daq simultaneously. In buffered
+mode this reads the next block of scans and the channels
+take the values of its last scan.
+ */
+bool SimDaq::update()
+{
+	TraceSpan span("SimDaq::update", "daq");
+	if (!stream_.IsBuffered())
+		return stream_.ReadScan(values_.data());
+
+	if (!stream_.ReadBlock(block_values_.data(), block_))
+		return false;
+	const double* last_scan = block_values_.data() + (block_.samples - 1) * kDaqChannelCount_;
+	for (int channel = 0; channel < kDaqChannelCount_; channel++)
+		values_[channel] = last_scan[channel];
+	return true;
+}
+
+/*
+Switches to continuous acquisition on the simulated sample clock
+ */
+bool SimDaq::StartBuffered(double sample_rate, unsigned int block_size)
+{
+	block_values_.assign(block_size * kDaqChannelCount_, 0.0);
+	block_ = DaqBlock();
+	return stream_.StartBuffered(sample_rate, block_size);
+}
+
+/*
+Switches back to reading a single scan on every update
+ */
+bool SimDaq::StartOnDemand()
+{
+	return stream_.StartOnDemand();
+}
+
+/*
+Restarts acquisition so the next block holds fresh scans
+ */
+bool SimDaq::Restart()
+{
+	return stream_.Restart();
+}
+
+/*
+Returns true if the DAQ is acquiring on its sample clock
+ */
+bool SimDaq::IsBuffered() const
+{
+	return stream_.IsBuffered();
+}
+
+/*
+Returns the number of scans read by each update
+ */
+unsigned int SimDaq::GetBlockSize() const
+{
+	return stream_.GetBlockSize();
+}
+
+/*
+Returns the voltages of every channel from the last update
+ */
+const double* SimDaq::GetScanValues()
+{
+	return values_.data();
+}
+
+/*
+Returns the timing of the last block read
+ */
+const DaqBlock& SimDaq::GetBlock() const
+{
+	return block_;
+}
+
+/*
+Returns every scan of the last block read, grouped by scan
+ */
+const double* SimDaq::GetBlockValues() const
+{
+	return block_values_.data();
+}
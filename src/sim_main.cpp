@@ -0,0 +1,578 @@
+/*
+File: sim_main.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file is the Main file of the AIMS testbed simulator. It
+runs movement trials with the same acquisition thread and
+motor supervision loop as absolute_threshold_tests, but
+against the simulated motors, encoders and force/torque DAQ,
+so the control loop can be profiled on any machine. At the
+end it reports the supervision loop timing and force/torque
+throughput of the run.
+Recorded trial logs or sessions can also be played back
+through the same recorder with --replay.
+With --schedule the samples are paced by the session clock
+instead of the loop timers, and their lateness is reported.
+--wait picks how the loops wait for their deadlines, and
+--realtime runs the trials on real-time threads. --keys
+prints the response key events of the terminal or an evdev
+device with their timestamps until Escape is pressed.
+Usage: aims_sim [--trials N] [--rate Hz] [--sample-clock]
+                [--schedule] [--wait sleep|spin|hybrid] [--spin-threshold us]
+                [--realtime] [--rt-cpu N] [--rt-acquisition-cpu N] [--rt-priority P]
+                [--session file.fts] [--trace file.json]
+       aims_sim --replay <file.ftb|file.fts> [--trace file.json]
+       aims_sim --keys [/dev/input/eventN]
+*/
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the simulated and replayed devices
+#include "sim_devices.hpp"
+#include "replay_devices.hpp"
+
+// libraries for force/torque, logging and timing
+#include "wrench_reader.hpp"
+#include "sample_buffer.hpp"
+#include "movement_trial.hpp"
+#include "loop_timer.hpp"
+#include "session_file.hpp"
+#include "trace.hpp"
+#include "driver_latency.hpp"
+#include "session_scheduler.hpp"
+#include "hybrid_wait.hpp"
+#include "realtime.hpp"
+#include "key_events.hpp"
+
+// other misc standard libraries
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+// constant variables
+const double		kSampleRate(1000.0);	// sets the force/torque logging rate in Hz
+const double		kSimAngles[] = { 5.0, 10.0, 15.0, 20.0, 25.0, 30.0 };	// test angles in degrees
+const std::size_t	kMaxTicks(1000000);		// supervision ticks kept for the timing report
+
+// supervision loop timing of the run
+std::thread::id		supervision_thread;	// only this thread's timers are reported
+std::vector<double>	tick_periods;		// seconds between loop wake ups
+std::vector<double>	tick_work;			// seconds of work per loop pass
+unsigned long		missed_ticks = 0;
+LoopTiming			session_timing(0);	// supervision loop timing of every trial
+
+// real-time mode of the run
+const RealtimeConfig*	realtime = nullptr;	// set when the trials run in real time
+double				max_command_skew = 0.0;	// seconds between the motor commands of a step, worst of the run
+unsigned long		settle_timeouts = 0;	// steps of the run ended before both motors settled
+
+
+/***********************************************************
+****************** TIMER DECLARATION ***********************
+************************************************************/
+/*
+Loop timer with the interface the movement trial templates use.
+Timers on the supervision thread record the period and work of
+every loop pass for the timing report, whether the loop runs
+on the timer's own schedule or on the session grid.
+*/
+class SimTimer
+{
+private:
+	LoopTimer								timer_;
+	bool									reported_;
+	std::chrono::steady_clock::time_point	last_wake_;
+
+public:
+	explicit SimTimer(double rate) :
+		timer_(rate),
+		reported_(std::this_thread::get_id() == supervision_thread),
+		last_wake_(std::chrono::steady_clock::now())
+	{
+	}
+
+	~SimTimer()
+	{
+		if (reported_) missed_ticks += timer_.GetMissed();
+	}
+
+	void Wait()
+	{
+		RecordWork();
+		timer_.Wait();
+		RecordWake();
+	}
+
+	template <typename SampleClock>
+	void WaitOn(SampleClock &clock)
+	{
+		RecordWork();
+		timer_.WaitOn(clock);
+		RecordWake();
+	}
+
+private:
+	// work of the loop pass that just ended
+	void RecordWork()
+	{
+		if (reported_ && tick_periods.size() < kMaxTicks)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			tick_work.push_back(std::chrono::duration<double>(now - last_wake_).count());
+		}
+	}
+
+	// period since the last wake up
+	void RecordWake()
+	{
+		if (reported_)
+		{
+			std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now();
+			if (tick_periods.size() < kMaxTicks)
+				tick_periods.push_back(std::chrono::duration<double>(wake - last_wake_).count());
+			last_wake_ = wake;
+		}
+	}
+};
+
+// devices of the simulated testbed and of a replayed trial
+typedef DeviceBundle<SimDaq, SimQ8, SimMotor, WrenchReader, SimTimer>					SimDevices;
+typedef DeviceBundle<ReplayDaq, ReplayEncoders, ReplayMotor, ReplayTransform, SimTimer>	ReplayDevices;
+
+
+/***********************************************************
+******************** REPORT FUNCTIONS **********************
+************************************************************/
+/*
+Returns the given percentile of a set of values
+*/
+double GetPercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty()) return 0.0;
+	std::size_t index = (std::size_t)(percentile / 100.0 * (values.size() - 1));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+/*
+Returns the mean of a set of values
+*/
+double GetMean(const std::vector<double> &values)
+{
+	if (values.empty()) return 0.0;
+	double sum = 0.0;
+	for (std::size_t i = 0; i < values.size(); i++)
+		sum += values[i];
+	return sum / values.size();
+}
+
+
+/*
+Prints the timing and throughput report of a run
+*/
+void PrintReport(const char* mode, int trial_count, double trial_seconds, bool buffered,
+				unsigned long ft_samples, unsigned long ring_dropped, unsigned long buffer_dropped)
+{
+	std::printf("%-22s%d (%.3f s)\n", (std::string(mode) + " trials:").c_str(), trial_count, trial_seconds);
+	std::printf("Acquisition:          %s\n", buffered ? "sample clock" : "on demand");
+	std::printf("Supervision ticks:    %zu (%lu missed)\n", tick_periods.size(), missed_ticks);
+	std::printf("Tick period (us):     mean %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+		GetMean(tick_periods) * 1e6, GetPercentile(tick_periods, 50.0) * 1e6,
+		GetPercentile(tick_periods, 99.0) * 1e6, GetPercentile(tick_periods, 100.0) * 1e6);
+	std::printf("Tick work (us):       mean %.2f  p99 %.2f  max %.2f\n",
+		GetMean(tick_work) * 1e6, GetPercentile(tick_work, 99.0) * 1e6, GetPercentile(tick_work, 100.0) * 1e6);
+
+	// period histogram of the loop timing, skipping empty bins
+	const LoopTimingStats &timing = session_timing.GetStats();
+	std::printf("Loop overruns:        %llu (max lateness %.1f us)\n",
+		(unsigned long long)timing.overruns, timing.max_lateness * 1e6);
+	std::printf("Motor command skew:   max %.1f us\n", max_command_skew * 1e6);
+	std::printf("Settle timeouts:      %lu steps\n", settle_timeouts);
+	std::printf("Period histogram:    ");
+	for (int bin = 0; bin < kLoopTimingBins_; bin++)
+	{
+		if (timing.histogram[bin] == 0) continue;
+		std::printf(" %s%.0fus:%u", bin == kLoopTimingBins_ - 1 ? ">=" : "",
+			bin * LoopTiming::GetBinWidth(timing) * 1e6, timing.histogram[bin]);
+	}
+	std::printf("\n");
+	std::printf("Force/torque samples: %lu (%.0f per s, %lu ring drops, %lu buffer drops)\n",
+		ft_samples, trial_seconds > 0.0 ? ft_samples / trial_seconds : 0.0, ring_dropped, buffer_dropped);
+	PrintWaitReport();
+}
+
+
+/***********************************************************
+******************** REPLAY FUNCTIONS **********************
+************************************************************/
+/*
+Plays a recorded trial back through the movement trial
+recorder. The position steps are taken from the desired
+positions the trial started and ended on.
+*/
+bool ReplayTrial(const TrialLogData &data, SampleBuffer &trial_buffer, double &trial_seconds,
+				unsigned long &ft_samples, unsigned long &ring_dropped, unsigned long &buffer_dropped)
+{
+	// loads the recorded trial into the replay devices
+	ReplayLog		log;
+	if (!log.Load(data)) return false;
+	ReplayDaq		daq(log);
+	ReplayEncoders	encoders(log);
+	ReplayMotor		motor_a(encoders, 0),
+					motor_b(encoders, 1);
+	ReplayTransform	transform;
+	ReplayDevices	devices = { daq, encoders, motor_a, motor_b, transform };
+
+	// desired positions the trial started and ended on
+	std::size_t last = log.GetSampleCount() - 1;
+	std::array<std::array<double, 2>, 2> position_desired = {{
+		{{ log.GetValue(0, 1),		log.GetValue(0, 9) }},
+		{{ log.GetValue(last, 1),	log.GetValue(last, 9) }}
+	}};
+
+	// replays at the rate the trial was recorded
+	MovementState state(data.info.sample_rate > 0.0 ? data.info.sample_rate : kSampleRate);
+	state.realtime = realtime;
+
+	// the replay devices only hold this trial, so its threads are started with them
+	MovementRecorder<ReplayDevices> recorder(devices, state);
+	trial_buffer.Clear();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("Replayed trial", "trial");
+		RecordMovementTrial(position_desired, recorder, &trial_buffer);
+	}
+	trial_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	session_timing.Merge(state.timing.GetStats());
+	max_command_skew = std::max(max_command_skew, state.max_command_skew);
+	settle_timeouts += state.settle_timeouts;
+
+	ft_samples +=		(unsigned long)trial_buffer.GetSize();
+	ring_dropped +=		state.ring.GetDropped();
+	buffer_dropped +=	(unsigned long)trial_buffer.GetDropped();
+	return true;
+}
+
+/*
+Replays a single trial log, or every trial of a session, and
+prints the timing report
+*/
+int RunReplay(const std::string &replay_path)
+{
+	SampleBuffer	trial_buffer(kSampleBufferCapacity_);
+	unsigned long	ft_samples = 0;
+	unsigned long	ring_dropped = 0;
+	unsigned long	buffer_dropped = 0;
+	double			trial_seconds = 0.0;
+	int				trial_count = 0;
+	TrialLogData	data;
+
+	if (replay_path.size() >= kSessionExtension_.size() &&
+		replay_path.compare(replay_path.size() - kSessionExtension_.size(), kSessionExtension_.size(), kSessionExtension_) == 0)
+	{
+		// replays every trial of the session in the order it was recorded
+		SessionReader session;
+		if (!session.Open(replay_path))
+		{
+			std::printf("Failed to read session %s\n", replay_path.c_str());
+			return EXIT_FAILURE;
+		}
+		for (std::size_t i = 0; i < session.GetTrialCount(); i++)
+		{
+			if (session.ReadTrial(session.GetEntry(i), data) &&
+				ReplayTrial(data, trial_buffer, trial_seconds, ft_samples, ring_dropped, buffer_dropped))
+				trial_count++;
+			else
+				std::printf("Failed to replay trial %zu of %s\n", i, replay_path.c_str());
+		}
+	}
+	else
+	{
+		// replays a single trial log
+		if (!ReadTrialLog(replay_path, data) ||
+			!ReplayTrial(data, trial_buffer, trial_seconds, ft_samples, ring_dropped, buffer_dropped))
+		{
+			std::printf("Failed to replay trial log %s\n", replay_path.c_str());
+			return EXIT_FAILURE;
+		}
+		trial_count++;
+	}
+
+	PrintReport("Replayed", trial_count, trial_seconds, false, ft_samples, ring_dropped, buffer_dropped);
+	return EXIT_SUCCESS;
+}
+
+
+/***********************************************************
+****************** SIMULATION FUNCTIONS ********************
+************************************************************/
+/*
+Runs the simulated trials and prints the timing report
+*/
+int RunSimulation(int trial_count, double sample_clock_rate, bool scheduled, const std::string &session_path)
+{
+	// creates the simulated devices
+	SimDaq		daq;
+	SimQ8		q8;
+	q8.open();
+	q8.enable();
+	SimMotor	motor_a(q8.encoder[0]),
+				motor_b(q8.encoder[1]);
+	SimPlant	plant(motor_a, motor_b);
+	plant.Attach();
+
+	// calibrates and zeroes the simulated sensors
+	WrenchReader	wrench_reader;
+	double			calibration[kAtiAxes_][kAtiAxes_];
+	SimPlant::GetCalibration(calibration);
+	wrench_reader.AddSensor(calibration);
+	wrench_reader.AddSensor(calibration);
+	daq.update();
+	wrench_reader.Zero(daq.GetScanValues());
+
+	// bundles the simulated devices for the movement trials
+	SimDevices		devices = { daq, q8, motor_a, motor_b, wrench_reader };
+	MovementState	movement_state(kSampleRate);
+	movement_state.realtime = realtime;
+
+	// starts the motor command and acquisition threads once for the run
+	MovementRecorder<SimDevices> recorder(devices, movement_state);
+
+	// paces the samples of every trial on the session clock, starting trials back to back
+	SessionScheduler scheduler(kSampleRate, 0.0);
+	if (scheduled)
+		movement_state.scheduler = &scheduler;
+
+	// selects the acquisition mode
+	if (sample_clock_rate > 0.0 && !daq.StartBuffered(sample_clock_rate, (unsigned int)(sample_clock_rate / kSampleRate)))
+	{
+		std::printf("Failed to start the simulated sample clock\n");
+		return EXIT_FAILURE;
+	}
+
+	// opens the optional session file
+	SessionWriter session;
+	if (!session_path.empty() && !session.Open(session_path, 0))
+	{
+		std::printf("Failed to open session %s\n", session_path.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// runs the trials
+	SampleBuffer	trial_buffer(kSampleBufferCapacity_);
+	unsigned long	ft_samples = 0;
+	unsigned long	ring_dropped = 0;
+	unsigned long	buffer_dropped = 0;
+	double			trial_seconds = 0.0;
+	const std::size_t kAngleCount = sizeof(kSimAngles) / sizeof(kSimAngles[0]);
+	for (int trial = 0; trial < trial_count; trial++)
+	{
+		double angle = kSimAngles[trial % kAngleCount];
+		std::array<std::array<double, 2>, 2> position_desired = {{ {{ angle, -angle }}, {{ 0.0, 0.0 }} }};
+
+		trial_buffer.Clear();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			TraceSpan span("Simulated trial", "trial");
+			if (scheduled)
+				scheduler.WaitForOnset();
+			RecordMovementTrial(position_desired, recorder, &trial_buffer);
+		}
+		trial_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		session_timing.Merge(movement_state.timing.GetStats());
+		max_command_skew = std::max(max_command_skew, movement_state.max_command_skew);
+		settle_timeouts += movement_state.settle_timeouts;
+
+		ft_samples +=		(unsigned long)trial_buffer.GetSize();
+		ring_dropped +=		movement_state.ring.GetDropped();
+		buffer_dropped +=	(unsigned long)trial_buffer.GetDropped();
+
+		// saves the trial like a real session would
+		if (session.IsOpen())
+		{
+			TrialLogInfo info;
+			info.subject =		0;
+			info.iteration =	trial + 1;
+			info.condition =	0;
+			info.angle_index =	(int)(trial % kAngleCount);
+			info.sample_rate =	daq.IsBuffered() ? sample_clock_rate : kSampleRate;
+			info.trial_name =	"Sim_" + std::to_string(angle);
+			info.timing =		movement_state.timing.GetStats();
+			session.Append(info, trial_buffer);
+		}
+	}
+	session.Close();
+	plant.Detach();
+
+	PrintReport("Simulated", trial_count, trial_seconds, daq.IsBuffered(), ft_samples, ring_dropped, buffer_dropped);
+	const LatencyHistogram &sample_lateness = scheduler.GetSampleLateness();
+	if (scheduled)
+		std::printf("Sample lateness (us): p50 %.1f  p99 %.1f  max %.1f (%llu missed)\n",
+			sample_lateness.GetPercentile(50.0) * 1e-3, sample_lateness.GetPercentile(99.0) * 1e-3,
+			sample_lateness.GetMax() * 1e-3, (unsigned long long)scheduler.GetMissedSamples());
+	PrintDriverLatencyReport();
+	return EXIT_SUCCESS;
+}
+
+
+/***********************************************************
+********************** KEY FUNCTIONS ***********************
+************************************************************/
+/*
+Prints every key event of the staircase response keys until
+Escape is pressed
+*/
+int RunKeyEcho(const std::string &device)
+{
+	KeyEventQueue keys;
+	if (!keys.Open(device))
+	{
+		std::printf("Failed to open the keys of %s\n", device.empty() ? "the terminal" : device.c_str());
+		return EXIT_FAILURE;
+	}
+	std::printf("Press the response keys, Escape to stop\n");
+
+	KeyEvent event;
+	double start = GetKeyClock();
+	while (keys.WaitForEvent(event))
+	{
+		std::printf("%10.3f ms  %-8s %-7s (code %d)\n", (event.time - start) * 1e3, GetKeyName(event.key),
+			event.action == KeyAction::Press ? "press" : "release", event.code);
+		if (event.key == KeyCode::Escape) break;
+	}
+	keys.Close();
+	return EXIT_SUCCESS;
+}
+
+
+/***********************************************************
+********************* MAIN FUNCTION ************************
+************************************************************/
+/*
+Runs the simulated or replayed trials, optionally tracing them
+*/
+int main(int argc, char* argv[])
+{
+	// parses the command line
+	int			trial_count = 12;
+	double		sample_clock_rate = 0.0;
+	bool		scheduled = false;
+	WaitConfig	wait_config;
+	bool		realtime_mode = false;
+	RealtimeConfig	realtime_config;
+	std::string	session_path;
+	std::string	replay_path;
+	std::string	trace_path;
+	bool		key_echo = false;
+	std::string	key_device;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--trials" && i + 1 < argc)
+			trial_count = std::atoi(argv[++i]);
+		else if (option == "--sample-clock")
+			sample_clock_rate = kDaqBufferedRate_;
+		else if (option == "--rate" && i + 1 < argc)
+			sample_clock_rate = std::atof(argv[++i]);
+		else if (option == "--schedule")
+			scheduled = true;
+		else if (option == "--wait" && i + 1 < argc && ParseWaitMode(argv[i + 1], wait_config.mode))
+			i++;
+		else if (option == "--spin-threshold" && i + 1 < argc)
+			wait_config.spin_threshold = std::atof(argv[++i]) * 1e-6;
+		else if (option == "--realtime")
+			realtime_mode = true;
+		else if (option == "--rt-cpu" && i + 1 < argc)
+			realtime_config.motion_cpu = std::atoi(argv[++i]);
+		else if (option == "--rt-acquisition-cpu" && i + 1 < argc)
+			realtime_config.acquisition_cpu = std::atoi(argv[++i]);
+		else if (option == "--rt-command-cpus" && i + 1 < argc)
+			std::sscanf(argv[++i], "%d,%d", &realtime_config.command_cpu[0], &realtime_config.command_cpu[1]);
+		else if (option == "--rt-priority" && i + 1 < argc)
+			realtime_config.priority = std::atoi(argv[++i]);
+		else if (option == "--session" && i + 1 < argc)
+			session_path = argv[++i];
+		else if (option == "--replay" && i + 1 < argc)
+			replay_path = argv[++i];
+		else if (option == "--trace" && i + 1 < argc)
+			trace_path = argv[++i];
+		else if (option == "--keys")
+		{
+			key_echo = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				key_device = argv[++i];
+		}
+		else
+		{
+			std::printf("Usage: aims_sim [--trials N] [--rate Hz] [--sample-clock] [--schedule]\n"
+						"               [--wait sleep|spin|hybrid] [--spin-threshold us]\n"
+						"               [--realtime] [--rt-cpu N] [--rt-acquisition-cpu N] [--rt-command-cpus A,B]\n"
+						"               [--rt-priority P]\n"
+						"               [--session file.fts] [--trace file.json]\n"
+						"       aims_sim --replay <file.ftb|file.fts> [--trace file.json]\n"
+						"       aims_sim --keys [/dev/input/eventN]\n");
+			return option == "-h" || option == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	// only checks the response keys if requested
+	if (key_echo)
+		return RunKeyEcho(key_device);
+
+	// selects how the loops wait for their deadlines
+	SetDefaultWaitConfig(wait_config);
+
+	// moves the trials onto real-time threads if requested
+	RealtimeThread motion_thread;
+	if (realtime_mode)
+	{
+		RealtimeReport realtime_report = PrepareRealtime(realtime_config);
+		realtime_report.motion = motion_thread.Start(realtime_config.priority, GetRealtimeCpu(realtime_config.motion_cpu, 0));
+		realtime = &realtime_config;
+		PrintRealtimeReport(realtime_report);
+	}
+
+	tick_periods.reserve(kMaxTicks);
+	tick_work.reserve(kMaxTicks);
+
+	// records a timeline of the run if requested
+	if (!trace_path.empty())
+	{
+		StartTrace();
+		SetTraceThreadName("Supervision");
+	}
+
+	// plays back recorded trials instead of simulating new ones
+	int status = EXIT_SUCCESS;
+	motion_thread.Run([&]
+	{
+		// only the supervision loop on this thread is timed
+		supervision_thread = std::this_thread::get_id();
+		if (!replay_path.empty())
+			status = RunReplay(replay_path);
+		else
+			status = RunSimulation(trial_count, sample_clock_rate, scheduled, session_path);
+	});
+	motion_thread.Stop();
+
+	// saves the timeline once the trial threads have stopped
+	if (!trace_path.empty() && !WriteTrace(trace_path))
+	{
+		std::printf("Failed to save trace %s\n", trace_path.c_str());
+		return EXIT_FAILURE;
+	}
+	return status;
+}
@@ -32,18 +32,40 @@ and 1 NI DAQ for the force sensors.
 // libraries for the staircase class
 #include "absolute_staircase.hpp"
 
+// libraries for the trial sample buffer and writer
+#include "sample_buffer.hpp"
+#include "trial_writer.hpp"
+
+// libraries for the ATI force/torque sensors
+#include "wrench_reader.hpp"
+
+// libraries for the movement trial recorder and session pacing
+#include "movement_trial.hpp"
+#include "session_scheduler.hpp"
+#include "loop_timer.hpp"
+#include "hybrid_wait.hpp"
+#include "realtime.hpp"
+
+// libraries for the session trace and driver call latencies
+#include "trace.hpp"
+#include "driver_latency.hpp"
+
+// libraries for the ABS response journal
+#include "response_journal.hpp"
+#include "session_checkpoint.hpp"
+#include "file_io.hpp"
+
 // libraries for MEL
 #include <MEL/Core/Console.hpp>
-#include <MEL/Core/Timer.hpp>
 #include <MEL/Logging/Csv.hpp>
 #include <MEL/Utility/System.hpp>
 #include <MEL/Utility/Mutex.hpp>
 #include <MEL/Utility/Options.hpp>
-#include <MEL/Devices/AtiSensor.hpp>
-#include <MEL/Devices/Windows/Keyboard.hpp>
 #include <MEL/Daq/Quanser/Q8Usb.hpp>
 
 // other misc standard libraries
+#include <atomic>
+#include <cstdlib>
 #include <queue>
 #include <thread>
 #include <string>
@@ -59,6 +81,13 @@ using namespace mel;
 const int	 		kTimeBetweenCues(10);// sets the number of milliseconds to wait in between cues
 const int	 		kConfirmValue(123);
 const bool	 		kTimestamp(false);
+const double		kSampleRate(1000.0);	// sets the force/torque logging rate in Hz
+const double		kTrialSeconds(0.5);		// sets the shortest time from one cue onset to the next
+const double		kCommandSkewWarning(0.0005);	// seconds between the two motor commands worth reporting
+const int			kKeyReopenAttempts(3);		// times a failed response key source is reopened before stopping
+// placeholders until each motor is tuned: both take the defaults, 5 counts after small moves and 500 after large ones
+const SettleConfig	kSettleConfigA = SettleConfig();			// move completion tolerances of the stretch motor
+const SettleConfig	kSettleConfigB = SettleConfig();			// move completion tolerances of the squeeze motor
 
 /* CHANGE THIS TO THE FILE PATH YOU WANT FILES SAVED TO FOR THIS EXPERIMENT */
 const std::string	kDataPath("C:/Git/local_data/ABS_Distance-Amplitude"); //file path to Main project files
@@ -71,11 +100,37 @@ Staircase	 staircase;
 TrialList	 trial_list;
 int			 subject = 0;
 
-// actual motor positions variable
-double		 motor_position[2];
-double		 motor_desired_position[2];
+// exit flag variable
 ctrl_bool	 stop(false);
 
+// actual motor positions and force/torque samples of the current trial
+MovementState	movement_state(kSampleRate);
+
+// absolute deadlines of every cue onset and sample of the session
+SessionScheduler	session_scheduler(kSampleRate, kTrialSeconds);
+
+// keys the staircase responses are read from
+KeyEventQueue		response_keys;
+
+// dedicated thread running the movement trials in real-time mode
+RealtimeConfig		realtime_config;
+RealtimeThread		motion_thread;
+
+// supervision loop timing of the session and the trial rows not yet saved
+LoopTiming							session_timing(0);
+std::vector<std::vector<double>>	loop_timing_rows;
+
+// background trial writer, owns the trial sample buffers for the session
+TrialWriter	 trial_writer(kTrialWriterBuffers_, kSampleBufferCapacity_);
+
+// append-only journal of the subject's ABS responses
+ResponseJournal abs_journal;
+
+// resume point of the subject's session, rewritten after every response
+CheckpointFile		abs_checkpoint;
+SessionCheckpoint	abs_checkpoint_state = {};
+bool				abs_checkpoint_found(false);
+
 
 /***********************************************************
 ******************** MOTOR FUNCTIONS ***********************
@@ -83,7 +138,7 @@ ctrl_bool	 stop(false);
 /*
 Sends relevant parameters to set up the Maxon motor
 */
-void MotorInitialize(MaxonMotor &motor, char* port_name)
+void MotorInitialize(MaxonMotor &motor, char* port_name, const SettleConfig &settle_config)
 {
 	// define relevant parameters for the controller
 	const unsigned int kDesiredVelocity =		10000;
@@ -98,134 +153,85 @@ void MotorInitialize(MaxonMotor &motor, char* port_name)
 
 	// set motor control parameters
 	motor.SetControlParam(kDesiredVelocity, kDesiredAcceleration, kDesiredDeceleration);
+
+	// set the tolerances deciding when a move has finished
+	motor.SetSettleConfig(settle_config);
 }
 
 
 /***********************************************************
 ****************** MOVEMENT FUNCTIONS **********************
 ************************************************************/
-/*
-Measures force/torque data, motor position data and time information
-during the motor movement
-*/
-void RecordMovementTrial(std::array<std::array<double,2>,2> &position_desired, 
-						DaqNI &daq_ni,				Q8Usb &q8,
-						AtiSensor &ati_a,			AtiSensor &ati_b,
-						MaxonMotor &motor_a,		MaxonMotor &motor_b,
-						std::vector<std::vector<double>>* output_)
-{	
-	// initial sample
-	int sample = 0;
-	
-	// loops through each of the positions in the std::array for the trial
-	for (int i = 0; i < position_desired.size(); i++)
-	{
-		// MOTOR MOVEMENT COMMANDS
-		// gets the new desired position to be sent to the motors
-		motor_desired_position[0] = position_desired[i][0];
-		motor_desired_position[1] = position_desired[i][1];
-
-		// COLLECT FIRST SAMPLE
-		// updates the input channels of the q8
-		q8.update_input();
-		// gets the actual positions of the motors
-		motor_a.GetPosition(motor_position[0]);
-		motor_b.GetPosition(motor_position[1]);
-
-		// move motors to desired positions
-		motor_a.Move( motor_desired_position[0] );
-		motor_b.Move( motor_desired_position[1] );
-
-		// create 1000Hz timer
-		Timer timer(hertz(1000)); 
-
-		// movement data record loop
-		while (!motor_a.TargetReached() || !motor_b.TargetReached())
-		{
-			// gets the actual positions of the motors
-			q8.update_input();
-			motor_a.GetPosition(motor_position[0]);
-			motor_b.GetPosition(motor_position[1]);
-
-			// DAQmx Read Code
-			daq_ni.update();
-			// measuring force/torque sensors
-			std::vector<double> forceA =	ati_a.get_forces();
-			std::vector<double> forceB =  	ati_b.get_forces();
-			std::vector<double> torqueA = 	ati_a.get_torques();
-			std::vector<double> torqueB = 	ati_b.get_torques();
-			std::vector<double> output_row;	
-			
-			// creates the output row for the motor position data file
-			output_row = { (double)sample,
-				// Motor/Sensor A
-				motor_desired_position[0],	motor_position[0], 
-				forceA[0],			forceA[1],			forceA[2], 
-				torqueA[0],			torqueA[1],			torqueA[2],
-				
-				// Motor/Sensor B
-				motor_desired_position[1],	motor_position[1],
-				forceB[0],			forceB[1],			forceB[2],
-				torqueB[0],			torqueB[1],			torqueB[2]
-			};
-			// input the the sampled data into output buffer
-			output_->push_back(output_row);
-
-			// debugging motor output
-			// print(	motor_desired_position[0],		motor_position[0],
-			//  		motor_desired_position[1],		motor_position[1]);
-
-			// increment sample number
-			sample++;
-			timer.wait();
-		}
-	}
-}
+// devices of the testbed rig
+typedef DeviceBundle<DaqNI, Q8Usb, MaxonMotor, WrenchReader, LoopTimer> RigDevices;
 
 /*
 Runs a single test trial on motor_a to ensure data logging
 is working.
 */
-void RunMovementTrial(std::array<std::array<double,2>,2> &position_desired,
-					DaqNI &daq_ni, 			Q8Usb &q8,
-					AtiSensor &ati_a,		AtiSensor &ati_b,
-					MaxonMotor &motor_a,	MaxonMotor &motor_b)
+template <typename Devices>
+void RunMovementTrial(std::array<std::array<double,2>,2> &position_desired, MovementRecorder<Devices> &recorder)
 {
-	// create new output buffer
-	std::vector<std::vector<double>> movementOutput;
+	TraceSpan span("RunMovementTrial", "trial");
+
+	// takes an empty output buffer from the writer's pool
+	SampleBuffer trial_buffer = trial_writer.AcquireBuffer();
 
 	// defining the file name for the export data 
 	std::string filename, filepath;
-	filename = "/sub" + std::to_string(subject) + "_" + std::to_string(trial_list.GetIterationNumber()) + "_" + trial_list.GetTrialName() + "_data.csv";
+	filename = "/sub" + std::to_string(subject) + "_" + std::to_string(trial_list.GetIterationNumber()) + "_" + trial_list.GetTrialName() + "_data" + trial_writer.GetExtension();
 	filepath = kDataPath + "/FT/subject" + std::to_string(subject) + filename;
 
-	// create 500 ms timer
-	Timer timer(milliseconds(500));
-	// starting haptic trial
-	RecordMovementTrial(position_desired, daq_ni, q8, ati_a, ati_b, motor_a, motor_b, &movementOutput);
-	// ensures the entire trial takes a total of 500 ms
-	timer.wait();
-
-	// Defines header names of the csv
-	const std::vector<std::string> header_names = 
-		{ 
-		"Samples",
-		// Motor/Sensor A
-		"Position A Desired", "Position A Actual",
-		"FxA", "FyA", "FzA",
-		"TxA", "TyA", "TzA",
-		// Motor/Sensor B
-		"Position B Desired", "Position B Actual", 
-		"FxB", "FyB", "FzB", 
-		"TxB", "TyB", "TzB" 
-		};
-
-	// saves and exports trial data
+	// describes the trial for the self describing trial log header
+	TrialLogInfo trial_info;
+	trial_info.subject =		subject;
+	trial_info.iteration =		trial_list.GetIterationNumber();
+	trial_info.condition =		trial_list.GetConditionNum();
+	trial_info.angle_index =	trial_list.GetAngleIndex();
+	trial_info.sample_rate =	recorder.GetDevices().daq.IsBuffered() ? kDaqBufferedRate_ : kSampleRate;
+	trial_info.trial_name =		trial_list.GetTrialName();
+
+	// runs on the real-time motion thread when started
+	motion_thread.Run([&]
+	{
+		// waits for the cue onset on the session clock
+		session_scheduler.WaitForOnset();
+		// starting haptic trial
+		RecordMovementTrial(position_desired, recorder, &trial_buffer);
+		// ensures the entire trial takes a total of 500 ms from its onset
+		session_scheduler.WaitForTrialEnd();
+	});
+
+	// stores the supervision loop timing with the trial
+	trial_info.timing = movement_state.timing.GetStats();
+	if (trial_info.timing.overruns > 0)
+		print("Supervision loop overran " + std::to_string(trial_info.timing.overruns) + " times, up to "
+			+ std::to_string(trial_info.timing.max_lateness * 1e3) + " ms late");
+	if (movement_state.max_command_skew > kCommandSkewWarning)
+		print("Motor commands were issued up to " + std::to_string(movement_state.max_command_skew * 1e3) + " ms apart");
+	if (movement_state.settle_timeouts > 0)
+		print("Motors did not settle within " + std::to_string(movement_state.max_settle_time) + " s in "
+			+ std::to_string(movement_state.settle_timeouts) + " steps, moved on");
 	if(!staircase_flag)
 	{
-		csv_write_row(filepath, header_names);
-		csv_append_rows(filepath, movementOutput);
+		std::vector<double> timing_row;
+		GetLoopTimingRow(trial_info.timing, timing_row);
+		timing_row.insert(timing_row.begin(), { (double)trial_info.iteration, (double)trial_info.condition, (double)trial_info.angle_index });
+		loop_timing_rows.push_back(timing_row);
+		session_timing.Merge(trial_info.timing);
 	}
+
+	// warns experimenter if the trial outran the output buffer
+	if (trial_buffer.GetDropped() > 0)
+		print("Sample buffer full, " + std::to_string(trial_buffer.GetDropped()) + " samples dropped");
+	if (movement_state.ring.GetDropped() > 0)
+		print("Force/torque ring full, " + std::to_string(movement_state.ring.GetDropped()) + " samples dropped");
+
+	// hands trial data to the writer thread to be saved
+	if(!staircase_flag)
+		trial_writer.Submit(filepath, trial_info, std::move(trial_buffer));
+	else
+		trial_writer.ReleaseBuffer(std::move(trial_buffer));
 }
 
 
@@ -263,6 +269,42 @@ void ImportSubjectNumber()
 	mel::print("");
 }
 
+/*
+Opens the subject's session checkpoint and reads the point
+the last session stopped at, if there was one
+*/
+void ImportCheckpoint()
+{
+	std::string filepath = kDataPath + "/ABS/sub" + std::to_string(subject) + "_ABS_checkpoint.bin";
+	abs_checkpoint_state = {};
+	abs_checkpoint_found = false;
+
+	if (!abs_checkpoint.Open(filepath))
+	{
+		print("Failed to open ABS checkpoint " + filepath);
+		return;
+	}
+	abs_checkpoint_found = abs_checkpoint.Read(abs_checkpoint_state) &&
+		abs_checkpoint_state.subject == subject;
+	if (!abs_checkpoint_found)
+		abs_checkpoint_state = {};
+	abs_checkpoint_state.subject = subject;
+}
+
+/*
+Writes the current resume point of the session to the
+checkpoint file
+*/
+void SaveCheckpoint()
+{
+	abs_checkpoint_state.seed =				trial_list.GetSeed();
+	abs_checkpoint_state.response_count =	abs_journal.GetNextSequence();
+	abs_checkpoint_state.compacted_rows =	abs_journal.GetCompactedSequence();
+	abs_checkpoint_state.journal_offset =	abs_journal.GetCompactedOffset();
+	if (!abs_checkpoint.Write(abs_checkpoint_state))
+		print("Failed to save ABS checkpoint!");
+}
+
 /*
 Based on the subject number, attempts to import the relevant
 trialList to the experiment.
@@ -276,67 +318,280 @@ void ImportTrialList()
 	{
 		print("Subject " + std::to_string(subject) + "'s trialList has been successfully imported");
 	}
+	else if (abs_checkpoint_found && abs_checkpoint_state.seed != 0)
+	{
+		// rebuilds the lost trialList from the seed it was randomized with
+		trial_list.scramble(abs_checkpoint_state.seed);
+		print("Subject " + std::to_string(subject) + "'s trialList has been rebuilt from the session checkpoint");
+		trial_list.ExportList(filepath, kTimestamp);
+	}
 	else
 	{
 		// if there was no trial_list to import, randomizes a new trialList
 		trial_list.scramble();
 		print("Subject " + std::to_string(subject) + "'s trialList has been made and randomized successfully");
+
+		// the trialList never changes after randomizing, so it is exported once here
+		trial_list.ExportList(filepath, kTimestamp);
 	}
 	print("");
 }
 
 /*
-Based on the subject number, attempts to import the relevant
-trialList to the experiment.
+Appends the supervision loop timing of every trial since the
+last export to the subject's loop timing file
 */
-void ImportRecordABS(std::vector<std::vector<double>>* threshold_output)
+void ExportLoopTiming()
 {
-	// declares variables for filename and output
+	TraceSpan span("ExportLoopTiming", "io");
+
+	if (loop_timing_rows.empty()) return;
+
+	// defining the file name for the loop timing file
+	std::string filename = "/sub" + std::to_string(subject) + "_loop_timing.csv";
+	std::string filepath = kDataPath + "/FT" + filename;
+
+	// starts the file with its header if this is the first save
+	if (!FileExists(filepath))
+	{
+		std::vector<std::string> header_names;
+		GetLoopTimingHeader(session_timing.GetStats(), header_names);
+		header_names.insert(header_names.begin(), { "Iteration", "Condition", "Angle Index" });
+		csv_write_row(filepath, header_names);
+	}
+	if (csv_append_rows(filepath, loop_timing_rows))
+		loop_timing_rows.clear();
+	else
+		print("Failed to save the loop timing, it will be retried at the next export");
+}
+
+/*
+Prints the supervision loop timing of the whole session and
+appends it to the subject's loop timing summary file
+*/
+void ExportLoopTimingSummary()
+{
+	const LoopTimingStats &stats = session_timing.GetStats();
+	if (stats.ticks == 0) return;
+
+	print("Supervision loop: " + std::to_string(stats.ticks) + " ticks, mean period "
+		+ std::to_string(stats.mean_period * 1e3) + " ms, max period " + std::to_string(stats.max_period * 1e3) + " ms");
+	print("Supervision loop: " + std::to_string(stats.overruns) + " overruns, max lateness "
+		+ std::to_string(stats.max_lateness * 1e3) + " ms");
+
+	// defining the file name for the loop timing summary file
+	std::string filename = "/sub" + std::to_string(subject) + "_loop_timing_summary.csv";
+	std::string filepath = kDataPath + "/FT" + filename;
+
+	// one row per session run of the subject
+	if (!FileExists(filepath))
+	{
+		std::vector<std::string> header_names;
+		GetLoopTimingHeader(stats, header_names);
+		csv_write_row(filepath, header_names);
+	}
+	std::vector<double> summary_row;
+	GetLoopTimingRow(stats, summary_row);
+	csv_append_row(filepath, summary_row);
+}
+
+/*
+Prints the latencies of the EPOS and DAQmx driver calls made
+this session and appends them to the subject's driver latency
+file
+*/
+void ExportDriverLatency()
+{
+	PrintDriverLatencyReport();
+
+	// defining the file name for the driver latency file
+	std::string filename = "/sub" + std::to_string(subject) + "_driver_latency.csv";
+	std::string filepath = kDataPath + "/FT" + filename;
+	if (!WriteDriverLatencyReport(filepath))
+		print("Failed to save the driver call latencies to " + filepath);
+}
+
+/*
+Appends every journaled ABS response that is not yet in the
+ABS data file to it. Only new rows are written, so the cost
+does not grow with the length of the session.
+*/
+void CompactRecordABS()
+{
+	TraceSpan span("CompactRecordABS", "io");
+
+	// defining the file name for the ABS data file
 	std::string filename = "/sub" + std::to_string(subject) + "_ABS_data.csv";
 	std::string filepath = kDataPath + "/ABS" + filename;
 
+	// builds header names for threshold logger
+	const std::vector<std::string> header_names = 
+	{ 
+		"Iteration",			"Condition",
+		"AngCurr",				"Interference Angle",
+		"Test Angle",			"Detected (1=Detected 2=Not Detected)"
+	};
+
+	// collects the responses given since the last compaction
+	std::vector<std::vector<double>> new_rows;
+	abs_journal.GetUncompacted(new_rows);
+	if (new_rows.empty()) return;
+
+	// saves the new ABS data, starting the file if this is the first save
+	if (abs_journal.GetCompactedSequence() == 0 || !FileExists(filepath))
+		csv_write_row(filepath, header_names);
+	if (csv_append_rows(filepath, new_rows))
+	{
+		abs_journal.MarkCompacted();
+		SaveCheckpoint();
+	}
+	else
+		print("Failed to save ABS data, responses remain in the journal");
+}
+
+/*
+Parses a row of an ABS data file, leaving row untouched and
+returning false if any value is not a number or the row is
+missing columns.
+*/
+bool ParseRecordABS(const std::string &line, std::vector<double> &row)
+{
+	std::vector<double> values;
+	std::istringstream line_stream(line);
+	std::string value_string;
+	while (getline(line_stream, value_string, ','))
+	{
+		const char* value_start = value_string.c_str();
+		char* value_end = nullptr;
+		double value = std::strtod(value_start, &value_end);
+		if (value_end == value_start) return false;
+		while (*value_end == ' ' || *value_end == '\r') value_end++;
+		if (*value_end != '\0') return false;
+		values.push_back(value);
+	}
+	if (values.size() < (std::size_t)kJournalColumns_) return false;
+	row.swap(values);
+	return true;
+}
+
+/*
+Reads the number of rows and the last row of an ABS data
+file in a single pass. A last row left truncated or garbled
+by a crash is skipped and not counted, so the previous row
+is used and the response is replayed from the journal. Only
+used for sessions recorded before the checkpoint file existed.
+*/
+bool ReadLastRecordABS(const std::string &filepath, int &rows, std::vector<double> &last_row)
+{
 	// defines relevant variables for data import
-	int 		rows = 0;
-	int 		cols = 0;
 	const int	kRowOffset(1);
-	const int	kIterationNumIndex(0);
-	const int	kAngleNumIndex(2);
+	rows = 0;
 
-	// determine size of the input 
 	std::ifstream file(filepath);
-	if (file.is_open())
+	if (!file.is_open()) return false;
+
+	// counts the rows while keeping only the last two
+	std::string line_string;
+	std::string last_line;
+	std::string previous_line;
+	while (getline(file, line_string))
 	{
-		std::string line_string;	
-		while (getline(file, line_string)) 
+		rows ++;
+		if (rows > kRowOffset && !line_string.empty())
 		{
-			rows ++;
-			if (rows == kRowOffset)
-			{
-				std::istringstream line_stream(line_string);
-				std::string value_string;
-				while(getline(line_stream, value_string, ','))
-					cols ++;
-			}
+			previous_line.swap(last_line);
+			last_line = line_string;
 		}
-		rows -= kRowOffset;
 	}
-	
-	// prints the size of the input file
-	// print("Rows: " + std::to_string(rows) + " | Cols: " + std::to_string(cols));
+	rows -= kRowOffset;
+	if (rows <= 0 || last_line.empty())
+	{
+		rows = rows > 0 ? rows : 0;
+		return false;
+	}
+
+	// parses the last row, falling back to the one before it
+	if (ParseRecordABS(last_line, last_row))
+		return true;
+	rows--;
+	return !previous_line.empty() && ParseRecordABS(previous_line, last_row);
+}
+
+/*
+Based on the subject number, finds where the subject's last
+session stopped. The session checkpoint gives the resume
+point directly, so the ABS data file is never read back;
+only the journal records since the last save are replayed.
+*/
+void ImportRecordABS()
+{
+	// declares variables for filename and output
+	std::string filename = "/sub" + std::to_string(subject) + "_ABS_data.csv";
+	std::string filepath = kDataPath + "/ABS" + filename;
+	std::string journal_filepath = kDataPath + "/ABS/sub" + std::to_string(subject) + "_ABS_journal.bin";
+
+	// defines relevant variables for data import
+	const int	kIterationNumIndex(0);
+	const int	kConditionNumIndex(1);
+	const int	kAngleNumIndex(2);
 
 	// defines variables to hold data input	
-	std::vector<std::vector<double>>	input(rows, std::vector<double>(cols));
-	std::vector<double> 				input_row(cols);
+	std::vector<double> input_row(kJournalColumns_, 0.0);
+	bool				imported = false;
+	std::uint64_t		compacted_rows = 0;
+	std::int64_t		replay_offset = 0;
 
-	// loads ABS threshold record into experiment
-	if(csv_read_rows(filepath, input, kRowOffset, 0))
+	// takes the resume point from the checkpoint if there is one
+	if (abs_checkpoint_found)
 	{
-		for (int i = 0; i < rows; i++)
+		compacted_rows = abs_checkpoint_state.compacted_rows;
+		replay_offset = abs_checkpoint_state.journal_offset;
+		if (abs_checkpoint_state.has_trial != 0)
 		{
-			input_row = input[i];
-			threshold_output->push_back(input_row);
+			input_row[kIterationNumIndex] =	abs_checkpoint_state.iteration;
+			input_row[kConditionNumIndex] =	abs_checkpoint_state.condition;
+			input_row[kAngleNumIndex] =		abs_checkpoint_state.angle_index;
+			imported = true;
 		}
+	}
+	// otherwise falls back to the last row of the ABS data file
+	else
+	{
+		int rows = 0;
+		imported = ReadLastRecordABS(filepath, rows, input_row);
+		compacted_rows = (std::uint64_t)rows;
+	}
 
+	// opens the response journal and recovers responses never saved to the ABS file
+	if (!abs_journal.Open(journal_filepath, compacted_rows, replay_offset))
+		print("Failed to open ABS response journal " + journal_filepath);
+	std::vector<double> last_response;
+	if (abs_journal.GetLastResponse(last_response))
+	{
+		input_row = last_response;
+		imported = true;
+	}
+	std::vector<std::vector<double>> recovered_rows;
+	abs_journal.GetUncompacted(recovered_rows);
+	if (!recovered_rows.empty())
+	{
+		CompactRecordABS();
+		print("Recovered " + std::to_string(recovered_rows.size()) + " unsaved responses from the journal");
+	}
+
+	// brings the checkpoint up to date with what was recovered
+	if (imported)
+	{
+		abs_checkpoint_state.iteration =	(std::int32_t)input_row[kIterationNumIndex];
+		abs_checkpoint_state.angle_index =	(std::int32_t)input_row[kAngleNumIndex];
+		abs_checkpoint_state.condition =	(std::int32_t)input_row[kConditionNumIndex];
+		abs_checkpoint_state.has_trial =	1;
+	}
+	SaveCheckpoint();
+
+	// resumes from the last recorded response
+	if(imported)
+	{
 		// confirms import with experimenter 
 		trial_list.SetCombo((int)input_row[kIterationNumIndex] + 1, (int)input_row[kAngleNumIndex] + 1);
 		print("Subject " + std::to_string(subject) + "'s ABS record has been successfully imported");
@@ -387,7 +642,7 @@ void ImportRecordABS(std::vector<std::vector<double>>* threshold_output)
 Record's participant's ABS response to current trial
 */
 //void RecordExperimentABS(std::vector<std::vector<double>>* threshold_output, bool ref2Test)
-void RecordExperimentABS(std::vector<std::vector<double>>* threshold_output)
+void RecordExperimentABS()
 {
 	// creates an integer for user input
 	int input_value = 0;
@@ -406,19 +661,28 @@ void RecordExperimentABS(std::vector<std::vector<double>>* threshold_output)
 		std::cin.sync();
 		
 		// recieves user input
+		TraceSpan span("Waiting for response", "subject");
 		std::cin >> input_value;
 	}
 	
 	// tells user their selected input for debug
 	// mel::print("You typed " + std::to_string(input_value));
 
-	// add current row for ABS testing to the buffer
+	// add current row for ABS testing to the journal
 	std::vector<double> output_row = { 
 		(double)trial_list.GetIterationNumber(),	(double)trial_list.GetConditionNum(),
 		(double)trial_list.GetAngleIndex(),			(double)trial_list.GetInterferenceAngle(),
 		(double)trial_list.GetAngleNumber(),		(double)input_value 
 	};
-	threshold_output->push_back(output_row);
+	if (!abs_journal.Append(output_row))
+		print("Failed to journal ABS response!");
+
+	// moves the resume point past this trial
+	abs_checkpoint_state.iteration =	trial_list.GetIterationNumber();
+	abs_checkpoint_state.condition =	trial_list.GetConditionNum();
+	abs_checkpoint_state.angle_index =	trial_list.GetAngleIndex();
+	abs_checkpoint_state.has_trial =	1;
+	SaveCheckpoint();
 }
 
 /*
@@ -467,21 +731,20 @@ Asks the experimenter for the subject number. Then, if
 relevant, imports trialList and ABS file from previous
 experiment
 */
-void RunImportUI(std::vector<std::vector<double>>* threshold_output)
+void RunImportUI()
 {
 	ImportSubjectNumber();
+	ImportCheckpoint();
 	ImportTrialList();
-	ImportRecordABS(threshold_output);
+	ImportRecordABS();
 }
 
 /*
 Run a single condition on a user automatically. If
 experimenter enters the exit value, exits the program.
 */
-void RunExperimentUI(DaqNI &daq_ni, 		Q8Usb &q8,
-					 AtiSensor &ati_a,	 	AtiSensor &ati_b,
-					 MaxonMotor &motor_a, 	MaxonMotor &motor_b,
-					 std::vector<std::vector<double>>* threshold_output)
+template <typename Devices>
+void RunExperimentUI(MovementRecorder<Devices> &recorder)
 {
 	// defines positions of the currrent test cue
 	std::array<std::array<double, 2>, 2> position_desired;
@@ -511,10 +774,10 @@ void RunExperimentUI(DaqNI &daq_ni, 		Q8Usb &q8,
 		// print(position_desired[0]);
 		
 		// provides cue to user
-		RunMovementTrial(position_desired, daq_ni, q8, ati_a, ati_b, motor_a, motor_b);
+		RunMovementTrial(position_desired, recorder);
 
 		// record ABS trial response
-		RecordExperimentABS(threshold_output);
+		RecordExperimentABS();
 
 		// moves experiment to the next trial within current condition
 		trial_list.NextAngle();
@@ -527,33 +790,95 @@ void RunExperimentUI(DaqNI &daq_ni, 		Q8Usb &q8,
 	trial_list.GetTestPositions(position_desired);
 
 	// provides final cue of condition to user
-	RunMovementTrial(position_desired, daq_ni, q8, ati_a, ati_b, motor_a, motor_b);
+	RunMovementTrial(position_desired, recorder);
 
 	// record final ABS trial response
-	RecordExperimentABS(threshold_output);
+	RecordExperimentABS();
+}
+
+/*
+Prints how late the cue onsets, samples and trial ends of
+the session were met and appends every trial's deadlines to
+the subject's schedule file
+*/
+void ExportSchedule()
+{
+	const std::vector<ScheduleEntry> &entries = session_scheduler.GetEntries();
+	if (entries.empty()) return;
+
+	const LatencyHistogram &onset = session_scheduler.GetOnsetLateness();
+	const LatencyHistogram &sample = session_scheduler.GetSampleLateness();
+	const LatencyHistogram &end = session_scheduler.GetEndLateness();
+	print("Cue onsets: " + std::to_string(onset.GetCount()) + " over " + std::to_string(entries.back().onset / 60.0)
+		+ " min, lateness p99 " + std::to_string(onset.GetPercentile(99.0) * 1e-6) + " ms, max " + std::to_string(onset.GetMax() * 1e-6) + " ms");
+	print("Samples: lateness p99 " + std::to_string(sample.GetPercentile(99.0) * 1e-6) + " ms, max "
+		+ std::to_string(sample.GetMax() * 1e-6) + " ms, " + std::to_string(session_scheduler.GetMissedSamples()) + " missed");
+	print("Trial ends: lateness p99 " + std::to_string(end.GetPercentile(99.0) * 1e-6) + " ms, max " + std::to_string(end.GetMax() * 1e-6) + " ms");
+
+	// defining the file name for the schedule file
+	std::string filename = "/sub" + std::to_string(subject) + "_schedule.csv";
+	std::string filepath = kDataPath + "/FT" + filename;
+
+	// one row per trial, times in seconds since the start of the run
+	if (!FileExists(filepath))
+	{
+		const std::vector<std::string> kHeaderNames = {
+			"Trial", "Onset (s)", "Onset Lateness (ms)", "Interval (s)", "End (s)", "End Lateness (ms)" };
+		csv_write_row(filepath, kHeaderNames);
+	}
+	std::vector<std::vector<double>> schedule_rows;
+	for (std::size_t i = 0; i < entries.size(); i++)
+	{
+		double interval = i > 0 ? entries[i].onset - entries[i - 1].onset : 0.0;
+		schedule_rows.push_back({ (double)(i + 1), entries[i].onset, entries[i].onset_lateness * 1e3,
+			interval, entries[i].end, entries[i].end_lateness * 1e3 });
+	}
+	if (!csv_append_rows(filepath, schedule_rows))
+		print("Failed to save the session schedule to " + filepath);
+}
+
+/*
+Returns a held interference motor to zero at the end of a
+condition so the testbed can be adjusted between conditions
+*/
+template <typename Devices>
+void ReleaseInterference(MovementRecorder<Devices> &recorder)
+{
+	if (!trial_list.GetHoldInterference() && !staircase.GetHoldInterference()) return;
+	bool parked = true;
+	motion_thread.Run([&] { parked = ParkMotors(kZeroAngle_, kZeroAngle_, recorder); });
+	if (!parked)
+		print("Motors did not settle at zero within " + std::to_string(recorder.GetState().max_settle_time) + " s");
+}
+
+/*
+Checks both controllers between conditions or staircases and
+waits for the checks, so no check holds a controller while the
+next trial commands its motor
+*/
+template <typename Devices>
+void CheckControllers(MovementRecorder<Devices> &recorder)
+{
+	recorder.GetDevices().motor_a.CheckState();
+	recorder.GetDevices().motor_b.CheckState();
+	recorder.GetDevices().motor_a.WaitForCheck();
+	recorder.GetDevices().motor_b.WaitForCheck();
 }
 
 /*
 Saves the ABS data file as well as the trialList given
 to the participant.
 */
-void RunExportUI(std::vector<std::vector<double>>* threshold_output)
+void RunExportUI()
 {
-	// defining the file name for the ABS data file
-	std::string filename = "/sub" + std::to_string(subject) + "_ABS_data.csv";
-	std::string filepath = kDataPath + "/ABS" + filename;
+	// waits for the writer to save every trial of the condition
+	trial_writer.Flush();
 
-	// builds header names for threshold logger
-	const std::vector<std::string> header_names = 
-	{ 
-		"Iteration",			"Condition",
-		"AngCurr",				"Interference Angle",
-		"Test Angle",			"Detected (1=Detected 2=Not Detected)"
-	};
+	// appends the responses since the last save to the ABS data
+	CompactRecordABS();
 
-	// saves the ABS data
-	csv_write_row(filepath, header_names);
-	csv_append_rows(filepath, *threshold_output);
+	// appends the loop timing of the trials since the last save
+	ExportLoopTiming();
 
 	// information about the current trial the test was exited on
 	print("Test Saved @ ");
@@ -562,21 +887,38 @@ void RunExportUI(std::vector<std::vector<double>>* threshold_output)
 		+ trial_list.GetConditionName());
 	print("Angle:" + std::to_string(trial_list.GetAngleIndex()) + " - "
 		+ std::to_string(trial_list.GetAngleNumber()));
-
-	// exporting the trialList for this subject
-	// defining the file name for the ABS data file
-	filename = "/sub" + std::to_string(subject) + "_trialList.csv";
-	filepath = kDataPath + "/trialList" + filename;
-	trial_list.ExportList(filepath, kTimestamp);
 }
 
 
 /***********************************************************
 ****************** STAIRCASE FUNCTIONS *********************
 ************************************************************/
-void RunStaircaseUI(DaqNI &daq_ni,			Q8Usb &q8,
-					AtiSensor &ati_a,	 	AtiSensor &ati_b,
-					MaxonMotor &motor_a, 	MaxonMotor &motor_b)
+/*
+Reads the subject's response to the last cue. If the response
+keys fail, such as an unplugged keyboard or a closed terminal,
+they are reopened and the response is read again without
+repeating the cue. Returns false when stopping or if the keys
+cannot be reopened, which also stops the protocol.
+*/
+bool ReadStaircaseResponse()
+{
+	int attempts = 0;
+	while (!staircase.ReadInput(response_keys))
+	{
+		if (stop) return false;
+		if (++attempts > kKeyReopenAttempts || !response_keys.Reopen())
+		{
+			print("Response keys failed and could not be reopened, stopping");
+			stop = true;
+			return false;
+		}
+		print("Response keys failed, reopened them, please respond again");
+	}
+	return true;
+}
+
+template <typename Devices>
+void RunStaircaseUI(MovementRecorder<Devices> &recorder)
 {
 	// define relevant variable containers for desire position
 	std::array<std::array<double, 2>, 2> position_desired;
@@ -601,10 +943,14 @@ void RunStaircaseUI(DaqNI &daq_ni,			Q8Usb &q8,
 		while(!staircase.HasSettled())
 		{
 			staircase.GetTestPositions(position_desired);
-			RunMovementTrial(position_desired, daq_ni, q8, ati_a, ati_b, motor_a, motor_b);
-			staircase.ReadInput();
+			RunMovementTrial(position_desired, recorder);
+			if(!ReadStaircaseResponse()) break;
 		}
-		print("Trial Completed");
+		if(staircase.HasSettled())
+			print("Trial Completed");
+
+		// parks a held interference motor as the condition ends
+		ReleaseInterference(recorder);
 	}
 
 	// runs through all conditions with the staircase method
@@ -616,10 +962,21 @@ void RunStaircaseUI(DaqNI &daq_ni,			Q8Usb &q8,
 			while(!staircase.HasSettled())
 			{
 				staircase.GetTestPositions(position_desired);
-				RunMovementTrial(position_desired, daq_ni, q8, ati_a, ati_b, motor_a, motor_b);
-				staircase.ReadInput();
+				RunMovementTrial(position_desired, recorder);
+				if(!ReadStaircaseResponse()) break;
+			}
+
+			// stops without a response rather than repeating the cue
+			if(!staircase.HasSettled())
+			{
+				ReleaseInterference(recorder);
+				return;
 			}
 			print("Trial Completed");
+
+			// parks a held interference motor before the next staircase
+			ReleaseInterference(recorder);
+			CheckControllers(recorder);
 			if(staircase.HasNextTrial())
 				staircase.NextTrial();
 			else if(staircase.HasNextCondition())
@@ -628,6 +985,8 @@ void RunStaircaseUI(DaqNI &daq_ni,			Q8Usb &q8,
 				staircase.NextCondition();
 				print(staircase.GetConditionName());
 			}
+			else
+				break;
 		}
 	}
 }
@@ -670,33 +1029,47 @@ int main(int argc, char* argv[])
     if (!q8.enable()) return 1;
 
 	// creates all neccesary sensor and motor objects for the program
-	AtiSensor	ati_a, ati_b;				// create the ATI FT Sensors
+	WrenchReader	wrench_reader;			// create the ATI FT Sensors
 	MaxonMotor	motor_a(q8.encoder[0]),	// create new motors
 				motor_b(q8.encoder[1]);
-	std::vector<std::vector<double>>	threshold_output;		// creates pointer to the output data file for the experiment
 	
 	// Sensor Initialization
 	// calibrate the FT sensors 
-	ati_a.load_calibration("FT26062.cal");
-	ati_b.load_calibration("FT26061.cal");
-
-	// set channels used for the FT sensors
-	ati_a.set_channels(daq_ni[{ 0, 1, 2, 3, 4, 5 }]);	 
-	ati_b.set_channels(daq_ni[{ 16, 17, 18, 19, 20, 21 }]);
+	// sensor A reads DAQ channels 0-5 and sensor B channels 16-21, in scan order
+	if (!wrench_reader.AddSensor("FT26062.cal") || !wrench_reader.AddSensor("FT26061.cal"))
+	{
+		print("Failed to load the ATI calibration files");
+		return 1;
+	}
 
 	// zero the ATI FT sensors 
 	daq_ni.update();
-	ati_a.zero();
-	ati_b.zero();
+	wrench_reader.Zero(daq_ni.GetScanValues());
 	
 	// Motor Initialization
-	MotorInitialize(motor_a, (char*)"USB0");
-	MotorInitialize(motor_b, (char*)"USB1");
+	MotorInitialize(motor_a, (char*)"USB0", kSettleConfigA);
+	MotorInitialize(motor_b, (char*)"USB1", kSettleConfigB);
+
+	// bundles the rig's devices for the movement trials
+	RigDevices	devices = { daq_ni, q8, motor_a, motor_b, wrench_reader };
 
 	// Defines and parses console options
     Options options("AIMS_Control.exe", "AIMS Testbed Control");
     options.add_options()
         ("s,staircase", "Opens staircase method control")
+        ("b,binary", "Saves trial force/torque data as binary trial logs")
+        ("c,container", "Saves all trial force/torque data of a subject in one session file")
+        ("k,sample-clock", "Samples force/torque on the DAQ's sample clock instead of on demand")
+        ("t,trace", "Writes a timeline of the session to a trace event JSON file", value<std::string>())
+        ("i,hold-interference", "Keeps the interference motor at its angle for a whole condition")
+        ("w,wait", "Waits for loop deadlines by sleep, spin or hybrid (default)", value<std::string>())
+        ("spin-threshold", "Microseconds a hybrid wait spins before its deadline", value<double>())
+        ("e,evdev", "Reads the staircase response keys from a Linux evdev device instead of the console", value<std::string>())
+        ("r,realtime", "Runs the movement trials at real-time priority on dedicated cores with locked memory")
+        ("rt-cpu", "Core of the real-time motion thread, the last core by default", value<int>())
+        ("rt-acquisition-cpu", "Core of the real-time acquisition thread, the one before the motion core by default", value<int>())
+        ("rt-command-cpus", "Cores of the real-time motor A and B command threads, the two before the acquisition core by default", value<std::vector<int>>())
+        ("rt-priority", "SCHED_FIFO priority of the real-time threads", value<int>())
         ("h,help", "Prints this Help Message");
     auto input = options.parse(argc, argv);
 
@@ -706,19 +1079,99 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
+	// records a timeline of the session if requested
+	std::string trace_filepath;
+	if (input.count("t") > 0)
+	{
+		trace_filepath = input["t"].as<std::string>();
+		StartTrace();
+		SetTraceThreadName("Experiment");
+	}
+
+	// selects how the loops wait for their deadlines
+	WaitConfig wait_config;
+	if (input.count("w") > 0 && !ParseWaitMode(input["w"].as<std::string>(), wait_config.mode))
+		print("Unknown wait mode " + input["w"].as<std::string>() + ", using " + GetWaitModeName(wait_config.mode));
+	if (input.count("spin-threshold") > 0)
+		wait_config.spin_threshold = input["spin-threshold"].as<double>() * 1e-6;
+	SetDefaultWaitConfig(wait_config);
+
+	// moves the movement trials onto real-time threads if requested
+	if (input.count("r") > 0)
+	{
+		if (input.count("rt-cpu") > 0)
+			realtime_config.motion_cpu = input["rt-cpu"].as<int>();
+		if (input.count("rt-acquisition-cpu") > 0)
+			realtime_config.acquisition_cpu = input["rt-acquisition-cpu"].as<int>();
+		if (input.count("rt-priority") > 0)
+			realtime_config.priority = input["rt-priority"].as<int>();
+
+		if (input.count("rt-command-cpus") > 0)
+		{
+			std::vector<int> command_cpus = input["rt-command-cpus"].as<std::vector<int>>();
+			for (std::size_t i = 0; i < command_cpus.size() && i < 2; i++)
+				realtime_config.command_cpu[i] = command_cpus[i];
+		}
+
+		RealtimeReport realtime_report = PrepareRealtime(realtime_config);
+		realtime_report.motion = motion_thread.Start(realtime_config.priority, GetRealtimeCpu(realtime_config.motion_cpu, 0));
+		movement_state.realtime = &realtime_config;
+		PrintRealtimeReport(realtime_report);
+	}
+
+	// starts the motor command and acquisition threads once for the session
+	MovementRecorder<RigDevices> recorder(devices, movement_state);
+
+	// starts the background trial writer
+	trial_writer.Start();
+
+	// starts the session clock every cue and sample is scheduled on
+	session_scheduler.Start();
+	movement_state.scheduler = &session_scheduler;
+
+	// selects the file format for trial force/torque data
+	if (input.count("b") > 0)
+		trial_writer.SetFormat(TrialFormat::Binary);
+
+	// runs the force/torque channels continuously on the DAQ's sample clock
+	if (input.count("k") > 0)
+	{
+		if (daq_ni.StartBuffered(kDaqBufferedRate_, kDaqBlockSize_))
+			print("Force/torque sampled at " + std::to_string((int)kDaqBufferedRate_) + " Hz in blocks of " + std::to_string(kDaqBlockSize_));
+		else
+			daq_ni.StartOnDemand();
+	}
+
+	// moves only the test motor between cues if requested
+	if (input.count("i") > 0)
+	{
+		trial_list.SetHoldInterference(true);
+		staircase.SetHoldInterference(true);
+		print("Interference motor held at its angle for each condition");
+	}
+
 	// runs staircase method protocol if selected
 	if (input.count("s") > 0)
 	{
 		// sets to staircase mode
 		staircase_flag = true;
 
+		// opens the source of the response keys
+		std::string key_device = input.count("e") > 0 ? input["e"].as<std::string>() : "";
+		if (!response_keys.Open(key_device))
+		{
+			print("Failed to open the response keys" + (key_device.empty() ? std::string("") : " on " + key_device));
+			return EXIT_FAILURE;
+		}
+
 		// imports the current subject number
 		ImportSubjectNumber();
 
 		// runs staircase method until directed to exit
 		while(!stop)
 		{
-			RunStaircaseUI(daq_ni, q8, ati_a, ati_b, motor_a, motor_b);
+			RunStaircaseUI(recorder);
+			CheckControllers(recorder);
 		}
 
 		// exports staircase method output
@@ -732,23 +1185,60 @@ int main(int argc, char* argv[])
 	{		 
 		// User Interaction Portion of Program
 		// import relevant data or creates new data structures
-		RunImportUI(&threshold_output);
+		RunImportUI();
+
+		// opens the subject's session container, resuming it if it exists
+		if (input.count("c") > 0)
+		{
+			std::string filepath = kDataPath + "/FT/sub" + std::to_string(subject) + "_session" + kSessionExtension_;
+			if (trial_writer.OpenSession(filepath, subject))
+				print("Session file opened with " + std::to_string(trial_writer.GetSessionTrialCount()) + " trials");
+			else
+				print("Failed to open session file " + filepath + ", saving trials as individual files");
+			print("");
+		}
 
 		// runs ABS experimental protocol automatically
 		while (!stop)
 		{
 			// runs a full condition unless interupted
-			RunExperimentUI(daq_ni, q8, ati_a, ati_b, motor_a, motor_b, &threshold_output);
+			RunExperimentUI(recorder);
+			ReleaseInterference(recorder);
+			CheckControllers(recorder);
 
 			// exports relevant ABS data
-			RunExportUI(&threshold_output);
+			RunExportUI();
 
 			// advance to the next condition if another condition exists
 			AdvanceExperimentCondition();		
 		}
 
 		// exports relevant ABS data
-		RunExportUI(&threshold_output);
+		RunExportUI();
+	}
+
+	// summarizes the supervision loop timing of the session
+	if (!staircase_flag)
+		ExportLoopTimingSummary();
+	ExportDriverLatency();
+	ExportSchedule();
+	PrintWaitReport();
+
+	// writes out any trials still queued before exiting
+	motion_thread.Stop();
+	trial_writer.Stop();
+	abs_journal.Close();
+	abs_checkpoint.Close();
+	if (trial_writer.GetFailedWrites() > 0)
+		print(std::to_string(trial_writer.GetFailedWrites()) + " trial files failed to save!");
+
+	// saves the timeline once every traced thread has stopped
+	if (!trace_filepath.empty())
+	{
+		if (WriteTrace(trace_filepath))
+			print("Session trace saved to " + trace_filepath);
+		else
+			print("Failed to save session trace " + trace_filepath);
 	}
 
     // disable q8 USB
@@ -0,0 +1,241 @@
+/*
+File: trace.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the session trace. Every thread that
+records a span is given an event buffer from a shared pool.
+A thread only takes the pool lock the first time it traces.
+Buffers grow in fixed chunks that are never moved, so a full
+chunk costs a single allocation in the loop being traced
+rather than copying every event recorded so far. When a
+thread exits its buffer goes back to the pool with its
+events, so a thread started again, such as a recorder made
+for another session, reuses its timeline lane instead of
+adding a new one. The trace should be written once the
+threads being traced have stopped.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "trace.hpp"
+
+// other misc standard libraries
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/***********************************************************
+******************* STRUCT DECLARATION *********************
+************************************************************/
+// single complete span
+struct TraceEvent
+{
+	const char*		name;
+	const char*		category;
+	std::int64_t	start;	// nanoseconds since the trace started
+	std::int64_t	end;
+};
+
+// events of one timeline lane, kept in chunks of kTraceChunkEvents_
+struct TraceBuffer
+{
+	int										lane;
+	std::string								thread_name;
+	std::atomic<bool>						in_use;
+	std::vector<std::unique_ptr<TraceEvent[]>>	chunks;
+	std::size_t								size;
+	unsigned long							dropped;
+};
+
+// releases the thread's buffer back to the pool when the thread exits
+struct TraceThread
+{
+	TraceBuffer* buffer = nullptr;
+	~TraceThread()
+	{
+		if (buffer != nullptr) buffer->in_use.store(false, std::memory_order_release);
+	}
+};
+
+
+/***********************************************************
+******************* GLOBAL VARIABLES ***********************
+************************************************************/
+std::atomic<bool>							trace_enabled(false);
+static std::chrono::steady_clock::time_point	trace_start;
+static std::mutex							trace_mutex;	// guards the buffer pool
+static std::vector<std::unique_ptr<TraceBuffer>>	trace_buffers;
+static thread_local TraceThread				trace_thread;
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Returns the buffer of the calling thread, taking a free one
+from the pool or adding one the first time the thread traces
+ */
+static TraceBuffer* GetThreadBuffer()
+{
+	if (trace_thread.buffer != nullptr) return trace_thread.buffer;
+
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	for (std::size_t i = 0; i < trace_buffers.size(); i++)
+	{
+		bool expected = false;
+		if (trace_buffers[i]->in_use.compare_exchange_strong(expected, true))
+		{
+			trace_thread.buffer = trace_buffers[i].get();
+			return trace_thread.buffer;
+		}
+	}
+
+	std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+	buffer->lane = (int)trace_buffers.size() + 1;
+	buffer->in_use.store(true);
+	buffer->dropped = 0;
+	buffer->size = 0;
+	buffer->chunks.reserve((kTraceMaxEvents_ + kTraceChunkEvents_ - 1) / kTraceChunkEvents_);
+	buffer->chunks.emplace_back(new TraceEvent[kTraceChunkEvents_]);
+	trace_thread.buffer = buffer.get();
+	trace_buffers.push_back(std::move(buffer));
+	return trace_thread.buffer;
+}
+
+/*
+Writes a string as a JSON string literal
+ */
+static void WriteJsonString(std::FILE* file, const char* value)
+{
+	std::fputc('"', file);
+	for (const char* c = value; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\') std::fputc('\\', file);
+		if ((unsigned char)*c >= 0x20) std::fputc(*c, file);
+	}
+	std::fputc('"', file);
+}
+
+
+/***********************************************************
+**************** TRACE CONTROL FUNCTIONS *******************
+************************************************************/
+/*
+Starts recording spans, timed from now
+ */
+void StartTrace()
+{
+	trace_start = std::chrono::steady_clock::now();
+	trace_enabled.store(true);
+}
+
+/*
+Stops recording and writes every span recorded so far as a
+trace event JSON file
+ */
+bool WriteTrace(const std::string &filepath)
+{
+	trace_enabled.store(false);
+	std::lock_guard<std::mutex> lock(trace_mutex);
+
+	std::FILE* file = std::fopen(filepath.c_str(), "w");
+	if (file == nullptr) return false;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	for (std::size_t i = 0; i < trace_buffers.size(); i++)
+	{
+		const TraceBuffer &buffer = *trace_buffers[i];
+
+		// names the lane after the thread that first used it
+		if (!buffer.thread_name.empty())
+		{
+			std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", buffer.lane);
+			WriteJsonString(file, buffer.thread_name.c_str());
+			std::fprintf(file, "}}");
+			first = false;
+		}
+
+		// complete events with microsecond timestamps
+		for (std::size_t j = 0; j < buffer.size; j++)
+		{
+			const TraceEvent &event = buffer.chunks[j / kTraceChunkEvents_][j % kTraceChunkEvents_];
+			std::fprintf(file, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+				first ? "" : ",\n", buffer.lane, event.start * 1e-3, (event.end - event.start) * 1e-3);
+			WriteJsonString(file, event.name);
+			std::fprintf(file, ",\"cat\":");
+			WriteJsonString(file, event.category);
+			std::fprintf(file, "}");
+			first = false;
+		}
+	}
+	std::fprintf(file, "\n]}\n");
+	return std::fclose(file) == 0;
+}
+
+/*
+Returns the number of spans dropped because a thread's
+buffer was full
+ */
+unsigned long GetTraceDropped()
+{
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	unsigned long dropped = 0;
+	for (std::size_t i = 0; i < trace_buffers.size(); i++)
+		dropped += trace_buffers[i]->dropped;
+	return dropped;
+}
+
+
+/***********************************************************
+******************** THREAD FUNCTIONS **********************
+************************************************************/
+/*
+Names the calling thread's lane in the timeline. The first
+name given to a lane is kept.
+ */
+void SetTraceThreadName(const char* name)
+{
+	if (!trace_enabled.load(std::memory_order_relaxed)) return;
+	TraceBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if (buffer->thread_name.empty())
+		buffer->thread_name = name;
+}
+
+
+/***********************************************************
+****************** RECORDING FUNCTIONS *********************
+************************************************************/
+/*
+Returns the nanoseconds since the trace started
+ */
+std::int64_t GetTraceTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+/*
+Appends a span to the calling thread's buffer, adding a chunk
+when the last one is full
+ */
+void RecordTraceSpan(const char* name, const char* category, std::int64_t start, std::int64_t end)
+{
+	TraceBuffer* buffer = GetThreadBuffer();
+	if (buffer->size >= kTraceMaxEvents_)
+	{
+		buffer->dropped++;
+		return;
+	}
+	std::size_t chunk = buffer->size / kTraceChunkEvents_;
+	if (chunk == buffer->chunks.size())
+		buffer->chunks.emplace_back(new TraceEvent[kTraceChunkEvents_]);
+	buffer->chunks[chunk][buffer->size % kTraceChunkEvents_] = TraceEvent{ name, category, start, end };
+	buffer->size++;
+}
@@ -0,0 +1,301 @@
+/*
+File: trial_log.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the read and write functions for the
+binary columnar trial log format. A log is laid out as:
+	magic, version, header size, data size,
+	subject, iteration, condition, angle index,
+	sample rate, sample count, channel count, trial name,
+	{type, name, unit} for each channel,
+	one contiguous column per channel.
+Strings are stored as a 16 bit length followed by the
+characters. Every count and size read back is checked against
+the bytes left in the file before anything is allocated, so a
+corrupt log fails to read instead of throwing.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// module header file
+#include "trial_log.hpp"
+
+// libraries for the portable file helpers
+#include "file_io.hpp"
+
+// other misc standard libraries
+#include <cstring>
+
+
+/***********************************************************
+******************** HELPER FUNCTIONS **********************
+************************************************************/
+/*
+Appends the raw bytes of a value to the header
+ */
+template <typename T>
+static void PutValue(std::vector<char> &bytes, const T &value)
+{
+	const char* raw = reinterpret_cast<const char*>(&value);
+	bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+/*
+Appends a length prefixed string to the header
+ */
+static void PutString(std::vector<char> &bytes, const std::string &value)
+{
+	PutValue(bytes, (std::uint16_t)value.size());
+	bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+/*
+Reads the raw bytes of a value from the file
+ */
+template <typename T>
+static bool GetValue(std::FILE* file, T &value)
+{
+	return std::fread(&value, sizeof(T), 1, file) == 1;
+}
+
+/*
+Reads a length prefixed string from the file, failing if it
+would run past the given end of the header
+ */
+static bool GetString(std::FILE* file, std::int64_t end, std::string &value)
+{
+	std::uint16_t length = 0;
+	if (!GetValue(file, length)) return false;
+	if (FileTell(file) + length > end) return false;
+	value.resize(length);
+	if (length == 0) return true;
+	return std::fread(&value[0], 1, length, file) == length;
+}
+
+
+/***********************************************************
+******************** WRITE FUNCTIONS ***********************
+************************************************************/
+/*
+Writes a single trial log at the current position of an
+open file. Used directly by the session container.
+ */
+bool WriteTrialLog(std::FILE* file, const TrialLogInfo &info, const SampleBuffer &buffer)
+{
+	const std::uint64_t sample_count = buffer.GetSize();
+	const std::uint32_t channel_count = kSampleChannels_;
+
+	// computes the size of the column data
+	std::uint64_t data_bytes = sample_count * sizeof(std::uint32_t)
+		+ (std::uint64_t)(kSampleChannels_ - 1) * sample_count * sizeof(double);
+
+	// builds the self describing header
+	std::vector<char> header;
+	header.insert(header.end(), kTrialLogMagic_, kTrialLogMagic_ + sizeof(kTrialLogMagic_));
+	PutValue(header, kTrialLogVersion_);
+	PutValue(header, (std::uint32_t)0); // header size, filled in below
+	PutValue(header, data_bytes);
+	PutValue(header, info.subject);
+	PutValue(header, info.iteration);
+	PutValue(header, info.condition);
+	PutValue(header, info.angle_index);
+	PutValue(header, info.sample_rate);
+	PutValue(header, sample_count);
+	PutValue(header, channel_count);
+	PutString(header, info.trial_name);
+	for (int channel = 0; channel < kSampleChannels_; channel++)
+	{
+		PutValue(header, channel == 0 ? kTrialLogUInt32_ : kTrialLogFloat64_);
+		PutString(header, kSampleChannelNames_[channel]);
+		PutString(header, kSampleChannelUnits_[channel]);
+	}
+
+	// supervision loop timing of the trial
+	header.insert(header.end(), kTrialLogTimingTag_, kTrialLogTimingTag_ + sizeof(kTrialLogTimingTag_));
+	PutValue(header, info.timing.ticks);
+	PutValue(header, info.timing.overruns);
+	PutValue(header, info.timing.nominal_period);
+	PutValue(header, info.timing.mean_period);
+	PutValue(header, info.timing.max_period);
+	PutValue(header, info.timing.max_lateness);
+	PutValue(header, (std::uint32_t)kLoopTimingBins_);
+	for (int bin = 0; bin < kLoopTimingBins_; bin++)
+		PutValue(header, info.timing.histogram[bin]);
+	std::uint32_t header_bytes = (std::uint32_t)header.size();
+	std::memcpy(&header[sizeof(kTrialLogMagic_) + sizeof(std::uint32_t)], &header_bytes, sizeof(header_bytes));
+
+	// writes the header followed by every column
+	if (std::fwrite(header.data(), 1, header.size(), file) != header.size())
+		return false;
+	if (std::fwrite(buffer.GetSampleColumn(), sizeof(std::uint32_t), (std::size_t)sample_count, file) != sample_count)
+		return false;
+	for (int channel = 1; channel < kSampleChannels_; channel++)
+	{
+		if (std::fwrite(buffer.GetColumn(channel), sizeof(double), (std::size_t)sample_count, file) != sample_count)
+			return false;
+	}
+	return true;
+}
+
+/*
+Writes a single trial log to its own file
+ */
+bool WriteTrialLog(const std::string &filepath, const TrialLogInfo &info, const SampleBuffer &buffer)
+{
+	std::FILE* file = std::fopen(filepath.c_str(), "wb");
+	if (file == nullptr) return false;
+
+	bool written = WriteTrialLog(file, info, buffer);
+	if (std::fclose(file) != 0) written = false;
+	return written;
+}
+
+
+/***********************************************************
+********************* READ FUNCTIONS ***********************
+************************************************************/
+/*
+Reads a single trial log from the current position of an
+open file. Channels are read using the names, units and
+types in the header, so logs with other channel layouts
+can still be read. Returns false if the header sizes and
+counts do not agree with each other or with the file.
+ */
+bool ReadTrialLog(std::FILE* file, TrialLogData &data)
+{
+	// the smallest description a channel can have, a type and two empty strings
+	const std::uint64_t kMinChannelBytes(sizeof(std::uint8_t) + 2 * sizeof(std::uint16_t));
+
+	// finds the bytes left in the file from the start of the log
+	const std::int64_t start = FileTell(file);
+	const std::int64_t end = FileSize(file);
+	if (start < 0 || end < start || !FileSeek(file, start)) return false;
+
+	// checks that this is a trial log this version can read
+	char magic[sizeof(kTrialLogMagic_)];
+	if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic)) return false;
+	if (std::memcmp(magic, kTrialLogMagic_, sizeof(magic)) != 0) return false;
+
+	std::uint32_t version = 0, header_bytes = 0, channel_count = 0;
+	std::uint64_t data_bytes = 0;
+	if (!GetValue(file, version) || version != kTrialLogVersion_) return false;
+	if (!GetValue(file, header_bytes)) return false;
+	if (!GetValue(file, data_bytes)) return false;
+	const std::int64_t header_end = start + header_bytes;
+	if (header_end > end || data_bytes > (std::uint64_t)(end - header_end)) return false;
+
+	// reads trial information
+	if (!GetValue(file, data.info.subject))		return false;
+	if (!GetValue(file, data.info.iteration))	return false;
+	if (!GetValue(file, data.info.condition))	return false;
+	if (!GetValue(file, data.info.angle_index))	return false;
+	if (!GetValue(file, data.info.sample_rate))	return false;
+	if (!GetValue(file, data.sample_count))		return false;
+	if (!GetValue(file, channel_count))			return false;
+	if (!GetString(file, header_end, data.info.trial_name))	return false;
+
+	// reads channel descriptions, which must fit in the header
+	if (channel_count == 0 || channel_count * kMinChannelBytes > (std::uint64_t)(header_end - FileTell(file)))
+		return false;
+	data.channels.resize(channel_count);
+	std::uint64_t sample_bytes = 0;
+	for (std::uint32_t channel = 0; channel < channel_count; channel++)
+	{
+		TrialLogChannel &current = data.channels[channel];
+		if (!GetValue(file, current.type))					return false;
+		if (!GetString(file, header_end, current.name))		return false;
+		if (!GetString(file, header_end, current.unit))		return false;
+		if (current.type == kTrialLogUInt32_)		sample_bytes += sizeof(std::uint32_t);
+		else if (current.type == kTrialLogFloat64_)	sample_bytes += sizeof(double);
+		else return false;
+	}
+
+	// the columns must hold exactly the samples counted
+	if (data.sample_count > data_bytes / sample_bytes ||
+		data.sample_count * sample_bytes != data_bytes)
+		return false;
+
+	// reads the loop timing if the header holds it
+	data.info.timing = LoopTimingStats();
+	char tag[sizeof(kTrialLogTimingTag_)];
+	if (FileTell(file) + (std::int64_t)sizeof(tag) <= header_end &&
+		std::fread(tag, 1, sizeof(tag), file) == sizeof(tag) &&
+		std::memcmp(tag, kTrialLogTimingTag_, sizeof(tag)) == 0)
+	{
+		std::uint32_t bins = 0;
+		if (!GetValue(file, data.info.timing.ticks))			return false;
+		if (!GetValue(file, data.info.timing.overruns))			return false;
+		if (!GetValue(file, data.info.timing.nominal_period))	return false;
+		if (!GetValue(file, data.info.timing.mean_period))		return false;
+		if (!GetValue(file, data.info.timing.max_period))		return false;
+		if (!GetValue(file, data.info.timing.max_lateness))		return false;
+		if (!GetValue(file, bins))								return false;
+		for (std::uint32_t bin = 0; bin < bins; bin++)
+		{
+			std::uint32_t count = 0;
+			if (!GetValue(file, count)) return false;
+			if (bin < (std::uint32_t)kLoopTimingBins_) data.info.timing.histogram[bin] = count;
+		}
+	}
+
+	// moves to the start of the column data
+	if (!FileSeek(file, header_end)) return false;
+
+	// reads each column
+	const std::size_t sample_count = (std::size_t)data.sample_count;
+	std::vector<std::uint32_t> integer_column;
+	for (std::uint32_t channel = 0; channel < channel_count; channel++)
+	{
+		TrialLogChannel &current = data.channels[channel];
+		current.values.resize(sample_count);
+		if (current.type == kTrialLogUInt32_)
+		{
+			integer_column.resize(sample_count);
+			if (std::fread(integer_column.data(), sizeof(std::uint32_t), sample_count, file) != sample_count)
+				return false;
+			for (std::size_t i = 0; i < sample_count; i++)
+				current.values[i] = (double)integer_column[i];
+		}
+		else if (current.type == kTrialLogFloat64_)
+		{
+			if (std::fread(current.values.data(), sizeof(double), sample_count, file) != sample_count)
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+Reads a single trial log from its own file
+ */
+bool ReadTrialLog(const std::string &filepath, TrialLogData &data)
+{
+	std::FILE* file = std::fopen(filepath.c_str(), "rb");
+	if (file == nullptr) return false;
+
+	bool read = ReadTrialLog(file, data);
+	std::fclose(file);
+	return read;
+}
+
+
+/***********************************************************
+****************** CONVERSION FUNCTIONS ********************
+************************************************************/
+/*
+Converts the columns of a trial log back into the row
+layout used by the trial CSV files
+ */
+void GetTrialLogRows(const TrialLogData &data, std::vector<std::vector<double>> &output_rows)
+{
+	const std::size_t sample_count = (std::size_t)data.sample_count;
+	output_rows.assign(sample_count, std::vector<double>(data.channels.size()));
+	for (std::size_t channel = 0; channel < data.channels.size(); channel++)
+	{
+		for (std::size_t i = 0; i < sample_count; i++)
+			output_rows[i][channel] = data.channels[channel].values[i];
+	}
+}
@@ -0,0 +1,170 @@
+/*
+File: trial_log_convert.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file is the Main file of the trial log converter. It
+turns binary columnar trial logs (.ftb) back into the trial
+CSV layout written by absolute_threshold_tests so existing
+analysis scripts can keep reading the force/torque data.
+Each trial log is converted to a CSV with the same name
+next to it. Session containers (.fts) are split into one
+CSV per trial, named the same way as the per-trial files.
+Usage: trial_log_convert <file.ftb|file.fts> [...]
+*/
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// libraries for the trial log and session formats
+#include "trial_log.hpp"
+#include "session_file.hpp"
+
+// libraries for MEL
+#include <MEL/Core/Console.hpp>
+#include <MEL/Logging/Csv.hpp>
+
+// other misc standard libraries
+#include <string>
+#include <vector>
+
+// namespace for MEL
+using namespace mel;
+
+
+/***********************************************************
+******************* CONVERSION FUNCTIONS *******************
+************************************************************/
+/*
+Checks if a file path ends in the given extension
+ */
+bool HasExtension(const std::string &filepath, const std::string &extension)
+{
+	return filepath.size() >= extension.size() &&
+		filepath.compare(filepath.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/*
+Removes the given extension from a file path
+ */
+std::string RemoveExtension(const std::string &filepath, const std::string &extension)
+{
+	if (!HasExtension(filepath, extension)) return filepath;
+	return filepath.substr(0, filepath.size() - extension.size());
+}
+
+/*
+Writes a trial read back from a log in the trial CSV layout
+ */
+bool WriteTrialCsv(const std::string &csv_path, const TrialLogData &data)
+{
+	// builds header names from the channel descriptions
+	std::vector<std::string> header_names;
+	for (std::size_t channel = 0; channel < data.channels.size(); channel++)
+		header_names.push_back(data.channels[channel].name);
+
+	// converts the columns back into rows
+	std::vector<std::vector<double>> output_rows;
+	GetTrialLogRows(data, output_rows);
+
+	// saves and exports trial data
+	if (!csv_write_row(csv_path, header_names) || !csv_append_rows(csv_path, output_rows))
+	{
+		print("Failed to write " + csv_path);
+		return false;
+	}
+	return true;
+}
+
+/*
+Converts a single trial log into a trial CSV
+ */
+bool ConvertTrialLog(const std::string &filepath)
+{
+	// reads the binary trial log
+	TrialLogData data;
+	if (!ReadTrialLog(filepath, data))
+	{
+		print("Failed to read trial log " + filepath);
+		return false;
+	}
+
+	// writes the csv next to the log
+	if (!WriteTrialCsv(RemoveExtension(filepath, kTrialLogExtension_) + ".csv", data))
+		return false;
+	print("Converted " + filepath + " (" + std::to_string(data.sample_count) + " samples)");
+	return true;
+}
+
+/*
+Splits a session container into one trial CSV per trial
+ */
+bool ConvertSession(const std::string &filepath)
+{
+	// opens the session and its index
+	SessionReader session;
+	if (!session.Open(filepath))
+	{
+		print("Failed to read session " + filepath);
+		return false;
+	}
+
+	// places the csvs next to the session file
+	std::string directory = "";
+	std::string::size_type separator = filepath.find_last_of("/\\");
+	if (separator != std::string::npos)
+		directory = filepath.substr(0, separator + 1);
+
+	// converts each trial in the order it was recorded
+	int failed = 0;
+	TrialLogData data;
+	for (std::size_t i = 0; i < session.GetTrialCount(); i++)
+	{
+		if (!session.ReadTrial(session.GetEntry(i), data))
+		{
+			print("Failed to read trial " + std::to_string(i) + " of " + filepath);
+			failed++;
+			continue;
+		}
+		std::string filename = "sub" + std::to_string(data.info.subject) + "_" + std::to_string(data.info.iteration) + "_" + data.info.trial_name + "_data.csv";
+		if (!WriteTrialCsv(directory + filename, data))
+			failed++;
+	}
+	print("Converted " + filepath + " (" + std::to_string(session.GetTrialCount()) + " trials)");
+	return failed == 0;
+}
+
+
+/***********************************************************
+********************* MAIN FUNCTION ************************
+************************************************************/
+/*
+Converts every trial log or session given on the command line
+*/
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		print("Usage: trial_log_convert <file.ftb|file.fts> [...]");
+		return EXIT_FAILURE;
+	}
+
+	// converts each trial log or session in turn
+	int failed = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string filepath = argv[i];
+		bool converted = HasExtension(filepath, kSessionExtension_) ?
+			ConvertSession(filepath) : ConvertTrialLog(filepath);
+		if (!converted)
+			failed++;
+	}
+
+	// informs user of any failed conversions
+	if (failed > 0)
+	{
+		print(std::to_string(failed) + " files failed to convert");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,296 @@
+/*
+File: trial_writer.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the TrialWriter class which saves the
+completed movement trials on a dedicated I/O thread. The
+main thread acquires an empty buffer from the pool, records
+a trial into it, and submits it by move. The writer thread
+saves the trial and returns the buffer to the pool.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "trial_writer.hpp"
+
+// libraries for the session trace
+#include "trace.hpp"
+
+// libraries for MEL
+#include <MEL/Logging/Csv.hpp>
+
+// other misc standard libraries
+#include <utility>
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the TrialWriter class. Allocates every
+buffer the writer will ever hand out.
+ */
+TrialWriter::TrialWriter(std::size_t buffer_count, std::size_t buffer_capacity) :
+	buffer_count_(buffer_count),
+	buffer_capacity_(buffer_capacity),
+	format_(TrialFormat::Csv),
+	running_(false),
+	writing_(false),
+	trials_written_(0),
+	failed_writes_(0)
+{
+	free_buffers_.reserve(buffer_count_);
+	for (std::size_t i = 0; i < buffer_count_; i++)
+		free_buffers_.emplace_back(buffer_capacity_);
+}
+
+/*
+Destructor for the TrialWriter class. Any queued trials are
+written before the thread exits.
+ */
+TrialWriter::~TrialWriter()
+{
+	Stop();
+}
+
+
+/***********************************************************
+*************** WRITER PARAMETER FUNCTIONS *****************
+************************************************************/
+/*
+Selects the file format used for trials submitted from now on
+ */
+void TrialWriter::SetFormat(TrialFormat format)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	format_ = format;
+}
+
+/*
+Returns the file format trials are saved in
+ */
+TrialFormat TrialWriter::GetFormat()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return format_;
+}
+
+/*
+Returns the file extension matching the selected format
+ */
+std::string TrialWriter::GetExtension()
+{
+	TrialFormat format = GetFormat();
+	if (format == TrialFormat::Binary)			return kTrialLogExtension_;
+	else if (format == TrialFormat::Session)	return kSessionExtension_;
+	else										return ".csv";
+}
+
+/*
+Opens (or reopens, when resuming) the session container
+that trials are appended to and switches the writer to the
+session format
+ */
+bool TrialWriter::OpenSession(const std::string &filepath, int subject)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!session_.Open(filepath, subject)) return false;
+	format_ = TrialFormat::Session;
+	return true;
+}
+
+/*
+Returns the number of trials held in the open session
+ */
+std::size_t TrialWriter::GetSessionTrialCount()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return session_.GetTrialCount();
+}
+
+
+/***********************************************************
+**************** THREAD CONTROL FUNCTIONS ******************
+************************************************************/
+/*
+Starts the writer thread
+ */
+void TrialWriter::Start()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (running_) return;
+	running_ = true;
+	thread_ = std::thread(&TrialWriter::WriterLoop, this);
+}
+
+/*
+Blocks until every submitted trial has been written. An
+open session also has its index committed so it can be read
+up to this point.
+ */
+void TrialWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!running_) return;
+	idle_.wait(lock, [this] { return jobs_.empty() && !writing_; });
+	if (session_.IsOpen() && !session_.Commit())
+		failed_writes_++;
+}
+
+/*
+Writes out any queued trials and then stops the writer
+thread. Should be called once the stop flag has been raised
+so that no recorded trial is lost on exit.
+ */
+void TrialWriter::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!running_) return;
+		running_ = false;
+	}
+	job_ready_.notify_all();
+	if (thread_.joinable())
+		thread_.join();
+
+	// writes the final index of the session
+	if (session_.IsOpen() && !session_.Close())
+		failed_writes_++;
+}
+
+
+/***********************************************************
+**************** BUFFER HANDOFF FUNCTIONS ******************
+************************************************************/
+/*
+Takes an empty buffer from the pool, waiting for the writer
+to return one if every buffer is queued or being written
+ */
+SampleBuffer TrialWriter::AcquireBuffer()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	buffer_ready_.wait(lock, [this] { return !free_buffers_.empty(); });
+
+	SampleBuffer buffer = std::move(free_buffers_.back());
+	free_buffers_.pop_back();
+	buffer.Clear();
+	return buffer;
+}
+
+/*
+Returns a buffer to the pool without writing it
+ */
+void TrialWriter::ReleaseBuffer(SampleBuffer &&buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_buffers_.push_back(std::move(buffer));
+	}
+	buffer_ready_.notify_one();
+}
+
+/*
+Queues a recorded trial to be written to the given file.
+The queue can never hold more trials than there are pool
+buffers, so this never blocks.
+ */
+void TrialWriter::Submit(const std::string &filepath, const TrialLogInfo &info, SampleBuffer &&buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(TrialJob{ filepath, info, format_, std::move(buffer) });
+	}
+	job_ready_.notify_one();
+}
+
+
+/***********************************************************
+***************** WRITER THREAD FUNCTIONS ******************
+************************************************************/
+/*
+Main loop of the writer thread. Keeps writing until it has
+been stopped and the queue is empty.
+ */
+void TrialWriter::WriterLoop()
+{
+	SetTraceThreadName("Trial writer");
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		job_ready_.wait(lock, [this] { return !jobs_.empty() || !running_; });
+		if (jobs_.empty())
+			break;
+
+		// takes the next job and writes it without holding the lock
+		TrialJob job = std::move(jobs_.front());
+		jobs_.pop_front();
+		writing_ = true;
+		lock.unlock();
+
+		bool written = WriteTrial(job);
+
+		// returns the buffer to the pool
+		lock.lock();
+		writing_ = false;
+		if (written)	trials_written_++;
+		else			failed_writes_++;
+		free_buffers_.push_back(std::move(job.buffer));
+		buffer_ready_.notify_one();
+		if (jobs_.empty())
+			idle_.notify_all();
+	}
+	idle_.notify_all();
+}
+
+/*
+Saves a single trial in the format selected when it was
+submitted
+ */
+bool TrialWriter::WriteTrial(const TrialJob &job)
+{
+	TraceSpan span("TrialWriter::WriteTrial", "io");
+	// binary columnar trial log
+	if (job.format == TrialFormat::Binary)
+		return WriteTrialLog(job.filepath, job.info, job.buffer);
+
+	// trial appended to the session container
+	if (job.format == TrialFormat::Session)
+		return session_.Append(job.info, job.buffer);
+
+	// standard trial CSV layout
+	const std::vector<std::string> header_names(kSampleChannelNames_.begin(), kSampleChannelNames_.end());
+
+	// converts the columns into csv rows
+	std::vector<std::vector<double>> output_rows;
+	job.buffer.GetRows(output_rows);
+
+	// saves and exports trial data
+	if (!mel::csv_write_row(job.filepath, header_names))	return false;
+	return mel::csv_append_rows(job.filepath, output_rows);
+}
+
+
+/***********************************************************
+******************* STATISTIC FUNCTIONS ********************
+************************************************************/
+/*
+Returns the number of trials successfully written
+ */
+unsigned int TrialWriter::GetTrialsWritten()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return trials_written_;
+}
+
+/*
+Returns the number of trials that failed to be written
+ */
+unsigned int TrialWriter::GetFailedWrites()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return failed_writes_;
+}
@@ -0,0 +1,130 @@
+/*
+File: wrench_reader.cpp
+________________________________
+Author(s): Zane Zook (gadzooks@rice.edu)
+
+This file defines the WrenchReader class. Storage for each
+sensor's wrench is sized when the sensor is added, so reading
+and updating never touch the heap afterwards.
+*/
+
+
+/***********************************************************
+******************** LIBRARY IMPORT ************************
+************************************************************/
+// class header file
+#include "wrench_reader.hpp"
+
+
+/***********************************************************
+********************** CONSTRUCTOR *************************
+************************************************************/
+/*
+Constructor for the WrenchReader class
+ */
+WrenchReader::WrenchReader()
+{
+}
+
+
+/***********************************************************
+***************** SENSOR SETUP FUNCTIONS *******************
+************************************************************/
+/*
+Adds a sensor from its ATI .cal file. Sensors read their
+voltages in the order they were added.
+ */
+bool WrenchReader::AddSensor(const std::string &cal_filepath)
+{
+	if (!transform_.AddSensor(cal_filepath)) return false;
+	Wrench zero_wrench;
+	zero_wrench.fill(0.0);
+	wrenches_.push_back(zero_wrench);
+	return true;
+}
+
+/*
+Adds a sensor with the given row-major calibration matrix
+ */
+void WrenchReader::AddSensor(const double matrix[kAtiAxes_][kAtiAxes_])
+{
+	transform_.AddSensor(matrix);
+	Wrench zero_wrench;
+	zero_wrench.fill(0.0);
+	wrenches_.push_back(zero_wrench);
+}
+
+/*
+Takes a scan of voltages as the unloaded bias of every sensor
+ */
+void WrenchReader::Zero(const double* voltages)
+{
+	transform_.Zero(voltages);
+}
+
+
+/***********************************************************
+******************** UPDATE FUNCTIONS **********************
+************************************************************/
+/*
+Updates every sensor's wrench from a single scan of voltages
+ */
+void WrenchReader::Update(const double* voltages)
+{
+	transform_.Transform(voltages, wrenches_.empty() ? nullptr : wrenches_[0].data());
+}
+
+/*
+Converts scans of voltages into one wrench per sensor per scan,
+written to caller storage of scans * GetSensorCount() wrenches
+ */
+void WrenchReader::UpdateBlock(const double* voltages, std::size_t scans, Wrench* wrenches) const
+{
+	transform_.TransformBlock(voltages, scans, wrenches[0].data());
+}
+
+
+/***********************************************************
+******************* ACCESSOR FUNCTIONS *********************
+************************************************************/
+/*
+Returns a view of a sensor's latest wrench
+ */
+const Wrench& WrenchReader::GetWrench(std::size_t sensor) const
+{
+	return wrenches_[sensor];
+}
+
+/*
+Returns a view of a sensor's latest Fx, Fy, Fz
+ */
+const double* WrenchReader::GetForces(std::size_t sensor) const
+{
+	return wrenches_[sensor].data();
+}
+
+/*
+Returns a view of a sensor's latest Tx, Ty, Tz
+ */
+const double* WrenchReader::GetTorques(std::size_t sensor) const
+{
+	return wrenches_[sensor].data() + 3;
+}
+
+/*
+Copies every sensor's latest wrench into caller storage of
+GetSensorCount() wrenches
+ */
+void WrenchReader::GetWrenches(Wrench* wrenches) const
+{
+	for (std::size_t sensor = 0; sensor < wrenches_.size(); sensor++)
+		wrenches[sensor] = wrenches_[sensor];
+}
+
+/*
+Returns the number of sensors added
+ */
+std::size_t WrenchReader::GetSensorCount() const
+{
+	return wrenches_.size();
+}